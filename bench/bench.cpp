@@ -0,0 +1,335 @@
+// Benchmarks for VGraphical. Runs headless by default so it works on a
+// software ICD (lavapipe, SwiftShader) without a display, --window drives
+// a real swapchain instead (run it under Xvfb on CI). Every result is
+// written as one JSON object, to stdout or to --output.
+#include "VGraphical.h"
+#include "vulkanInfo.h"
+#include "cpuProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace ROOT_SPACE;
+
+typedef std::chrono::steady_clock benchClock;
+
+typedef struct {
+    bool window;
+    uint32_t frames;
+    uint32_t allocations;
+    uint32_t tasks;
+    glm::ivec2 size;
+    std::string output;
+} BenchOptions;
+
+typedef std::vector< std::pair< std::string, double > > BenchMetrics;
+
+static double elapsed_ms( const benchClock::time_point & p_begin )
+{
+    return std::chrono::duration< double, std::milli >( benchClock::now() - p_begin ).count();
+}
+
+static bool parse_options( int argc, char ** argv, BenchOptions & p_options )
+{
+    p_options.window = false;
+    p_options.frames = 500;
+    p_options.allocations = 20000;
+    p_options.tasks = 64;
+    p_options.size = glm::ivec2( 1280, 720 );
+
+    for( int i = 1; i < argc; ++i )
+    {
+        const bool t_hasValue = i + 1 < argc;
+        if( !strcmp( argv[i], "--window" ) )
+        {
+            p_options.window = true;
+        }else if( !strcmp( argv[i], "--frames" ) && t_hasValue )
+        {
+            p_options.frames = (uint32_t)atoi( argv[++i] );
+        }else if( !strcmp( argv[i], "--allocations" ) && t_hasValue )
+        {
+            p_options.allocations = (uint32_t)atoi( argv[++i] );
+        }else if( !strcmp( argv[i], "--tasks" ) && t_hasValue )
+        {
+            p_options.tasks = (uint32_t)atoi( argv[++i] );
+        }else if( !strcmp( argv[i], "--size" ) && t_hasValue )
+        {
+            if( sscanf( argv[++i], "%dx%d", &p_options.size.x, &p_options.size.y ) != 2 )
+            {
+                return true;
+            }
+        }else if( !strcmp( argv[i], "--output" ) && t_hasValue )
+        {
+            p_options.output = argv[++i];
+        }else
+        {
+            return true;
+        }
+    }
+
+    return p_options.frames == 0 || p_options.tasks == 0 || p_options.size.x <= 0 || p_options.size.y <= 0;
+}
+
+// alloc/free churn with a bounded live set, the way streaming resources behave;
+// true if an allocation failed, the rate would be meaningless then
+static bool bench_allocations( const uint32_t p_count, double & p_perSec )
+{
+    vulkanAllocator & t_allocator = vulkanInfo::instance.allocator;
+
+    const VkDeviceSize t_sizes[] = { 256, 4096, 65536, 1024 * 1024 };
+    const uint32_t t_live = 256;
+    std::vector< MemoryAllocation > t_allocations( t_live );
+
+    bool t_failed = false;
+    const benchClock::time_point t_begin = benchClock::now();
+    for( uint32_t i = 0; i < p_count && !t_failed; ++i )
+    {
+        MemoryAllocation & t_slot = t_allocations[i % t_live];
+        t_allocator.free( t_slot );
+
+        VkMemoryRequirements t_reqs;
+        t_reqs.size = t_sizes[i % 4];
+        t_reqs.alignment = 256;
+        t_reqs.memoryTypeBits = ~0u;
+        if( t_allocator.alloc( t_reqs, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, vulkanAllocator::Linear, t_slot ) )
+        {
+            fprintf( stderr, "allocation %u of %u bytes failed\n", i, (uint32_t)t_reqs.size );
+            t_slot = MemoryAllocation();
+            t_failed = true;
+        }
+    }
+    for( uint32_t i = 0; i < t_live; ++i )
+    {
+        t_allocator.free( t_allocations[i] );
+    }
+    const double t_ms = elapsed_ms( t_begin );
+
+    t_allocator.trim();
+    p_perSec = p_count / ( t_ms / 1000.0 );
+    return t_failed;
+}
+
+// moves the frame's image to where endFrame expects it, the only gpu work the frame loop does
+static void finish_image( VkCommandBuffer p_cmd, window * p_window )
+{
+    VkImageMemoryBarrier t_barrier = {};
+    t_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    t_barrier.srcAccessMask = 0;
+    t_barrier.dstAccessMask = 0;
+    t_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    t_barrier.newLayout = p_window ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    t_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    t_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    t_barrier.image = VGraphical::getCurrentImage( p_window );
+    t_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    t_barrier.subresourceRange.levelCount = 1;
+    t_barrier.subresourceRange.layerCount = 1;
+
+    vkd.CmdPipelineBarrier( p_cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                          0, 0, nullptr, 0, nullptr, 1, &t_barrier );
+}
+
+static bool run_frame( window * p_window, const BenchOptions & p_options, double * p_recordMs )
+{
+    VkCommandBuffer t_cmd;
+    if( VGraphical::beginFrame( t_cmd, p_window ) )
+    {
+        return true;
+    }
+    if( t_cmd == VK_NULL_HANDLE )
+    {
+        return false;
+    }
+
+    if( p_recordMs )
+    {
+        VkCommandBufferInheritanceInfo t_inheritance = {};
+        t_inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+
+        const VkExtent2D t_extent = VGraphical::getExtent( p_window );
+        const benchClock::time_point t_begin = benchClock::now();
+        bool t_failed = VGraphical::recordParallel( t_cmd, t_inheritance, p_options.tasks,
+            [t_extent]( VkCommandBuffer p_secondary, uint32_t p_task )
+            {
+                // cheap state commands, this measures the recording path and not the driver's draw validation
+                for( uint32_t i = 0; i < 64; ++i )
+                {
+                    VkViewport t_viewport = { 0.0f, 0.0f, (float)t_extent.width, (float)t_extent.height, 0.0f, 1.0f };
+                    vkd.CmdSetViewport( p_secondary, 0, 1, &t_viewport );
+                }
+            }, p_window );
+        *p_recordMs += elapsed_ms( t_begin );
+
+        if( t_failed )
+        {
+            return true;
+        }
+    }
+
+    finish_image( t_cmd, p_window );
+
+    if( VGraphical::endFrame( p_window ) )
+    {
+        return true;
+    }
+    if( p_window )
+    {
+        const bool t_failed = VGraphical::present();
+        window::pollEvents();
+        return t_failed;
+    }
+    return false;
+}
+
+static void write_results( FILE * p_file, const BenchOptions & p_options, const BenchMetrics & p_metrics )
+{
+    const VkPhysicalDeviceProperties & t_props = vulkanInfo::instance.gpu_props;
+
+    fprintf( p_file, "{\n  \"device\": \"%s\",\n  \"vendor_id\": %u,\n  \"driver_version\": %u,\n",
+             t_props.deviceName, t_props.vendorID, t_props.driverVersion );
+    fprintf( p_file, "  \"mode\": \"%s\",\n  \"width\": %d,\n  \"height\": %d,\n  \"frames\": %u,\n",
+             p_options.window ? "window" : "offscreen", p_options.size.x, p_options.size.y, p_options.frames );
+
+    fprintf( p_file, "  \"startup\": [" );
+    const std::vector< StartupPhase > t_phases = VGraphical::getStartupReport();
+    for( size_t i = 0; i < t_phases.size(); ++i )
+    {
+        fprintf( p_file, "%s\n    { \"phase\": \"%s\", \"begin_ms\": %.3f, \"duration_ms\": %.3f, \"background\": %s }",
+                 i ? "," : "", t_phases[i].name, t_phases[i].begin_ms, t_phases[i].duration_ms, t_phases[i].background ? "true" : "false" );
+    }
+    fprintf( p_file, "\n  ],\n  \"metrics\": {" );
+
+    for( size_t i = 0; i < p_metrics.size(); ++i )
+    {
+        fprintf( p_file, "%s\n    \"%s\": %.3f", i ? "," : "", p_metrics[i].first.c_str(), p_metrics[i].second );
+    }
+    fprintf( p_file, "\n  }\n}\n" );
+}
+
+int main( int argc, char ** argv )
+{
+    BenchOptions t_options;
+    if( parse_options( argc, argv, t_options ) )
+    {
+        fprintf( stderr, "usage: %s [--window] [--frames N] [--allocations N] [--tasks N] [--size WxH] [--output FILE]\n", argv[0] );
+        return 2;
+    }
+
+    // the bench measures the library, not its own instrumentation
+    cpuProfiler::setEnabled( false );
+
+    BenchMetrics t_metrics;
+
+    benchClock::time_point t_begin = benchClock::now();
+    if( VGraphical::initGraphical( !t_options.window ) )
+    {
+        fprintf( stderr, "initGraphical failed\n" );
+        return 1;
+    }
+    t_metrics.push_back( std::make_pair( std::string( "init_ms" ), elapsed_ms( t_begin ) ) );
+
+    window * t_window = nullptr;
+    t_begin = benchClock::now();
+    if( t_options.window )
+    {
+        t_window = window::create();
+        if( !t_window )
+        {
+            fprintf( stderr, "window creation failed\n" );
+            return 1;
+        }
+        t_window->setWindowSize( t_options.size );
+        window::pollEvents();
+        // the resize above is applied by the first beginFrame, count it in
+        VkCommandBuffer t_cmd;
+        if( VGraphical::beginFrame( t_cmd, t_window ) )
+        {
+            return 1;
+        }
+        if( t_cmd != VK_NULL_HANDLE )
+        {
+            finish_image( t_cmd, t_window );
+            VGraphical::endFrame( t_window );
+            VGraphical::present();
+        }
+    }else if( VGraphical::initOffscreen( t_options.size, 3 ) )
+    {
+        fprintf( stderr, "initOffscreen failed\n" );
+        return 1;
+    }
+    t_metrics.push_back( std::make_pair( std::string( "target_create_ms" ), elapsed_ms( t_begin ) ) );
+
+    if( t_window )
+    {
+        t_begin = benchClock::now();
+        VGraphical::invalidateSwapchain( *t_window );
+        if( run_frame( t_window, t_options, nullptr ) )
+        {
+            return 1;
+        }
+        t_metrics.push_back( std::make_pair( std::string( "swapchain_recreate_ms" ), elapsed_ms( t_begin ) ) );
+    }
+
+    double t_allocationsPerSec = 0.0;
+    if( bench_allocations( t_options.allocations, t_allocationsPerSec ) )
+    {
+        return 1;
+    }
+    t_metrics.push_back( std::make_pair( std::string( "allocations_per_sec" ), t_allocationsPerSec ) );
+
+    // recording rate, counted over recordParallel only
+    double t_recordMs = 0.0;
+    const uint32_t t_recordFrames = std::max( 1u, t_options.frames / 4 );
+    for( uint32_t i = 0; i < t_recordFrames; ++i )
+    {
+        if( run_frame( t_window, t_options, &t_recordMs ) )
+        {
+            return 1;
+        }
+    }
+    vkd.DeviceWaitIdle( vulkanInfo::instance.device );
+    t_metrics.push_back( std::make_pair( std::string( "commands_per_sec" ),
+                                         (double)t_recordFrames * t_options.tasks * 64 / ( t_recordMs / 1000.0 ) ) );
+
+    // end to end frame rate with an otherwise empty frame
+    std::vector< double > t_frameTimes;
+    t_frameTimes.reserve( t_options.frames );
+    t_begin = benchClock::now();
+    for( uint32_t i = 0; i < t_options.frames; ++i )
+    {
+        const benchClock::time_point t_frameBegin = benchClock::now();
+        if( run_frame( t_window, t_options, nullptr ) )
+        {
+            return 1;
+        }
+        t_frameTimes.push_back( elapsed_ms( t_frameBegin ) );
+    }
+    vkd.DeviceWaitIdle( vulkanInfo::instance.device );
+    const double t_totalMs = elapsed_ms( t_begin );
+
+    std::sort( t_frameTimes.begin(), t_frameTimes.end() );
+    t_metrics.push_back( std::make_pair( std::string( "fps" ), t_options.frames / ( t_totalMs / 1000.0 ) ) );
+    t_metrics.push_back( std::make_pair( std::string( "frame_avg_ms" ), t_totalMs / t_options.frames ) );
+    t_metrics.push_back( std::make_pair( std::string( "frame_p99_ms" ), t_frameTimes[( t_frameTimes.size() - 1 ) * 99 / 100] ) );
+
+    FILE * t_file = t_options.output.empty() ? stdout : fopen( t_options.output.c_str(), "w" );
+    if( !t_file )
+    {
+        fprintf( stderr, "cannot open %s\n", t_options.output.c_str() );
+        return 1;
+    }
+    write_results( t_file, t_options, t_metrics );
+    if( t_file != stdout )
+    {
+        fclose( t_file );
+    }
+
+    VGraphical::destroyGraphical();
+    return 0;
+}
@@ -5,22 +5,290 @@
 #define GLFW_INCLUDE_NONE
 #define GLFW_INCLUDE_VULKAN
 #include "GLFW/glfw3.h"
+#include <functional>
+#include <string>
+#include <vector>
 
 #ifndef ROOT_SPACE
 #define ROOT_SPACE ws
 #endif //ROOT_SPACE
 
 #include "window.h"
+#include "startupReport.h"
+#include "gpuProfile.h"
+#include "graphPass.h"
+#include "deviceDispatch.h"
+#include "deviceProfile.h"
+#include "uniformAllocation.h"
+#include "bindless.h"
+#include "pipelineState.h"
 
 namespace ROOT_SPACE
 {
+    enum class QueueType
+    {
+        Graphics,
+        Compute,       // async compute, a family without graphics if there is one
+        Transfer       // dma queue, falls back to the compute family
+    };
+
+    // device objects VGraphical can destroy on the caller's behalf
+    enum class DeviceObject
+    {
+        Buffer,
+        BufferView,
+        Image,
+        ImageView,
+        Sampler,
+        DeviceMemory,
+        ShaderModule,
+        Pipeline,
+        PipelineLayout,
+        DescriptorSetLayout,
+        DescriptorPool,
+        RenderPass,
+        Framebuffer,
+        Semaphore,
+        Fence,
+        Event,
+        QueryPool,
+        CommandPool
+    };
+
     class VGraphical
     {
     public:
-        static bool initGraphical(void);
+        // p_headless skips glfw and presentation entirely, render targets
+        // are then created with initOffscreen instead of initWindow.
+        // p_asyncDevice returns as soon as the instance exists and builds the
+        // device in the background, so windows can be created meanwhile
+        static bool initGraphical( const bool p_headless = false, const bool p_asyncDevice = false );
+        // start from the default and set before initGraphical, the
+        // VGRAPHICAL_* environment variables are applied on top of it
+        static DeviceProfile defaultDeviceProfile(void);
+        static void setDeviceProfile( const DeviceProfile & p_profile );
+        // every gpu initGraphical considered and how it ranked them
+        static std::vector< DeviceCandidate > getDeviceCandidates(void);
+        // joins an asynchronous device build, true if it failed; initWindow
+        // and initOffscreen call it themselves
+        static bool waitDevice(void);
+        // timings of every init phase, background ones included
+        static std::vector< StartupPhase > getStartupReport(void);
+        static void logStartupReport(void);
+        // waits for the gpu, writes the pipeline cache back and releases the
+        // device; destroy windows first, glfw is terminated here
+        static void destroyGraphical(void);
         static bool initWindow( window & p_window );
+        static void destroyWindow( window & p_window );
+        // marks the window's swapchain stale, it is rebuilt by the next beginFrame
+        static void invalidateSwapchain( window & p_window );
+        static bool initOffscreen( const glm::ivec2 & p_size, const uint32_t p_imageCount = 2 );
+        static bool isHeadless(void);
+
+        // runs p_frame in a loop on a dedicated render thread until it returns
+        // true or stopRenderThread is called. the calling thread keeps polling
+        // events; resizes and present policy changes reach the render thread
+        // through a lock-free queue, window creation and destruction wait for
+        // the frame in progress. p_frame does all beginFrame..present work
+        static bool startRenderThread( const std::function< bool( void ) > & p_frame );
+        static void stopRenderThread(void);
+        static bool isRenderThread(void);
+
+        // number of frames the cpu may record ahead of the gpu
+        static bool setFramesInFlight( const uint32_t p_count );
+
+        // a null window addresses the offscreen target; p_cmd stays null
+        // when there is nothing to draw into (minimized window) and the
+        // frame should be skipped. endFrame submits
+        // but leaves presentation to present, which flips every window
+        // that finished a frame with a single vkQueuePresentKHR
+        static bool beginFrame( VkCommandBuffer & p_cmd, window * p_window = nullptr );
+        static bool endFrame( window * p_window = nullptr );
+        static bool present(void);
+        // the image beginFrame picked for the target, valid until its endFrame
+        static VkImage getCurrentImage( window * p_window = nullptr );
+        static VkImageView getCurrentImageView( window * p_window = nullptr );
+        static VkExtent2D getExtent( window * p_window = nullptr );
+
+        // job system threads one recordParallel call spreads over besides
+        // the caller, 0 means all of them
+        static bool setRecordingThreads( const uint32_t p_count );
+        // records p_taskCount tasks into secondary buffers across threads and
+        // executes them from p_primary in task order
+        static bool recordParallel( VkCommandBuffer p_primary, const VkCommandBufferInheritanceInfo & p_inheritance,
+                                    const uint32_t p_taskCount, const std::function< void( VkCommandBuffer, uint32_t ) > & p_func,
+                                    window * p_window = nullptr );
+        // copies p_data into the target's persistently mapped staging ring.
+        // the copies run ahead of the frame's commands in one batch per
+        // destination, so everything recorded this frame sees them. call
+        // between beginFrame and endFrame; true when the frame's staging
+        // space is used up. p_region.bufferOffset is filled in from p_dst's
+        // p_format, p_oldLayout UNDEFINED discards the subresource's earlier contents
+        static bool uploadBuffer( VkBuffer p_dst, const VkDeviceSize p_offset, const void * p_data, const VkDeviceSize p_size,
+                                  window * p_window = nullptr );
+        static bool uploadImage( VkImage p_dst, const VkFormat p_format, const VkBufferImageCopy & p_region, const void * p_data,
+                                 const VkDeviceSize p_size, const VkImageLayout p_oldLayout, const VkImageLayout p_newLayout,
+                                 window * p_window = nullptr );
+        // staging bytes per frame in flight, rebuilds the frame rings
+        static bool setStagingSize( const uint64_t p_bytes );
+
+        // p_size bytes of per draw constants from the target's uniform ring,
+        // valid until its endFrame and safe from recording threads. bind
+        // getUniformBuffer once as a UNIFORM_BUFFER_DYNAMIC descriptor and
+        // pass offset as its dynamic offset; the buffer only changes when
+        // the frame rings are rebuilt. null data when the frame's space is used up
+        static UniformAllocation allocUniform( const uint32_t p_size, window * p_window = nullptr );
+        static VkBuffer getUniformBuffer( window * p_window = nullptr );
+        // minUniformBufferOffsetAlignment, allocations are rounded up to it
+        static uint32_t getUniformAlignment(void);
+        // uniform ring bytes per frame in flight, rebuilds the frame rings
+        static bool setUniformRingSize( const uint64_t p_bytes );
+
+        // one shared layout per distinct set of bindings, owned by VGraphical
+        static VkDescriptorSetLayout getDescriptorSetLayout( const std::vector< VkDescriptorSetLayoutBinding > & p_bindings );
+        // a set of p_layout valid until the target's endFrame, safe from
+        // recording threads. never free it, the frame's pools are reset in
+        // bulk; VK_NULL_HANDLE for layouts not from getDescriptorSetLayout
+        static VkDescriptorSet allocDescriptorSet( VkDescriptorSetLayout p_layout, window * p_window = nullptr );
+
+        // the descriptor indexing table, only there when the profile asks
+        // for it and the gpu supports it. binding 0 of its set holds
+        // combined image samplers, binding 1 storage buffers; shaders index
+        // them with values from the push constants of getBindlessPipelineLayout
+        static bool hasBindless(void);
+        static VkDescriptorSet getBindlessSet(void);
+        static VkDescriptorSetLayout getBindlessSetLayout(void);
+        static VkPipelineLayout getBindlessPipelineLayout(void);
+        // binds the table as set 0 of the bindless pipeline layout
+        static void bindBindless( VkCommandBuffer p_cmd, const VkPipelineBindPoint p_bindPoint );
+        // the slot now holding the descriptor, BINDLESS_NONE without the
+        // table or once it is full. released slots are reused after the
+        // frames in flight are done with them
+        static uint32_t bindlessImage( VkImageView p_view, VkSampler p_sampler, const VkImageLayout p_layout );
+        static uint32_t bindlessBuffer( VkBuffer p_buffer, const VkDeviceSize p_offset, const VkDeviceSize p_range );
+        static void releaseBindlessImage( const uint32_t p_index );
+        static void releaseBindlessBuffer( const uint32_t p_index );
+
+        // where the pipeline cache file lives, set before initGraphical;
+        // empty means the working directory
+        static void setPipelineCacheDirectory( const std::string & p_directory );
+        // pass to vkCreate*Pipelines so compiled pipelines survive restarts
+        static VkPipelineCache getPipelineCache(void);
+        // writes the cache to disk now instead of waiting for destroyGraphical
+        static bool savePipelineCache(void);
+
+        static PipelineState defaultPipelineState(void);
+        // the handle of the pipeline built from p_state, equal states share
+        // one. never blocks: a new state is compiled on the job system
+        // through the pipeline cache and getPipeline hands out p_fallback
+        // until it is ready or if it failed. safe from recording threads,
+        // pipelines live until destroyGraphical
+        static PipelineStateHandle requestPipeline( const PipelineState & p_state );
+        static VkPipeline getPipeline( const PipelineStateHandle p_handle, VkPipeline p_fallback = VK_NULL_HANDLE );
+        static PipelineStatus getPipelineStatus( const PipelineStateHandle p_handle );
+        // blocks until every requested pipeline is compiled and every shader
+        // loaded, for loading screens
+        static void waitPipelines(void);
+
+        // the handle of a SPIR-V file, equal paths share one and files with
+        // equal bytecode share a module. never blocks: the file is mapped
+        // and its module made on the job system, also before the device
+        // exists. name it in a PipelineState to use it
+        static ShaderHandle loadShader( const std::string & p_path );
+        static ShaderStatus getShaderStatus( const ShaderHandle p_shader );
+        // polls the loaded files from a thread of its own; changed ones are
+        // reloaded in the background and the pipelines using them rebuilt,
+        // frames keep drawing with the old ones until then
+        static void setShaderHotReload( const bool p_enable );
+
+        // family to create command pools for p_type on; queues the device
+        // has no family for share the graphics queue
+        static uint32_t getQueueFamily( const QueueType p_type );
+        static bool hasDedicatedQueue( const QueueType p_type );
+        // submits one batch to p_type. pass a semaphore signaled here to the
+        // waits of another queue's submit, or to waitBeforeFrame, to order
+        // work across queues; exclusive resources still need ownership barriers
+        static bool submit( const QueueType p_type, const std::vector< VkCommandBuffer > & p_cmds,
+                            const std::vector< VkSemaphore > & p_waits, const std::vector< VkPipelineStageFlags > & p_waitStages,
+                            const std::vector< VkSemaphore > & p_signals, VkFence p_fence = VK_NULL_HANDLE );
+        // makes the window's next endFrame wait on p_semaphore at p_stage
+        static void waitBeforeFrame( VkSemaphore p_semaphore, const VkPipelineStageFlags p_stage, window * p_window = nullptr );
+
+        // gpu timing of command buffer regions, gpuBegin returns the id for
+        // gpuEnd. results come back when the frame slot is reused, so the
+        // stats lag frames in flight behind and never stall. p_name must
+        // outlive the frame, string literals are the intended use
+        static uint32_t gpuBegin( VkCommandBuffer p_cmd, const char * p_name, window * p_window = nullptr );
+        static void gpuEnd( VkCommandBuffer p_cmd, const uint32_t p_scope, window * p_window = nullptr );
+        static std::vector< GpuPassStats > getGpuStats( window * p_window = nullptr );
+        // chrome://tracing json of the recent scopes of every render target
+        static bool exportGpuTrace( const std::string & p_path );
+
+        // frame graph of a target, declared anew between beginFrame and
+        // endFrame. endFrame runs the passes after anything recorded directly,
+        // drops the ones nothing depends on and inserts the barriers between
+        // them; transients share memory when their lifetimes do not overlap.
+        // the backbuffer ends up ready to present (windows) or in the layout
+        // of its last use (offscreen). p_name must outlive the frame
+        static GraphResource graphBackbuffer( window * p_window = nullptr );
+        static GraphResource graphCreateImage( const char * p_name, const VkFormat p_format, const VkExtent2D & p_extent, window * p_window = nullptr );
+        static GraphResource graphCreateBuffer( const char * p_name, const VkDeviceSize p_size, window * p_window = nullptr );
+        // the graph orders work within the frame only, anything touching an
+        // imported resource outside of it synchronizes through semaphores
+        static GraphResource graphImportImage( const char * p_name, VkImage p_image, VkImageView p_view, const VkFormat p_format,
+                                               const VkExtent2D & p_extent, const VkImageLayout p_initialLayout,
+                                               const VkImageLayout p_finalLayout, window * p_window = nullptr );
+        static GraphResource graphImportBuffer( const char * p_name, VkBuffer p_buffer, const VkDeviceSize p_size, window * p_window = nullptr );
+        // passes writing an imported resource, or with p_keep set, always run
+        static bool graphAddPass( const char * p_name, const std::vector< GraphAccess > & p_accesses,
+                                  const std::function< void( VkCommandBuffer ) > & p_func, const bool p_keep = false,
+                                  window * p_window = nullptr );
+        // handles behind a graph resource, transients only inside pass callbacks
+        static VkImage graphImage( const GraphResource p_resource, window * p_window = nullptr );
+        static VkImageView graphImageView( const GraphResource p_resource, window * p_window = nullptr );
+        static VkBuffer graphBuffer( const GraphResource p_resource, window * p_window = nullptr );
+        static GraphStats getGraphStats( window * p_window = nullptr );
+        static VkDevice getDevice(void);
+        // the device's entry points without the loader in between, prefer
+        // it for commands recorded in graph passes
+        static const DeviceDispatch & getDispatch(void);
+        // destroys the object once every frame submitted or being recorded
+        // at the time of the call has finished on the graphics queue; never
+        // waits. work on the compute and transfer queues is not tracked.
+        // deviceHandle does this when it goes out of scope
+        static void retire( const DeviceObject p_type, const uint64_t p_handle );
+        static void retire( const std::function< void( void ) > & p_destroy );
+
+        // best depth attachment format the device supports
+        static VkFormat getDepthFormat(void);
+
         static void __glfw_error_callback( int p_error, const char * p_description );
     };
+
+    // brackets the commands recorded during its lifetime with gpuBegin/gpuEnd
+    class gpuScope
+    {
+    public:
+        gpuScope( VkCommandBuffer p_cmd, const char * p_name, window * p_window = nullptr )
+            : mCmd( p_cmd ), mWindow( p_window )
+        {
+            mScope = VGraphical::gpuBegin( p_cmd, p_name, p_window );
+        }
+
+        ~gpuScope(void)
+        {
+            VGraphical::gpuEnd( mCmd, mScope, mWindow );
+        }
+
+    private:
+        VkCommandBuffer mCmd;
+        window * mWindow;
+        uint32_t mScope;
+    };
 }
 
+#define GPU_SCOPE_JOIN2( a, b ) a##b
+#define GPU_SCOPE_JOIN( a, b ) GPU_SCOPE_JOIN2( a, b )
+#define GPU_SCOPE( ... ) ROOT_SPACE::gpuScope GPU_SCOPE_JOIN( __gpu_scope_, __LINE__ )( __VA_ARGS__ )
+
 #endif //__V_GRAPHICAL_H__
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+#ifndef __BINDLESS_H__
+#define __BINDLESS_H__
+
+#ifndef ROOT_SPACE
+#define ROOT_SPACE ws
+#endif //ROOT_SPACE
+
+// what VGraphical::bindlessImage and bindlessBuffer return when the device
+// has no bindless mode or the table is full
+#define BINDLESS_NONE 0xffffffffu
+
+// push constant space of the bindless pipeline layout, visible to every
+// stage; shaders put their indices into the table here
+#define BINDLESS_PUSH_CONSTANT_BYTES 128
+
+#endif //__BINDLESS_H__
@@ -0,0 +1,87 @@
+#pragma once
+#ifndef __CPU_PROFILER_H__
+#define __CPU_PROFILER_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifndef ROOT_SPACE
+#define ROOT_SPACE ws
+#endif //ROOT_SPACE
+
+namespace ROOT_SPACE
+{
+    // cpu time of one zone, summed over all threads and calls of a frame
+    typedef struct {
+        std::string name;
+        uint32_t calls;
+        double frame_ms;
+        double avg_ms;
+        double max_ms;
+    } CpuZoneStats;
+
+    // Zones are written into a ring owned by the recording thread, so the
+    // hot path is two clock reads and a release store. frameMark is the
+    // only reader; it drains the rings, folds the zones into per frame
+    // stats and keeps a bounded history for dumpTrace. Stays on in release.
+    class cpuProfiler
+    {
+    public:
+        static void setEnabled( const bool p_enabled );
+        static bool isEnabled(void)
+        {
+            return smEnabled.load( std::memory_order_relaxed );
+        }
+
+        // closes the current frame, VGraphical calls it from present and
+        // from beginFrame of the offscreen target
+        static void frameMark(void);
+        // the last frame's zones with their rolling average and maximum
+        static std::vector< CpuZoneStats > getStats(void);
+        // chrome://tracing json of the retained zones of every thread
+        static bool dumpTrace( const std::string & p_path );
+
+        static uint64_t now(void)
+        {
+            return (uint64_t)std::chrono::duration_cast< std::chrono::nanoseconds >(
+                std::chrono::steady_clock::now().time_since_epoch() ).count();
+        }
+
+        // p_name must outlive the profiler, string literals are the intended use
+        static void record( const char * p_name, const uint64_t p_begin, const uint64_t p_end );
+
+    private:
+        static std::atomic< bool > smEnabled;
+    };
+
+    class cpuZone
+    {
+    public:
+        explicit cpuZone( const char * p_name )
+            : mName( p_name ), mBegin( cpuProfiler::isEnabled() ? cpuProfiler::now() : 0 )
+        {
+        }
+
+        ~cpuZone(void)
+        {
+            if( mBegin )
+            {
+                cpuProfiler::record( mName, mBegin, cpuProfiler::now() );
+            }
+        }
+
+    private:
+        const char * mName;
+        uint64_t mBegin;
+    };
+}
+
+#define CPU_ZONE_JOIN2( a, b ) a##b
+#define CPU_ZONE_JOIN( a, b ) CPU_ZONE_JOIN2( a, b )
+#define CPU_ZONE( p_name ) ROOT_SPACE::cpuZone CPU_ZONE_JOIN( __cpu_zone_, __LINE__ )( p_name )
+#define CPU_ZONE_FUNCTION() CPU_ZONE( __FUNCTION__ )
+
+#endif //__CPU_PROFILER_H__
@@ -0,0 +1,159 @@
+#pragma once
+#ifndef __DEVICE_DISPATCH_H__
+#define __DEVICE_DISPATCH_H__
+
+#define GLFW_INCLUDE_NONE
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#ifndef ROOT_SPACE
+#define ROOT_SPACE ws
+#endif //ROOT_SPACE
+
+// every device level command of vulkan 1.0, in registry order
+#define VGRAPHICAL_DEVICE_FUNCTIONS( X )    \
+    X( DestroyDevice )                      \
+    X( GetDeviceQueue )                     \
+    X( QueueSubmit )                        \
+    X( QueueWaitIdle )                      \
+    X( DeviceWaitIdle )                     \
+    X( AllocateMemory )                     \
+    X( FreeMemory )                         \
+    X( MapMemory )                          \
+    X( UnmapMemory )                        \
+    X( FlushMappedMemoryRanges )            \
+    X( InvalidateMappedMemoryRanges )       \
+    X( GetDeviceMemoryCommitment )          \
+    X( BindBufferMemory )                   \
+    X( BindImageMemory )                    \
+    X( GetBufferMemoryRequirements )        \
+    X( GetImageMemoryRequirements )         \
+    X( GetImageSparseMemoryRequirements )   \
+    X( QueueBindSparse )                    \
+    X( CreateFence )                        \
+    X( DestroyFence )                       \
+    X( ResetFences )                        \
+    X( GetFenceStatus )                     \
+    X( WaitForFences )                      \
+    X( CreateSemaphore )                    \
+    X( DestroySemaphore )                   \
+    X( CreateEvent )                        \
+    X( DestroyEvent )                       \
+    X( GetEventStatus )                     \
+    X( SetEvent )                           \
+    X( ResetEvent )                         \
+    X( CreateQueryPool )                    \
+    X( DestroyQueryPool )                   \
+    X( GetQueryPoolResults )                \
+    X( CreateBuffer )                       \
+    X( DestroyBuffer )                      \
+    X( CreateBufferView )                   \
+    X( DestroyBufferView )                  \
+    X( CreateImage )                        \
+    X( DestroyImage )                       \
+    X( GetImageSubresourceLayout )          \
+    X( CreateImageView )                    \
+    X( DestroyImageView )                   \
+    X( CreateShaderModule )                 \
+    X( DestroyShaderModule )                \
+    X( CreatePipelineCache )                \
+    X( DestroyPipelineCache )               \
+    X( GetPipelineCacheData )               \
+    X( MergePipelineCaches )                \
+    X( CreateGraphicsPipelines )            \
+    X( CreateComputePipelines )             \
+    X( DestroyPipeline )                    \
+    X( CreatePipelineLayout )               \
+    X( DestroyPipelineLayout )              \
+    X( CreateSampler )                      \
+    X( DestroySampler )                     \
+    X( CreateDescriptorSetLayout )          \
+    X( DestroyDescriptorSetLayout )         \
+    X( CreateDescriptorPool )               \
+    X( DestroyDescriptorPool )              \
+    X( ResetDescriptorPool )                \
+    X( AllocateDescriptorSets )             \
+    X( FreeDescriptorSets )                 \
+    X( UpdateDescriptorSets )               \
+    X( CreateFramebuffer )                  \
+    X( DestroyFramebuffer )                 \
+    X( CreateRenderPass )                   \
+    X( DestroyRenderPass )                  \
+    X( GetRenderAreaGranularity )           \
+    X( CreateCommandPool )                  \
+    X( DestroyCommandPool )                 \
+    X( ResetCommandPool )                   \
+    X( AllocateCommandBuffers )             \
+    X( FreeCommandBuffers )                 \
+    X( BeginCommandBuffer )                 \
+    X( EndCommandBuffer )                   \
+    X( ResetCommandBuffer )                 \
+    X( CmdBindPipeline )                    \
+    X( CmdSetViewport )                     \
+    X( CmdSetScissor )                      \
+    X( CmdSetLineWidth )                    \
+    X( CmdSetDepthBias )                    \
+    X( CmdSetBlendConstants )               \
+    X( CmdSetDepthBounds )                  \
+    X( CmdSetStencilCompareMask )           \
+    X( CmdSetStencilWriteMask )             \
+    X( CmdSetStencilReference )             \
+    X( CmdBindDescriptorSets )              \
+    X( CmdBindIndexBuffer )                 \
+    X( CmdBindVertexBuffers )               \
+    X( CmdDraw )                            \
+    X( CmdDrawIndexed )                     \
+    X( CmdDrawIndirect )                    \
+    X( CmdDrawIndexedIndirect )             \
+    X( CmdDispatch )                        \
+    X( CmdDispatchIndirect )                \
+    X( CmdCopyBuffer )                      \
+    X( CmdCopyImage )                       \
+    X( CmdBlitImage )                       \
+    X( CmdCopyBufferToImage )               \
+    X( CmdCopyImageToBuffer )               \
+    X( CmdUpdateBuffer )                    \
+    X( CmdFillBuffer )                      \
+    X( CmdClearColorImage )                 \
+    X( CmdClearDepthStencilImage )          \
+    X( CmdClearAttachments )                \
+    X( CmdResolveImage )                    \
+    X( CmdSetEvent )                        \
+    X( CmdResetEvent )                      \
+    X( CmdWaitEvents )                      \
+    X( CmdPipelineBarrier )                 \
+    X( CmdBeginQuery )                      \
+    X( CmdEndQuery )                        \
+    X( CmdResetQueryPool )                  \
+    X( CmdWriteTimestamp )                  \
+    X( CmdCopyQueryPoolResults )            \
+    X( CmdPushConstants )                   \
+    X( CmdBeginRenderPass )                 \
+    X( CmdNextSubpass )                     \
+    X( CmdEndRenderPass )                   \
+    X( CmdExecuteCommands )
+
+// VK_KHR_swapchain, only enabled when VGraphical presents to windows
+#define VGRAPHICAL_SWAPCHAIN_FUNCTIONS( X ) \
+    X( CreateSwapchainKHR )                 \
+    X( DestroySwapchainKHR )                \
+    X( GetSwapchainImagesKHR )              \
+    X( AcquireNextImageKHR )                \
+    X( QueuePresentKHR )
+
+namespace ROOT_SPACE
+{
+    // entry points resolved through vkGetDeviceProcAddr for VGraphical's
+    // device. calling them skips the loader's trampoline, which looks the
+    // device's table up on every call; commands recorded in graph passes
+    // should go through it as well. the swapchain entries are null when
+    // headless
+    typedef struct {
+        #define VGRAPHICAL_DISPATCH_MEMBER( name ) PFN_vk##name name;
+        VGRAPHICAL_DEVICE_FUNCTIONS( VGRAPHICAL_DISPATCH_MEMBER )
+        VGRAPHICAL_SWAPCHAIN_FUNCTIONS( VGRAPHICAL_DISPATCH_MEMBER )
+        #undef VGRAPHICAL_DISPATCH_MEMBER
+    } DeviceDispatch;
+}
+
+#endif //__DEVICE_DISPATCH_H__
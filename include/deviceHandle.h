@@ -0,0 +1,86 @@
+#pragma once
+#ifndef __DEVICE_HANDLE_H__
+#define __DEVICE_HANDLE_H__
+
+#include <cstdint>
+#include <cstring>
+
+#ifndef ROOT_SPACE
+#define ROOT_SPACE ws
+#endif //ROOT_SPACE
+
+#include "VGraphical.h"
+
+namespace ROOT_SPACE
+{
+    // owns one device object and hands it to VGraphical::retire when reset
+    // or destroyed, so it is freed once the gpu is done with it instead of
+    // the owner waiting on the device
+    template< typename T, DeviceObject K >
+    class deviceHandle
+    {
+    public:
+        deviceHandle(void) : mHandle( VK_NULL_HANDLE ) {}
+        explicit deviceHandle( T p_handle ) : mHandle( p_handle ) {}
+        ~deviceHandle(void) { reset(); }
+
+        deviceHandle( deviceHandle && p_other ) : mHandle( p_other.release() ) {}
+        deviceHandle & operator=( deviceHandle && p_other )
+        {
+            if( this != &p_other )
+            {
+                reset( p_other.release() );
+            }
+            return *this;
+        }
+
+        deviceHandle( const deviceHandle & ) = delete;
+        deviceHandle & operator=( const deviceHandle & ) = delete;
+
+        T get(void) const { return mHandle; }
+        operator bool(void) const { return mHandle != VK_NULL_HANDLE; }
+
+        // gives up ownership without retiring
+        T release(void)
+        {
+            T t_handle = mHandle;
+            mHandle = VK_NULL_HANDLE;
+            return t_handle;
+        }
+
+        void reset( T p_handle = VK_NULL_HANDLE )
+        {
+            if( mHandle != VK_NULL_HANDLE )
+            {
+                uint64_t t_bits = 0;
+                memcpy( &t_bits, &mHandle, sizeof( T ) );
+                VGraphical::retire( K, t_bits );
+            }
+            mHandle = p_handle;
+        }
+
+    private:
+        T mHandle;
+    };
+
+    typedef deviceHandle< VkBuffer, DeviceObject::Buffer > BufferHandle;
+    typedef deviceHandle< VkBufferView, DeviceObject::BufferView > BufferViewHandle;
+    typedef deviceHandle< VkImage, DeviceObject::Image > ImageHandle;
+    typedef deviceHandle< VkImageView, DeviceObject::ImageView > ImageViewHandle;
+    typedef deviceHandle< VkSampler, DeviceObject::Sampler > SamplerHandle;
+    typedef deviceHandle< VkDeviceMemory, DeviceObject::DeviceMemory > MemoryHandle;
+    typedef deviceHandle< VkShaderModule, DeviceObject::ShaderModule > ShaderModuleHandle;
+    typedef deviceHandle< VkPipeline, DeviceObject::Pipeline > PipelineHandle;
+    typedef deviceHandle< VkPipelineLayout, DeviceObject::PipelineLayout > PipelineLayoutHandle;
+    typedef deviceHandle< VkDescriptorSetLayout, DeviceObject::DescriptorSetLayout > DescriptorSetLayoutHandle;
+    typedef deviceHandle< VkDescriptorPool, DeviceObject::DescriptorPool > DescriptorPoolHandle;
+    typedef deviceHandle< VkRenderPass, DeviceObject::RenderPass > RenderPassHandle;
+    typedef deviceHandle< VkFramebuffer, DeviceObject::Framebuffer > FramebufferHandle;
+    typedef deviceHandle< VkSemaphore, DeviceObject::Semaphore > SemaphoreHandle;
+    typedef deviceHandle< VkFence, DeviceObject::Fence > FenceHandle;
+    typedef deviceHandle< VkEvent, DeviceObject::Event > EventHandle;
+    typedef deviceHandle< VkQueryPool, DeviceObject::QueryPool > QueryPoolHandle;
+    typedef deviceHandle< VkCommandPool, DeviceObject::CommandPool > CommandPoolHandle;
+}
+
+#endif //__DEVICE_HANDLE_H__
@@ -0,0 +1,47 @@
+#pragma once
+#ifndef __DEVICE_PROFILE_H__
+#define __DEVICE_PROFILE_H__
+
+#define GLFW_INCLUDE_NONE
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+#include <string>
+#include <vector>
+
+#ifndef ROOT_SPACE
+#define ROOT_SPACE ws
+#endif //ROOT_SPACE
+
+namespace ROOT_SPACE
+{
+    // how initGraphical sets the instance up and picks the gpu. the
+    // defaults validate in debug builds only; VGRAPHICAL_VALIDATION=0/1,
+    // VGRAPHICAL_BREAK=0/1 and VGRAPHICAL_GPU=<index or part of the name>
+    // override whatever the application set, as does VGRAPHICAL_BINDLESS=0/1
+    typedef struct {
+        bool validate;                  // validation layers and the debug report callback
+        bool break_on_error;            // trap into the debugger on a report instead of logging it
+        bool prefer_integrated;         // rank integrated gpus above discrete ones
+        std::string gpu;                // forces a device: enumeration index or part of its name
+        uint64_t min_device_memory;     // bytes of device local memory a gpu needs, 0 for any
+        VkPhysicalDeviceFeatures required_features;     // enabled on the device, gpus lacking one are skipped
+        std::vector< std::string > instance_extensions;
+        std::vector< std::string > device_extensions;   // gpus lacking one are skipped
+        bool bindless;                  // descriptor indexing table when the gpu has it, never a reason to skip one
+        uint32_t bindless_images;       // table size, lowered to the device limits
+        uint32_t bindless_buffers;
+    } DeviceProfile;
+
+    // what selection found out about one gpu, in enumeration order
+    typedef struct {
+        std::string name;
+        VkPhysicalDeviceType type;
+        uint64_t device_memory;         // largest device local heap
+        bool suitable;
+        std::string rejected;           // why it is not suitable
+        int64_t score;
+        bool selected;
+    } DeviceCandidate;
+}
+
+#endif //__DEVICE_PROFILE_H__
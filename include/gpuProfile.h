@@ -0,0 +1,24 @@
+#pragma once
+#ifndef __GPU_PROFILE_H__
+#define __GPU_PROFILE_H__
+
+#include <string>
+
+#ifndef ROOT_SPACE
+#define ROOT_SPACE ws
+#endif //ROOT_SPACE
+
+namespace ROOT_SPACE
+{
+    // gpu time of one named scope over its most recent samples
+    typedef struct {
+        std::string name;
+        uint32_t samples;
+        double last_ms;
+        double avg_ms;
+        double min_ms;
+        double max_ms;
+    } GpuPassStats;
+}
+
+#endif //__GPU_PROFILE_H__
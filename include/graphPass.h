@@ -0,0 +1,53 @@
+#pragma once
+#ifndef __GRAPH_PASS_H__
+#define __GRAPH_PASS_H__
+
+#include <cstdint>
+
+#ifndef ROOT_SPACE
+#define ROOT_SPACE ws
+#endif //ROOT_SPACE
+
+namespace ROOT_SPACE
+{
+    // handle of an image or buffer in the frame graph, valid until the
+    // target's next beginFrame
+    typedef uint32_t GraphResource;
+
+    #define GRAPH_RESOURCE_NONE 0xffffffffu
+
+    // how a pass touches a resource, it decides the pipeline stages, access
+    // mask and image layout the graph synchronizes against
+    enum class GraphUsage
+    {
+        ColorAttachment,    // read and written as a color attachment
+        DepthAttachment,    // depth tested and written
+        DepthRead,          // depth tested only, read only layout
+        Sampled,            // sampled in a fragment or compute shader
+        StorageRead,
+        StorageWrite,
+        TransferSrc,
+        TransferDst,        // fully overwritten, earlier contents are not kept
+        VertexBuffer,
+        IndexBuffer,
+        UniformBuffer,
+        IndirectBuffer
+    };
+
+    typedef struct {
+        GraphResource resource;
+        GraphUsage usage;
+    } GraphAccess;
+
+    // what the last executed graph of a target did
+    typedef struct {
+        uint32_t pass_count;
+        uint32_t culled_count;
+        uint32_t barrier_count;         // vkCmdPipelineBarrier calls
+        uint32_t transient_count;
+        uint64_t transient_bytes;       // memory behind the transients
+        uint64_t unaliased_bytes;       // what they would take without aliasing
+    } GraphStats;
+}
+
+#endif //__GRAPH_PASS_H__
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef __JOB_SYSTEM_H__
+#define __JOB_SYSTEM_H__
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#ifndef ROOT_SPACE
+#define ROOT_SPACE ws
+#endif //ROOT_SPACE
+
+namespace ROOT_SPACE
+{
+    // Work-stealing scheduler shared by VGraphical and the application, so
+    // both draw from one set of threads instead of competing for cores.
+    // Every worker owns a deque: it pushes and pops its own end and idle
+    // workers steal from the other end. Threads outside the system submit
+    // through a shared queue and sleep while they wait, workers that wait
+    // keep running other jobs meanwhile.
+    class jobSystem
+    {
+    public:
+        struct Job;
+        typedef std::shared_ptr< Job > JobHandle;
+        typedef std::function< void( void ) > JobFunc;
+        typedef std::function< void( uint32_t p_begin, uint32_t p_end ) > RangeFunc;
+
+        // 0 workers means one per core besides the calling thread. the
+        // system starts itself with the default on first use, call init
+        // before initGraphical to pick the count; true if it is already
+        // running with a different one
+        static bool init( const uint32_t p_workers = 0 );
+        // waits for the queued jobs, then joins the workers
+        static void shutdown(void);
+
+        static uint32_t workerCount(void);
+        // 1..workerCount on workers, 0 on any other thread
+        static uint32_t threadIndex(void);
+
+        // a job is finished once its function returned and every job run
+        // with it as p_parent finished too
+        static JobHandle run( const JobFunc & p_func, const JobHandle & p_parent = JobHandle() );
+        // the job executing on this thread, empty outside of jobs
+        static JobHandle current(void);
+        static bool isFinished( const JobHandle & p_job );
+        // returns once p_job is finished
+        static void wait( const JobHandle & p_job );
+
+        // splits [0, p_count) into ranges of about p_grain items, 0 picks a
+        // grain giving each thread a few ranges; returns when all are done
+        static void parallelFor( const uint32_t p_count, const uint32_t p_grain, const RangeFunc & p_func );
+    };
+}
+
+#endif //__JOB_SYSTEM_H__
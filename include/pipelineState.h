@@ -0,0 +1,73 @@
+#pragma once
+#ifndef __PIPELINE_STATE_H__
+#define __PIPELINE_STATE_H__
+
+#define GLFW_INCLUDE_NONE
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include "shaderHandle.h"
+
+#ifndef ROOT_SPACE
+#define ROOT_SPACE ws
+#endif //ROOT_SPACE
+
+#define PIPELINE_MAX_VERTEX_BINDINGS 4
+#define PIPELINE_MAX_VERTEX_ATTRIBUTES 16
+#define PIPELINE_MAX_COLOR_ATTACHMENTS 4
+
+namespace ROOT_SPACE
+{
+    // stable for the life of the device, even while the pipeline behind it
+    // is compiled or rebuilt
+    typedef uint32_t PipelineStateHandle;
+
+    #define PIPELINE_NONE 0xffffffffu
+
+    enum class PipelineStatus
+    {
+        Pending,        // queued, compiling or waiting for its shaders
+        Ready,
+        Failed
+    };
+
+    // everything a pipeline is built from and looked up by; only the first
+    // *_count entries of the arrays count. a compute shader makes it a
+    // compute pipeline and everything but layout is ignored. viewport and
+    // scissor are always dynamic, shaders enter at "main". start from
+    // VGraphical::defaultPipelineState
+    typedef struct {
+        // a shader from VGraphical::loadShader takes the place of the
+        // module next to it; the pipeline compiles once the shader is
+        // loaded and is rebuilt whenever it is reloaded
+        VkShaderModule vertex;
+        VkShaderModule fragment;
+        VkShaderModule compute;
+        ShaderHandle vertex_shader;
+        ShaderHandle fragment_shader;
+        ShaderHandle compute_shader;
+        VkPipelineLayout layout;
+        VkRenderPass render_pass;
+        uint32_t subpass;
+
+        uint32_t binding_count;
+        VkVertexInputBindingDescription bindings[PIPELINE_MAX_VERTEX_BINDINGS];
+        uint32_t attribute_count;
+        VkVertexInputAttributeDescription attributes[PIPELINE_MAX_VERTEX_ATTRIBUTES];
+
+        VkPrimitiveTopology topology;
+        VkPolygonMode polygon_mode;
+        VkCullModeFlags cull_mode;
+        VkFrontFace front_face;
+        VkSampleCountFlagBits samples;
+
+        bool depth_test;
+        bool depth_write;
+        VkCompareOp depth_compare;
+
+        uint32_t color_count;
+        VkPipelineColorBlendAttachmentState blend[PIPELINE_MAX_COLOR_ATTACHMENTS];
+    } PipelineState;
+}
+
+#endif //__PIPELINE_STATE_H__
@@ -0,0 +1,26 @@
+#pragma once
+#ifndef __SHADER_HANDLE_H__
+#define __SHADER_HANDLE_H__
+
+#include <cstdint>
+
+#ifndef ROOT_SPACE
+#define ROOT_SPACE ws
+#endif //ROOT_SPACE
+
+namespace ROOT_SPACE
+{
+    // one per SPIR-V file path, stable while the file is reloaded
+    typedef uint32_t ShaderHandle;
+
+    #define SHADER_NONE 0xffffffffu
+
+    enum class ShaderStatus
+    {
+        Pending,        // the first load is queued or running
+        Ready,          // a module exists, reloads keep it until the new one is made
+        Failed          // the file could not be read or the driver rejected it
+    };
+}
+
+#endif //__SHADER_HANDLE_H__
@@ -0,0 +1,75 @@
+#pragma once
+#ifndef __SPSC_QUEUE_H__
+#define __SPSC_QUEUE_H__
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#ifndef ROOT_SPACE
+#define ROOT_SPACE ws
+#endif //ROOT_SPACE
+
+namespace ROOT_SPACE
+{
+    // Bounded single producer / single consumer ring. push and pop never
+    // block or allocate; push fails when the ring is full. Head and tail
+    // sit on their own cache lines so the two threads do not false share.
+    template< typename T >
+    class spscQueue
+    {
+    public:
+        // p_capacity is rounded up to a power of two
+        explicit spscQueue( const size_t p_capacity = 256 )
+        {
+            size_t t_capacity = 2;
+            while( t_capacity < p_capacity )
+            {
+                t_capacity <<= 1;
+            }
+            mSlots.resize( t_capacity );
+            mMask = t_capacity - 1;
+            mHead.store( 0, std::memory_order_relaxed );
+            mTail.store( 0, std::memory_order_relaxed );
+        }
+
+        bool push( const T & p_value )
+        {
+            const size_t t_tail = mTail.load( std::memory_order_relaxed );
+            if( t_tail - mHead.load( std::memory_order_acquire ) > mMask )
+            {
+                return false;
+            }
+
+            mSlots[t_tail & mMask] = p_value;
+            mTail.store( t_tail + 1, std::memory_order_release );
+            return true;
+        }
+
+        bool pop( T & p_value )
+        {
+            const size_t t_head = mHead.load( std::memory_order_relaxed );
+            if( t_head == mTail.load( std::memory_order_acquire ) )
+            {
+                return false;
+            }
+
+            p_value = mSlots[t_head & mMask];
+            mHead.store( t_head + 1, std::memory_order_release );
+            return true;
+        }
+
+        bool empty(void) const
+        {
+            return mHead.load( std::memory_order_acquire ) == mTail.load( std::memory_order_acquire );
+        }
+
+    private:
+        std::vector< T > mSlots;
+        size_t mMask;
+        alignas( 64 ) std::atomic< size_t > mHead;
+        alignas( 64 ) std::atomic< size_t > mTail;
+    };
+}
+
+#endif //__SPSC_QUEUE_H__
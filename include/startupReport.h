@@ -0,0 +1,22 @@
+#pragma once
+#ifndef __STARTUP_REPORT_H__
+#define __STARTUP_REPORT_H__
+
+#ifndef ROOT_SPACE
+#define ROOT_SPACE ws
+#endif //ROOT_SPACE
+
+namespace ROOT_SPACE
+{
+    // one timed step of initGraphical, times are milliseconds since
+    // initGraphical was entered; background phases overlap the others
+    typedef struct {
+        const char * name;
+        double begin_ms;
+        double duration_ms;
+        bool background;
+        bool failed;
+    } StartupPhase;
+}
+
+#endif //__STARTUP_REPORT_H__
@@ -0,0 +1,24 @@
+#pragma once
+#ifndef __UNIFORM_ALLOCATION_H__
+#define __UNIFORM_ALLOCATION_H__
+
+#define GLFW_INCLUDE_NONE
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#ifndef ROOT_SPACE
+#define ROOT_SPACE ws
+#endif //ROOT_SPACE
+
+namespace ROOT_SPACE
+{
+    // a block of per draw constants in the frame's uniform ring, data is
+    // write only and null when the allocation failed
+    typedef struct {
+        VkBuffer buffer;
+        uint32_t offset;        // dynamic offset for vkCmdBindDescriptorSets
+        void * data;
+    } UniformAllocation;
+}
+
+#endif //__UNIFORM_ALLOCATION_H__
@@ -8,6 +8,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include <functional>
 
 #include "IMemory.h"
@@ -15,11 +16,22 @@
 
 namespace ROOT_SPACE
 {
+    // how the swapchain trades latency against tearing and power, the
+    // present mode is picked from what the surface actually supports
+    enum class PresentPolicy
+    {
+        VSync,          // FIFO
+        AdaptiveVSync,  // FIFO_RELAXED > FIFO
+        LowLatency,     // MAILBOX > IMMEDIATE > FIFO_RELAXED > FIFO
+        Throughput      // IMMEDIATE > MAILBOX > FIFO_RELAXED > FIFO
+    };
+
     class window: public object
     {
         ATTIRBUTE_R( glm::ivec2, WindowSize );
         ATTIRBUTE_R( glm::ivec2, WindowPos );
         ATTIRBUTE_R( std::string, WindowTitle );
+        ATTIRBUTE_R( PresentPolicy, PresentPolicy );
 
         EVENT( std::function< void( const glm::ivec2 & ) >, WindowSizeChanged );
         EVENT( std::function< void( const glm::ivec2 & ) >, WindowPosChanged );
@@ -30,8 +42,19 @@ namespace ROOT_SPACE
         void setWindowSize( const glm::ivec2 & p_windowSize );
         void setWindowPos( const glm::ivec2 & p_windowPos );
         void setWindowTitle( const std::string & p_windowTitle );
+        // the swapchain is rebuilt with the new mode at the next frame
+        void setPresentPolicy( const PresentPolicy p_policy );
 
         GLFWwindow * _GLFW_WindowHandle(void) const;
+
+        // glfw callbacks only queue events; this polls glfw and hands every
+        // window's queue to its on* handlers, call it once per frame.
+        // Until the first call, events are handed to the handlers straight
+        // from the glfw callbacks as before, so applications that still call
+        // glfwPollEvents themselves keep working. Key events beyond
+        // WINDOW_EVENT_LIMIT per frame are dropped.
+        static void pollEvents(void);
+        void dispatchEvents(void);
         
     protected:
         window(void);
@@ -53,10 +76,47 @@ namespace ROOT_SPACE
         
     private:
 
+        enum class EventType
+        {
+            Key,
+            Resize,
+            Move,
+            Refresh
+        };
+
+        typedef struct {
+            EventType type;
+            int key;
+            int scancode;
+            int action;
+            int mods;
+            glm::ivec2 value;
+        } WindowEvent;
+
+        // resize, move and refresh keep one queue entry updated with the
+        // latest value, keys are kept in order
+        void queueEvent( const WindowEvent & p_event, int & p_pending );
+        void queueKey( const WindowEvent & p_event );
+        // hands the queue over at once when nobody calls pollEvents
+        void eventQueued(void);
+
+        // unhooks the window from glfw; while events are being dispatched the
+        // glfw window itself outlives the dispatch so its handle is not reused
+        void releaseHandle(void);
+        static void flushReleased(void);
+
         static std::map< GLFWwindow * , window * > smWindows;
+        static uint32_t smDispatchDepth;
+        static bool smPolling;
+        static std::vector< GLFWwindow * > smReleased;
 
         GLFWwindow *    mWindowHandle;
 
+        std::vector< WindowEvent > mEvents;
+        int mPendingResize;
+        int mPendingMove;
+        int mPendingRefresh;
+
         // std::function< void ( const int p_key ) > mKeyDown;
         // std::function< void ( const int p_key ) > mKeyUp;
         
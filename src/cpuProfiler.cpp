@@ -0,0 +1,282 @@
+#include "cpuProfiler.h"
+
+#include "log.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <mutex>
+
+// events per thread ring, a thread that records more between two frame
+// marks loses its oldest zones
+#define CPU_PROFILER_RING 16384
+#define CPU_PROFILER_HISTORY_FRAMES 120
+#define CPU_PROFILER_TRACE_EVENTS 65536
+
+namespace ROOT_SPACE
+{
+    typedef struct {
+        const char * name;
+        uint64_t begin;
+        uint64_t end;
+    } ZoneEvent;
+
+    typedef struct {
+        ZoneEvent event;
+        uint32_t thread;
+    } TraceEvent;
+
+    // frameMark may read a slot while its owner overwrites it, so the
+    // fields are relaxed atomics and torn copies are dropped by index
+    struct RingSlot
+    {
+        std::atomic< const char * > name;
+        std::atomic< uint64_t > begin;
+        std::atomic< uint64_t > end;
+    };
+
+    struct ThreadRing
+    {
+        RingSlot events[CPU_PROFILER_RING];
+        std::atomic< uint64_t > head;   // written by the owning thread only
+        uint64_t tail;                  // written by frameMark only
+        uint32_t thread;
+    };
+
+    struct ZoneHistory
+    {
+        std::vector< double > samples;
+        uint32_t head;
+        uint32_t count;
+        uint32_t calls;
+        double frame_ms;
+    };
+
+    std::atomic< bool > cpuProfiler::smEnabled( true );
+
+    // rings are never freed, a thread that exits still has its last zones drained
+    static std::mutex smRingsMutex;
+    static std::vector< ThreadRing * > smRings;
+    static thread_local ThreadRing * smThreadRing = nullptr;
+
+    // everything below is only touched by frameMark and the readers, under smCollectMutex
+    static std::mutex smCollectMutex;
+    static std::map< std::string, ZoneHistory > smZones;
+    static std::vector< TraceEvent > smTrace;
+    static uint32_t smTraceHead = 0;
+    static uint64_t smLastMark = 0;
+
+    static ThreadRing * register_thread(void)
+    {
+        ThreadRing * t_ring = new ThreadRing();
+        t_ring->head.store( 0, std::memory_order_relaxed );
+        t_ring->tail = 0;
+
+        std::lock_guard< std::mutex > t_lock( smRingsMutex );
+        t_ring->thread = (uint32_t)smRings.size();
+        smRings.push_back( t_ring );
+
+        smThreadRing = t_ring;
+        return t_ring;
+    }
+
+    void cpuProfiler::setEnabled( const bool p_enabled )
+    {
+        smEnabled.store( p_enabled, std::memory_order_relaxed );
+    }
+
+    void cpuProfiler::record( const char * p_name, const uint64_t p_begin, const uint64_t p_end )
+    {
+        ThreadRing * t_ring = smThreadRing ? smThreadRing : register_thread();
+
+        const uint64_t t_head = t_ring->head.load( std::memory_order_relaxed );
+        // keeps the last head store ahead of the slot stores, a reader that
+        // sees this slot change also sees head past it
+        std::atomic_thread_fence( std::memory_order_release );
+
+        RingSlot & t_slot = t_ring->events[t_head % CPU_PROFILER_RING];
+        t_slot.name.store( p_name, std::memory_order_relaxed );
+        t_slot.begin.store( p_begin, std::memory_order_relaxed );
+        t_slot.end.store( p_end, std::memory_order_relaxed );
+        t_ring->head.store( t_head + 1, std::memory_order_release );
+    }
+
+    static void append_trace( const ZoneEvent & p_event, const uint32_t p_thread )
+    {
+        if( smTrace.empty() )
+        {
+            smTrace.resize( CPU_PROFILER_TRACE_EVENTS );
+        }
+
+        TraceEvent & t_trace = smTrace[smTraceHead];
+        t_trace.event = p_event;
+        t_trace.thread = p_thread;
+        smTraceHead = ( smTraceHead + 1 ) % CPU_PROFILER_TRACE_EVENTS;
+    }
+
+    void cpuProfiler::frameMark(void)
+    {
+        const uint64_t t_now = now();
+
+        std::vector< ThreadRing * > t_rings;
+        {
+            std::lock_guard< std::mutex > t_lock( smRingsMutex );
+            t_rings = smRings;
+        }
+
+        std::lock_guard< std::mutex > t_lock( smCollectMutex );
+
+        for( std::map< std::string, ZoneHistory >::iterator t_it = smZones.begin(); t_it != smZones.end(); ++t_it )
+        {
+            t_it->second.calls = 0;
+            t_it->second.frame_ms = 0.0;
+        }
+
+        std::vector< ZoneEvent > t_events;
+        for( size_t r = 0; r < t_rings.size(); ++r )
+        {
+            ThreadRing * t_ring = t_rings[r];
+            const uint64_t t_head = t_ring->head.load( std::memory_order_acquire );
+            uint64_t t_tail = std::max( t_ring->tail, t_head > CPU_PROFILER_RING ? t_head - CPU_PROFILER_RING : 0 );
+
+            t_events.clear();
+            for( uint64_t i = t_tail; i < t_head; ++i )
+            {
+                const RingSlot & t_slot = t_ring->events[i % CPU_PROFILER_RING];
+                ZoneEvent t_event;
+                t_event.name = t_slot.name.load( std::memory_order_relaxed );
+                t_event.begin = t_slot.begin.load( std::memory_order_relaxed );
+                t_event.end = t_slot.end.load( std::memory_order_relaxed );
+                t_events.push_back( t_event );
+            }
+
+            // the owner kept writing while we copied, drop what it may have
+            // overwritten, including the slot of the event it is writing now
+            std::atomic_thread_fence( std::memory_order_acquire );
+            const uint64_t t_after = t_ring->head.load( std::memory_order_relaxed );
+            const uint64_t t_valid = t_after + 1 > CPU_PROFILER_RING ? t_after + 1 - CPU_PROFILER_RING : 0;
+            const size_t t_skip = t_valid > t_tail ? (size_t)std::min< uint64_t >( t_valid - t_tail, t_events.size() ) : 0;
+
+            for( size_t i = t_skip; i < t_events.size(); ++i )
+            {
+                ZoneHistory & t_zone = smZones[t_events[i].name];
+                t_zone.calls++;
+                t_zone.frame_ms += (double)( t_events[i].end - t_events[i].begin ) / 1000000.0;
+                append_trace( t_events[i], t_ring->thread );
+            }
+
+            t_ring->tail = t_head;
+        }
+
+        for( std::map< std::string, ZoneHistory >::iterator t_it = smZones.begin(); t_it != smZones.end(); ++t_it )
+        {
+            ZoneHistory & t_zone = t_it->second;
+            if( t_zone.samples.empty() )
+            {
+                t_zone.samples.resize( CPU_PROFILER_HISTORY_FRAMES );
+                t_zone.head = 0;
+                t_zone.count = 0;
+            }
+            t_zone.samples[t_zone.head] = t_zone.frame_ms;
+            t_zone.head = ( t_zone.head + 1 ) % CPU_PROFILER_HISTORY_FRAMES;
+            t_zone.count = std::min( t_zone.count + 1, (uint32_t)CPU_PROFILER_HISTORY_FRAMES );
+        }
+
+        // the frame itself shows up as a zone on its own track
+        if( smLastMark != 0 )
+        {
+            ZoneEvent t_frame;
+            t_frame.name = "frame";
+            t_frame.begin = smLastMark;
+            t_frame.end = t_now;
+            append_trace( t_frame, UINT32_MAX );
+        }
+        smLastMark = t_now;
+    }
+
+    std::vector< CpuZoneStats > cpuProfiler::getStats(void)
+    {
+        std::vector< CpuZoneStats > t_stats;
+
+        std::lock_guard< std::mutex > t_lock( smCollectMutex );
+        for( std::map< std::string, ZoneHistory >::iterator t_it = smZones.begin(); t_it != smZones.end(); ++t_it )
+        {
+            const ZoneHistory & t_zone = t_it->second;
+
+            CpuZoneStats t_entry;
+            t_entry.name = t_it->first;
+            t_entry.calls = t_zone.calls;
+            t_entry.frame_ms = t_zone.frame_ms;
+            t_entry.avg_ms = 0.0;
+            t_entry.max_ms = 0.0;
+            for( uint32_t i = 0; i < t_zone.count; ++i )
+            {
+                t_entry.avg_ms += t_zone.samples[i];
+                t_entry.max_ms = std::max( t_entry.max_ms, t_zone.samples[i] );
+            }
+            if( t_zone.count > 0 )
+            {
+                t_entry.avg_ms /= t_zone.count;
+            }
+
+            t_stats.push_back( t_entry );
+        }
+
+        return t_stats;
+    }
+
+    bool cpuProfiler::dumpTrace( const std::string & p_path )
+    {
+        FILE * t_file = fopen( p_path.c_str(), "w" );
+        if( !t_file )
+        {
+            LOG.error( "cpu profiler: cannot open {0}", p_path );
+            return true;
+        }
+
+        std::lock_guard< std::mutex > t_lock( smCollectMutex );
+
+        // startup zones predate the first frame, so the trace starts at the oldest event
+        uint64_t t_origin = UINT64_MAX;
+        for( size_t i = 0; i < smTrace.size(); ++i )
+        {
+            if( smTrace[i].event.name )
+            {
+                t_origin = std::min( t_origin, smTrace[i].event.begin );
+            }
+        }
+
+        fprintf( t_file, "{\"traceEvents\":[" );
+        bool t_first = true;
+        for( size_t i = 0; i < smTrace.size(); ++i )
+        {
+            const TraceEvent & t_trace = smTrace[( smTraceHead + i ) % smTrace.size()];
+            if( !t_trace.event.name )
+            {
+                continue;
+            }
+
+            fprintf( t_file, "%s\n{\"name\":\"", t_first ? "" : "," );
+            for( const char * t_c = t_trace.event.name; *t_c; ++t_c )
+            {
+                if( *t_c == '"' || *t_c == '\\' )
+                {
+                    fputc( '\\', t_file );
+                }
+                fputc( *t_c, t_file );
+            }
+            fprintf( t_file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%lld,\"ts\":%.3f,\"dur\":%.3f}",
+                     t_trace.thread == UINT32_MAX ? -1ll : (long long)t_trace.thread,
+                     (double)( t_trace.event.begin - t_origin ) / 1000.0,
+                     (double)( t_trace.event.end - t_trace.event.begin ) / 1000.0 );
+            t_first = false;
+        }
+        fprintf( t_file, "\n],\"displayTimeUnit\":\"ms\"}\n" );
+
+        if( fclose( t_file ) != 0 )
+        {
+            LOG.error( "cpu profiler: cannot write {0}", p_path );
+            return true;
+        }
+        return false;
+    }
+}
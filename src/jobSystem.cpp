@@ -0,0 +1,359 @@
+#include "jobSystem.h"
+
+#include "log.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ROOT_SPACE
+{
+    struct jobSystem::Job
+    {
+        JobFunc func;
+        JobHandle parent;
+        std::atomic< int32_t > unfinished;   // itself plus unfinished children
+    };
+
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque< jobSystem::JobHandle > jobs;
+    };
+
+    // queue 0 takes the submissions of threads outside the system, the
+    // others belong to one worker each
+    static std::vector< WorkQueue * > smQueues;
+    static std::vector< std::thread > smWorkers;
+    static std::atomic< uint32_t > smWorkerCount( 0 );
+    static std::atomic< bool > smRunning( false );
+    static std::atomic< bool > smQuit( false );
+    static std::mutex smStateMutex;
+
+    // idle workers sleep until something is queued
+    static std::atomic< uint32_t > smQueued( 0 );
+    static std::atomic< uint32_t > smSleepers( 0 );
+    static std::mutex smSleepMutex;
+    static std::condition_variable smWake;
+
+    // threads outside the system sleep in wait until a job finishes
+    static std::atomic< uint32_t > smWaiters( 0 );
+    static std::mutex smDoneMutex;
+    static std::condition_variable smDone;
+
+    static thread_local uint32_t smThreadIndex = 0;
+    static thread_local jobSystem::JobHandle smCurrent;
+
+    static void ensure_running(void)
+    {
+        if( !smRunning.load( std::memory_order_acquire ) )
+        {
+            jobSystem::init();
+        }
+    }
+
+    static void push( const jobSystem::JobHandle & p_job )
+    {
+        WorkQueue * t_queue = smQueues[smThreadIndex];
+        {
+            std::lock_guard< std::mutex > t_lock( t_queue->mutex );
+            t_queue->jobs.push_back( p_job );
+        }
+
+        // pairs with the sleeper count in worker_main, one of the two sides
+        // always sees the other so no wake up is lost
+        smQueued.fetch_add( 1 );
+        if( smSleepers.load() > 0 )
+        {
+            std::lock_guard< std::mutex > t_lock( smSleepMutex );
+            smWake.notify_one();
+        }
+    }
+
+    static bool pop_back( WorkQueue * p_queue, jobSystem::JobHandle & p_job )
+    {
+        std::lock_guard< std::mutex > t_lock( p_queue->mutex );
+        if( p_queue->jobs.empty() )
+        {
+            return false;
+        }
+        p_job = p_queue->jobs.back();
+        p_queue->jobs.pop_back();
+        return true;
+    }
+
+    static bool pop_front( WorkQueue * p_queue, jobSystem::JobHandle & p_job )
+    {
+        std::lock_guard< std::mutex > t_lock( p_queue->mutex );
+        if( p_queue->jobs.empty() )
+        {
+            return false;
+        }
+        p_job = p_queue->jobs.front();
+        p_queue->jobs.pop_front();
+        return true;
+    }
+
+    // own queue newest first while it is hot in cache, then the shared
+    // queue, then the oldest (and usually largest) job of another worker
+    static bool take( jobSystem::JobHandle & p_job )
+    {
+        if( smQueued.load( std::memory_order_relaxed ) == 0 )
+        {
+            return false;
+        }
+
+        const uint32_t t_count = (uint32_t)smQueues.size();
+        bool t_found = pop_back( smQueues[smThreadIndex], p_job ) || pop_front( smQueues[0], p_job );
+
+        for( uint32_t i = 1; i < t_count && !t_found; ++i )
+        {
+            const uint32_t t_victim = ( smThreadIndex + i ) % t_count;
+            t_found = t_victim != 0 && pop_front( smQueues[t_victim], p_job );
+        }
+
+        if( t_found )
+        {
+            smQueued.fetch_sub( 1 );
+        }
+        return t_found;
+    }
+
+    static void finish( jobSystem::Job * p_job )
+    {
+        bool t_finished = false;
+        while( p_job && p_job->unfinished.fetch_sub( 1 ) == 1 )
+        {
+            p_job = p_job->parent.get();
+            t_finished = true;
+        }
+
+        if( t_finished && smWaiters.load() > 0 )
+        {
+            std::lock_guard< std::mutex > t_lock( smDoneMutex );
+            smDone.notify_all();
+        }
+    }
+
+    static void execute( const jobSystem::JobHandle & p_job )
+    {
+        jobSystem::JobHandle t_previous = smCurrent;
+        smCurrent = p_job;
+
+        if( p_job->func )
+        {
+            p_job->func();
+        }
+
+        smCurrent = t_previous;
+        finish( p_job.get() );
+    }
+
+    static void worker_main( uint32_t p_index )
+    {
+        smThreadIndex = p_index;
+
+        for( ;; )
+        {
+            jobSystem::JobHandle t_job;
+            if( take( t_job ) )
+            {
+                execute( t_job );
+                continue;
+            }
+
+            smSleepers.fetch_add( 1 );
+            {
+                std::unique_lock< std::mutex > t_lock( smSleepMutex );
+                smWake.wait( t_lock, []() { return smQueued.load() > 0 || smQuit.load(); } );
+            }
+            smSleepers.fetch_sub( 1 );
+
+            if( smQuit.load() && smQueued.load() == 0 )
+            {
+                return;
+            }
+        }
+    }
+
+    bool jobSystem::init( const uint32_t p_workers )
+    {
+        std::lock_guard< std::mutex > t_lock( smStateMutex );
+
+        if( smRunning.load() )
+        {
+            // the lazy start raced with an explicit one, which is fine
+            if( p_workers != 0 && p_workers != smWorkerCount.load() )
+            {
+                LOG.error( "jobSystem Failure: already running with {0} workers", smWorkerCount.load() );
+                return true;
+            }
+            return false;
+        }
+
+        uint32_t t_workers = p_workers;
+        if( t_workers == 0 )
+        {
+            const uint32_t t_cores = std::thread::hardware_concurrency();
+            // at least one, jobs nobody waits on still have to run
+            t_workers = t_cores > 2 ? t_cores - 1 : 1;
+        }
+
+        smQuit = false;
+        smQueued = 0;
+        for( uint32_t i = 0; i <= t_workers; ++i )
+        {
+            smQueues.push_back( new WorkQueue() );
+        }
+        smWorkerCount = t_workers;
+
+        for( uint32_t i = 1; i <= t_workers; ++i )
+        {
+            smWorkers.push_back( std::thread( worker_main, i ) );
+        }
+
+        smRunning.store( true, std::memory_order_release );
+        return false;
+    }
+
+    void jobSystem::shutdown(void)
+    {
+        std::lock_guard< std::mutex > t_lock( smStateMutex );
+
+        if( !smRunning.load() )
+        {
+            return;
+        }
+
+        {
+            std::lock_guard< std::mutex > t_sleep( smSleepMutex );
+            smQuit = true;
+        }
+        smWake.notify_all();
+
+        for( size_t i = 0; i < smWorkers.size(); ++i )
+        {
+            smWorkers[i].join();
+        }
+        smWorkers.clear();
+
+        for( size_t i = 0; i < smQueues.size(); ++i )
+        {
+            delete smQueues[i];
+        }
+        smQueues.clear();
+
+        smWorkerCount = 0;
+        smRunning.store( false, std::memory_order_release );
+    }
+
+    // joinable threads in smWorkers would terminate the process at exit;
+    // declared last so it is destroyed before the state it tears down
+    static struct shutdownAtExit
+    {
+        ~shutdownAtExit(void)
+        {
+            jobSystem::shutdown();
+        }
+    } smShutdownAtExit;
+
+    uint32_t jobSystem::workerCount(void)
+    {
+        ensure_running();
+        return smWorkerCount.load();
+    }
+
+    uint32_t jobSystem::threadIndex(void)
+    {
+        return smThreadIndex;
+    }
+
+    jobSystem::JobHandle jobSystem::run( const JobFunc & p_func, const JobHandle & p_parent )
+    {
+        ensure_running();
+
+        JobHandle t_job = std::make_shared< Job >();
+        t_job->func = p_func;
+        t_job->parent = p_parent;
+        t_job->unfinished.store( 1, std::memory_order_relaxed );
+
+        if( p_parent )
+        {
+            p_parent->unfinished.fetch_add( 1, std::memory_order_acq_rel );
+        }
+
+        push( t_job );
+        return t_job;
+    }
+
+    jobSystem::JobHandle jobSystem::current(void)
+    {
+        return smCurrent;
+    }
+
+    bool jobSystem::isFinished( const JobHandle & p_job )
+    {
+        return !p_job || p_job->unfinished.load( std::memory_order_acquire ) <= 0;
+    }
+
+    void jobSystem::wait( const JobHandle & p_job )
+    {
+        // other threads never run queued jobs: per thread resources such as
+        // command pools are indexed by threadIndex, and every outside
+        // thread shares index 0
+        if( smThreadIndex == 0 )
+        {
+            smWaiters.fetch_add( 1 );
+            {
+                std::unique_lock< std::mutex > t_lock( smDoneMutex );
+                smDone.wait( t_lock, [&p_job]() { return isFinished( p_job ); } );
+            }
+            smWaiters.fetch_sub( 1 );
+            return;
+        }
+
+        while( !isFinished( p_job ) )
+        {
+            JobHandle t_job;
+            if( take( t_job ) )
+            {
+                execute( t_job );
+            }else
+            {
+                // the remaining work is running on other threads
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void jobSystem::parallelFor( const uint32_t p_count, const uint32_t p_grain, const RangeFunc & p_func )
+    {
+        if( p_count == 0 )
+        {
+            return;
+        }
+
+        const uint32_t t_threads = workerCount() + 1;
+        const uint32_t t_grain = p_grain ? p_grain : std::max( 1u, p_count / ( t_threads * 4 ) );
+
+        // the root is never queued, it only collects the ranges
+        JobHandle t_root = std::make_shared< Job >();
+        t_root->unfinished.store( 1, std::memory_order_relaxed );
+
+        for( uint32_t t_begin = t_grain; t_begin < p_count; t_begin += t_grain )
+        {
+            const uint32_t t_end = std::min( p_count, t_begin + t_grain );
+            const RangeFunc * t_func = &p_func;
+            run( [t_func, t_begin, t_end]() { ( *t_func )( t_begin, t_end ); }, t_root );
+        }
+
+        // the calling thread takes the first range itself
+        p_func( 0, std::min( p_count, t_grain ) );
+        finish( t_root.get() );
+
+        wait( t_root );
+    }
+}
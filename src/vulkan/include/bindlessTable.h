@@ -0,0 +1,70 @@
+#pragma once
+#ifndef __BINDLESS_TABLE_H__
+#define __BINDLESS_TABLE_H__
+
+#define GLFW_INCLUDE_NONE
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <mutex>
+#include <vector>
+
+#include "deletionQueue.h"
+
+// One update after bind descriptor set holding every texture (binding 0,
+// combined image samplers) and storage buffer (binding 1) the application
+// registered. Shaders index the arrays with values passed in push
+// constants, so draws never allocate or bind sets of their own. Slots are
+// written in place while the set is bound; a released slot is only handed
+// out again once the frames that could still read it have completed.
+class bindlessTable
+{
+public:
+    bindlessTable(void);
+
+    // p_imageCount and p_bufferCount are already clamped to the device limits
+    bool init( VkDevice p_device, deletionQueue * p_retired, uint32_t p_imageCount, uint32_t p_bufferCount );
+    void destroy(void);
+
+    bool ready(void) const;
+
+    VkDescriptorSet set(void) const;
+    VkDescriptorSetLayout setLayout(void) const;
+    // the set at index 0 and BINDLESS_PUSH_CONSTANT_BYTES for all stages
+    VkPipelineLayout pipelineLayout(void) const;
+
+    // BINDLESS_NONE once the array is full
+    uint32_t addImage( VkImageView p_view, VkSampler p_sampler, VkImageLayout p_layout );
+    uint32_t addBuffer( VkBuffer p_buffer, VkDeviceSize p_offset, VkDeviceSize p_range );
+    void releaseImage( uint32_t p_index );
+    void releaseBuffer( uint32_t p_index );
+
+private:
+    // indices below next were handed out before, free holds the released
+    // ones and used marks those currently handed out
+    struct Slots
+    {
+        uint32_t capacity;
+        uint32_t next;
+        std::vector< uint32_t > free;
+        std::vector< bool > used;
+    };
+
+    // take runs under mMutex, give locks it itself since the retired
+    // closure may run at once and lock it again
+    uint32_t take( Slots & p_slots );
+    void give( Slots & p_slots, uint32_t p_index, const char * p_kind );
+
+    VkDevice mDevice;
+    deletionQueue * mRetired;
+
+    VkDescriptorSetLayout mSetLayout;
+    VkDescriptorPool mPool;
+    VkDescriptorSet mSet;
+    VkPipelineLayout mPipelineLayout;
+
+    Slots mImages;
+    Slots mBuffers;
+    std::mutex mMutex;
+};
+
+#endif //__BINDLESS_TABLE_H__
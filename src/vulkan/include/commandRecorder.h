@@ -0,0 +1,72 @@
+#pragma once
+#ifndef __COMMAND_RECORDER_H__
+#define __COMMAND_RECORDER_H__
+
+#define GLFW_INCLUDE_NONE
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <mutex>
+#include <vector>
+#include <functional>
+
+// Records secondary command buffers as jobs on the shared jobSystem. Every
+// job system thread (index 0 stands for the threads outside it, which take
+// turns on it) owns one command pool per frame slot, so no pool is ever
+// touched by two threads at once and a slot's pools are only reset once
+// that frame's fence has signaled.
+class commandRecorder
+{
+public:
+    typedef std::function< void( VkCommandBuffer p_cmd, uint32_t p_task ) > RecordFunc;
+
+    commandRecorder(void);
+
+    // p_maxChunks caps how many secondary buffers one record() splits into
+    bool init( VkDevice p_device, uint32_t p_queueFamily, uint32_t p_frameCount, uint32_t p_maxChunks );
+    void destroy(void);
+
+    // call after the slot's fence wait, before any record() for that frame
+    void beginFrame( uint32_t p_frameSlot );
+
+    // splits [0, p_taskCount) into contiguous chunks, records each into its
+    // own secondary buffer on whichever thread picks it up and executes
+    // them from p_primary in task order
+    bool record( VkCommandBuffer p_primary, const VkCommandBufferInheritanceInfo * p_inheritance,
+                 uint32_t p_taskCount, const RecordFunc & p_func );
+
+    uint32_t participants(void) const;
+
+private:
+    struct FramePool
+    {
+        VkCommandPool pool;
+        std::vector< VkCommandBuffer > buffers;
+        uint32_t used;
+    };
+
+    struct Participant
+    {
+        std::vector< FramePool > frames;
+    };
+
+    struct Job
+    {
+        const VkCommandBufferInheritanceInfo * inheritance;
+        const RecordFunc * func;
+        uint32_t task_count;
+        uint32_t chunk_count;
+        std::vector< VkCommandBuffer > results;
+        std::vector< VkResult > errors;
+    };
+
+    void record_chunk( uint32_t p_chunk, Job & p_job );
+    VkCommandBuffer next_buffer( uint32_t p_thread );
+
+    VkDevice mDevice;
+    uint32_t mFrameSlot;
+    uint32_t mMaxChunks;
+    std::vector< Participant > mParticipants;
+    std::mutex mOutsideMutex;       // threads outside the job system share participant 0
+};
+
+#endif //__COMMAND_RECORDER_H__
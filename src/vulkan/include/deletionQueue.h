@@ -0,0 +1,62 @@
+#pragma once
+#ifndef __DELETION_QUEUE_H__
+#define __DELETION_QUEUE_H__
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Device objects whose destruction waits until the graphics queue is done
+// with every frame that could still use them. Frame submissions are
+// numbered in queue order, so one completed number covers every earlier
+// submission. Objects retired while frames are being recorded are stamped
+// once the last of those frames has been submitted. Work submitted to the
+// compute and transfer queues is not tracked.
+class deletionQueue
+{
+public:
+    typedef std::function< void( void ) > DestroyFunc;
+
+    deletionQueue(void);
+
+    // p_recorder identifies a render target, one frame each at a time
+    void beginRecording( const void * p_recorder );
+    // the target's recording ended without a submit
+    void endRecording( const void * p_recorder );
+    // call under the queue lock right before vkQueueSubmit, returns the
+    // serial whose completion the submit's fence will report
+    uint64_t submit( const void * p_recorder );
+
+    // p_owner tags objects only the owner's frames use, see release
+    void retire( const DestroyFunc & p_destroy, const void * p_owner = nullptr );
+    // destroys p_owner's objects now, once all of its frames are known done
+    void release( const void * p_owner );
+
+    // every submit up to p_serial has finished on the gpu
+    void completed( uint64_t p_serial );
+    // the device is idle, destroys everything
+    void flush(void);
+
+private:
+    struct Entry
+    {
+        DestroyFunc destroy;
+        const void * owner;
+        uint64_t serial;
+        std::vector< const void * > waiting;     // recordings still to be submitted
+    };
+
+    void stamp( const void * p_recorder, std::vector< DestroyFunc > & p_now );
+    void run( std::vector< DestroyFunc > & p_destroy );
+
+    std::mutex mMutex;
+    std::vector< const void * > mRecording;
+    std::vector< Entry > mPending;
+    std::deque< Entry > mStamped;       // ascending serials
+    uint64_t mSubmitted;
+    uint64_t mCompleted;
+};
+
+#endif //__DELETION_QUEUE_H__
@@ -0,0 +1,41 @@
+#pragma once
+#ifndef __DESCRIPTOR_CACHE_H__
+#define __DESCRIPTOR_CACHE_H__
+
+#define GLFW_INCLUDE_NONE
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Descriptor set layouts keyed by their bindings, so equal layouts asked
+// for in different places are the same handle, together with the pool
+// sizes one set of each needs. Layouts live until destroy.
+class descriptorCache
+{
+public:
+    descriptorCache(void);
+
+    bool init( VkDevice p_device );
+    void destroy(void);
+
+    // VK_NULL_HANDLE if creation failed
+    VkDescriptorSetLayout layout( const std::vector< VkDescriptorSetLayoutBinding > & p_bindings );
+    // what one set of p_layout takes from a pool, true for unknown layouts
+    bool poolSizes( VkDescriptorSetLayout p_layout, std::vector< VkDescriptorPoolSize > & p_sizes );
+
+private:
+    struct Entry
+    {
+        VkDescriptorSetLayout layout;
+        std::vector< VkDescriptorPoolSize > sizes;
+    };
+
+    VkDevice mDevice;
+    std::map< std::vector< uint64_t >, Entry > mLayouts;
+    std::map< VkDescriptorSetLayout, std::vector< VkDescriptorPoolSize > > mSizes;
+    std::mutex mMutex;
+};
+
+#endif //__DESCRIPTOR_CACHE_H__
@@ -0,0 +1,57 @@
+#pragma once
+#ifndef __DESCRIPTOR_POOLS_H__
+#define __DESCRIPTOR_POOLS_H__
+
+#define GLFW_INCLUDE_NONE
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "descriptorCache.h"
+
+// Per frame descriptor sets. Every job system thread (index 0 stands for
+// the threads outside it) owns, per frame slot, a chain of pools for each
+// layout, sized for that layout alone so they never fragment. Nothing is
+// freed set by set: a slot's pools are reset in bulk once its fence has
+// signaled and refilled from the start.
+class descriptorPools
+{
+public:
+    descriptorPools(void);
+
+    bool init( VkDevice p_device, descriptorCache * p_cache, uint32_t p_frameCount );
+    void destroy(void);
+
+    // call after the slot's fence wait
+    void beginFrame( uint32_t p_frameSlot );
+
+    // VK_NULL_HANDLE if the layout is not from the cache or allocation failed
+    VkDescriptorSet alloc( VkDescriptorSetLayout p_layout );
+
+private:
+    struct Chain
+    {
+        std::vector< VkDescriptorPool > pools;
+        size_t current;
+        bool used;
+    };
+
+    typedef std::map< VkDescriptorSetLayout, Chain > Chains;
+
+    struct Participant
+    {
+        std::vector< Chains > frames;
+    };
+
+    bool grow( VkDescriptorSetLayout p_layout, Chain & p_chain );
+
+    VkDevice mDevice;
+    descriptorCache * mCache;
+    uint32_t mFrameSlot;
+    std::vector< Participant > mParticipants;
+    std::mutex mOutsideMutex;       // threads outside the job system share participant 0
+};
+
+#endif //__DESCRIPTOR_POOLS_H__
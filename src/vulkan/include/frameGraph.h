@@ -0,0 +1,150 @@
+#pragma once
+#ifndef __FRAME_GRAPH_H__
+#define __FRAME_GRAPH_H__
+
+#define GLFW_INCLUDE_NONE
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <functional>
+#include <vector>
+
+#include "graphPass.h"
+#include "vulkanAllocator.h"
+#include "gpuProfiler.h"
+#include "deletionQueue.h"
+
+// Passes declare the images and buffers they touch and are recorded in
+// the order they were added. execute drops passes whose results nothing
+// uses, derives one batched barrier per pass from the tracked resource
+// states and places transients whose lifetimes do not overlap in the same
+// memory. The passes are declared anew every frame, the memory behind the
+// transients is kept as long as their descriptions stay the same and is
+// retired through the deletion queue once they change.
+class frameGraph
+{
+public:
+    typedef std::function< void( VkCommandBuffer p_cmd ) > PassFunc;
+
+    frameGraph(void);
+
+    bool init( VkDevice p_device, vulkanAllocator * p_allocator, deletionQueue * p_retired );
+    void destroy(void);
+
+    // forgets the previous frame's passes and resources
+    void beginFrame(void);
+
+    // the graph only orders work inside the frame, p_initialStages is where
+    // the image's previous use must be done before its first transition
+    // (the acquire semaphore's wait stage for swapchain images) and
+    // p_initialAccess the writes of that use to make available.
+    // VK_IMAGE_LAYOUT_UNDEFINED as p_finalLayout keeps the last used layout
+    ROOT_SPACE::GraphResource importImage( const char * p_name, VkImage p_image, VkImageView p_view, VkFormat p_format,
+                                           const VkExtent2D & p_extent, VkImageLayout p_initialLayout, VkImageLayout p_finalLayout,
+                                           VkPipelineStageFlags p_initialStages = 0, VkAccessFlags p_initialAccess = 0 );
+    ROOT_SPACE::GraphResource importBuffer( const char * p_name, VkBuffer p_buffer, VkDeviceSize p_size );
+    // contents do not survive the frame, usage flags come from the passes
+    ROOT_SPACE::GraphResource createImage( const char * p_name, VkFormat p_format, const VkExtent2D & p_extent );
+    ROOT_SPACE::GraphResource createBuffer( const char * p_name, VkDeviceSize p_size );
+
+    // passes writing an imported resource or with p_keep set are never culled
+    bool addPass( const char * p_name, const std::vector< ROOT_SPACE::GraphAccess > & p_accesses, const PassFunc & p_func, bool p_keep );
+
+    bool empty(void) const;
+
+    // records every live pass into p_cmd; p_profiler may be null
+    bool execute( VkCommandBuffer p_cmd, gpuProfiler * p_profiler );
+
+    // valid inside pass callbacks, transients have no handle before that
+    VkImage image( ROOT_SPACE::GraphResource p_resource ) const;
+    VkImageView view( ROOT_SPACE::GraphResource p_resource ) const;
+    VkBuffer buffer( ROOT_SPACE::GraphResource p_resource ) const;
+
+    ROOT_SPACE::GraphStats stats(void) const;
+
+private:
+    struct Resource
+    {
+        const char * name;
+        bool is_image;
+        bool imported;
+        VkFormat format;
+        VkExtent2D extent;
+        VkDeviceSize size;
+        VkImage image;
+        VkImageView view;
+        VkBuffer buffer;
+        VkImageLayout initial_layout;
+        VkImageLayout final_layout;
+        VkPipelineStageFlags initial_stages;
+        VkAccessFlags initial_access;
+        VkFlags usage;              // image or buffer usage bits of all its accesses
+        uint32_t first_pass;        // live passes only, UINT32_MAX when unused
+        uint32_t last_pass;
+        uint32_t physical;          // index into Realized::physicals for transients
+    };
+
+    struct Pass
+    {
+        const char * name;
+        std::vector< ROOT_SPACE::GraphAccess > accesses;
+        PassFunc func;
+        bool keep;
+    };
+
+    // where the previous user of a piece of memory left off, the next
+    // resource placed there has to wait for it before reusing the memory
+    struct Slot
+    {
+        MemoryAllocation mem;
+        VkDeviceSize size;
+        VkDeviceSize alignment;
+        uint32_t type_bits;
+        bool is_image;
+        VkPipelineStageFlags tail_stages;
+        VkAccessFlags tail_access;
+        std::vector< uint32_t > members;
+    };
+
+    struct Physical
+    {
+        VkImage image;
+        VkImageView view;
+        VkBuffer buffer;
+        VkMemoryRequirements reqs;
+        uint32_t slot;
+    };
+
+    struct Realized
+    {
+        std::vector< Physical > physicals;
+        std::vector< Slot > slots;
+    };
+
+    // layout and synchronization state of one resource while recording
+    struct State
+    {
+        VkImageLayout layout;
+        VkPipelineStageFlags write_stages;
+        VkAccessFlags write_access;
+        VkPipelineStageFlags read_stages;   // stages the last write is visible to
+        VkAccessFlags read_access;
+    };
+
+    void cull( std::vector< uint32_t > & p_live );
+    bool realize( const std::vector< uint32_t > & p_transients );
+    static void release( VkDevice p_device, vulkanAllocator * p_allocator, Realized & p_realized );
+
+    VkDevice mDevice;
+    vulkanAllocator * mAllocator;
+    deletionQueue * mRetired;
+
+    std::vector< Resource > mResources;
+    std::vector< Pass > mPasses;
+
+    Realized mRealized;
+    std::vector< uint64_t > mRealizedKey;
+
+    ROOT_SPACE::GraphStats mStats;
+};
+
+#endif //__FRAME_GRAPH_H__
@@ -0,0 +1,82 @@
+#pragma once
+#ifndef __GPU_PROFILER_H__
+#define __GPU_PROFILER_H__
+
+#define GLFW_INCLUDE_NONE
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "gpuProfile.h"
+
+// Timestamp queries around command buffer regions. Each frame slot owns
+// its own query pool, and a slot is only read back after its fence has
+// signaled, so results are always available and nothing waits on the gpu.
+class gpuProfiler
+{
+public:
+    typedef struct {
+        const char * name;
+        double begin_us;
+        double duration_us;
+    } TraceEvent;
+
+    gpuProfiler(void);
+
+    // p_validBits is the queue family's timestampValidBits, 0 disables profiling
+    bool init( VkDevice p_device, const VkPhysicalDeviceLimits & p_limits, uint32_t p_validBits, uint32_t p_frameCount );
+    void destroy(void);
+
+    // call after the slot's fence wait with the frame's primary buffer in
+    // the recording state: collects the slot's last results and resets it
+    void beginFrame( uint32_t p_frameSlot, VkCommandBuffer p_cmd );
+    void endFrame(void);
+
+    // safe from several recording threads at once; p_name must outlive
+    // the profiler, string literals are the intended use
+    uint32_t begin( VkCommandBuffer p_cmd, const char * p_name );
+    void end( VkCommandBuffer p_cmd, uint32_t p_scope );
+
+    // safe from any thread while frames are being collected
+
+    void stats( std::vector< ROOT_SPACE::GpuPassStats > & p_out ) const;
+    void trace( std::vector< TraceEvent > & p_out ) const;
+
+private:
+    struct FrameQueries
+    {
+        VkQueryPool pool;
+        std::vector< const char * > names;
+        uint32_t used;
+    };
+
+    struct PassHistory
+    {
+        std::vector< double > samples;
+        uint32_t head;
+        uint32_t count;
+    };
+
+    void collect( FrameQueries & p_frame );
+
+    VkDevice mDevice;
+    double mPeriod;
+    uint64_t mMask;
+    uint32_t mCapacity;
+    uint32_t mFrameSlot;
+    std::vector< FrameQueries > mFrames;
+    std::atomic< uint32_t > mUsed;
+
+    // guards the results below, read by stats and trace from other threads
+    mutable std::mutex mMutex;
+    uint64_t mOrigin;
+    std::map< std::string, PassHistory > mHistory;
+    std::vector< TraceEvent > mTrace;
+    uint32_t mTraceHead;
+};
+
+#endif //__GPU_PROFILER_H__
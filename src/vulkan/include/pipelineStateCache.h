@@ -0,0 +1,113 @@
+#pragma once
+#ifndef __PIPELINE_STATE_CACHE_H__
+#define __PIPELINE_STATE_CACHE_H__
+
+#define GLFW_INCLUDE_NONE
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "pipelineState.h"
+#include "jobSystem.h"
+#include "shaderCache.h"
+#include "deletionQueue.h"
+
+// handles index chunks of entries that never move once created
+#define PIPELINE_CHUNK_SIZE 256
+#define PIPELINE_MAX_CHUNKS 256
+#define PIPELINE_SHARDS 16
+
+// Pipelines looked up by their whole PipelineState. The states are
+// flattened into byte keys and spread over independently locked shards by
+// their hash, so recording threads rarely meet on a lock. A miss hands out
+// a handle right away and queues the compile for the job system; the
+// handle reads back VK_NULL_HANDLE (or the caller's fallback) until the
+// pipeline exists. At most half the workers compile at a time so frame
+// recording always finds threads. States naming shaders from the shader
+// cache compile once those are loaded and recompile when one is reloaded;
+// the new pipeline replaces the old one, which is retired.
+class pipelineStateCache
+{
+public:
+    pipelineStateCache(void);
+
+    bool init( VkDevice p_device, VkPipelineCache p_pipelineCache, shaderCache * p_shaders, deletionQueue * p_retired );
+    // waits for the compiles in flight, then destroys every pipeline
+    void destroy(void);
+
+    // never blocks on compilation
+    ROOT_SPACE::PipelineStateHandle request( const ROOT_SPACE::PipelineState & p_state );
+    VkPipeline pipeline( ROOT_SPACE::PipelineStateHandle p_handle, VkPipeline p_fallback ) const;
+    ROOT_SPACE::PipelineStatus status( ROOT_SPACE::PipelineStateHandle p_handle ) const;
+
+    // returns once nothing is queued or compiling, for loading screens
+    void wait(void);
+
+    // p_shader has a new module, rebuilds every pipeline made from it
+    void shaderChanged( ROOT_SPACE::ShaderHandle p_shader );
+
+private:
+    struct Entry
+    {
+        ROOT_SPACE::PipelineState state;
+        std::atomic< VkPipeline > pipeline;
+        std::atomic< int > status;
+        std::atomic< uint32_t > generation;     // bumped per queued compile, older results are dropped
+    };
+
+    struct Key
+    {
+        uint64_t hash;
+        std::string bytes;
+        bool operator==( const Key & p_other ) const { return hash == p_other.hash && bytes == p_other.bytes; }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()( const Key & p_key ) const { return (size_t)p_key.hash; }
+    };
+
+    struct Shard
+    {
+        std::mutex mutex;
+        std::unordered_map< Key, ROOT_SPACE::PipelineStateHandle, KeyHash > handles;
+    };
+
+    static Key makeKey( const ROOT_SPACE::PipelineState & p_state );
+    Entry * entry( ROOT_SPACE::PipelineStateHandle p_handle ) const;
+    void enqueue( ROOT_SPACE::PipelineStateHandle p_handle );
+    void drain(void);
+    // the module of every stage, false while a shader is not loaded; on
+    // success the caller releases p_acquired once it is done compiling
+    bool resolve( const ROOT_SPACE::PipelineState & p_state, VkShaderModule * p_modules, VkShaderModule * p_acquired, bool & p_failed );
+    VkPipeline compile( const ROOT_SPACE::PipelineState & p_state, const VkShaderModule * p_modules );
+    void install( Entry & p_entry, uint32_t p_generation, VkPipeline p_pipeline );
+
+    VkDevice mDevice;
+    VkPipelineCache mPipelineCache;
+    shaderCache * mShaders;
+    deletionQueue * mRetired;
+
+    Shard mShards[PIPELINE_SHARDS];
+    std::atomic< Entry * > mChunks[PIPELINE_MAX_CHUNKS];
+    std::atomic< uint32_t > mCount;
+
+    // compile queue, drained by up to mMaxActive jobs
+    std::mutex mQueueMutex;
+    std::deque< ROOT_SPACE::PipelineStateHandle > mQueue;
+    uint32_t mActive;
+    uint32_t mMaxActive;
+    std::vector< ROOT_SPACE::jobSystem::JobHandle > mJobs;
+
+    std::mutex mDependMutex;
+    std::map< ROOT_SPACE::ShaderHandle, std::vector< ROOT_SPACE::PipelineStateHandle > > mDependents;
+    std::mutex mInstallMutex;
+};
+
+#endif //__PIPELINE_STATE_CACHE_H__
@@ -0,0 +1,101 @@
+#pragma once
+#ifndef __RENDER_CONTEXT_H__
+#define __RENDER_CONTEXT_H__
+
+#define GLFW_INCLUDE_NONE
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <mutex>
+#include <vector>
+
+#ifndef ROOT_SPACE
+#define ROOT_SPACE ws
+#endif //ROOT_SPACE
+
+#include "window.h"
+#include "vulkanAllocator.h"
+#include "commandRecorder.h"
+#include "gpuProfiler.h"
+#include "frameGraph.h"
+#include "stagingRing.h"
+#include "uniformRing.h"
+#include "descriptorPools.h"
+
+typedef struct {
+    VkImage image;
+    VkCommandBuffer cmd;
+    VkImageView view;
+} SwapchainBuffers;
+
+// one slot of the frames in flight ring, the cpu records into a slot only
+// after its fence reports the gpu is done with the previous use
+typedef struct {
+    VkCommandPool cmd_pool;
+    VkCommandBuffer cmd;
+    VkCommandBuffer upload_cmd;     // staging copies, submitted ahead of cmd
+    VkFence fence;
+    VkSemaphore acquire_semaphore;
+    VkSemaphore render_semaphore;
+    uint64_t serial;            // deletionQueue number of the last submit
+} FrameData;
+
+// Everything a window (or the headless target) renders into. All contexts
+// share the device and queue in vulkanInfo but own their swapchain, images,
+// frame graph and frame ring, so windows never clobber each other.
+class renderContext
+{
+public:
+    GLFWwindow * handle;            // null for the headless context
+    VkSurfaceKHR surface;
+    ROOT_SPACE::PresentPolicy policy;
+
+    VkFormat format;
+    VkColorSpaceKHR color_space;
+    VkExtent2D extent;
+    VkPresentModeKHR present_mode;
+
+    uint32_t swapchainImageCount;
+    VkSwapchainKHR swapchain;
+
+    // in headless mode buffers holds device local render targets instead
+    // of swapchain images, their memory lives in offscreen_mem
+    SwapchainBuffers *buffers;
+    MemoryAllocation *offscreen_mem;
+
+    uint32_t current_buffer;
+
+    FrameData *frames;
+    uint32_t frame_count;
+    uint32_t frame_index;
+
+    commandRecorder recorder;
+    gpuProfiler profiler;
+    stagingRing staging;
+    uniformRing uniforms;
+    descriptorPools descriptors;
+
+    // depth and other size dependent targets are transients of the graph
+    frameGraph graph;
+    ROOT_SPACE::GraphResource graph_backbuffer;     // imported on first use each frame
+
+    // set by endFrame, cleared once VGraphical::present has queued the image
+    bool present_pending;
+    FrameData * present_frame;
+
+    // semaphores from other queues the next endFrame submit waits on,
+    // handed over from any thread under frame_waits_mutex
+    std::mutex frame_waits_mutex;
+    std::vector< VkSemaphore > frame_waits;
+    std::vector< VkPipelineStageFlags > frame_wait_stages;
+
+    // resize events only raise this flag, the swapchain is rebuilt once at
+    // the start of the next frame however many events arrived
+    bool resize_pending;
+    // what the swapchain is rebuilt for where the surface leaves the
+    // extent to us; only the event thread may ask glfw, so it hands it over
+    glm::ivec2 framebuffer_size;
+
+    renderContext(void);
+};
+
+#endif //__RENDER_CONTEXT_H__
@@ -0,0 +1,97 @@
+#pragma once
+#ifndef __SHADER_CACHE_H__
+#define __SHADER_CACHE_H__
+
+#define GLFW_INCLUDE_NONE
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shaderHandle.h"
+#include "jobSystem.h"
+
+// SPIR-V files mapped into memory and turned into shader modules on the
+// job system. Modules are keyed by a hash of the bytecode, so files with
+// the same contents share one and a reload that changes nothing makes
+// none. Pipelines acquire a module for the time they compile; a module
+// goes once neither a shader nor a compile holds it. With watching on, a
+// thread polls the files' size and modification time and queues a reload
+// for each one that changed, p_changed then tells the owner of every
+// shader that has a new module.
+class shaderCache
+{
+public:
+    typedef std::function< void( ROOT_SPACE::ShaderHandle p_shader ) > ChangedFunc;
+
+    shaderCache(void);
+
+    bool init( VkDevice p_device, const ChangedFunc & p_changed );
+    // stops watching, waits for the loads in flight and destroys every module
+    void destroy(void);
+
+    // never blocks, the file is read on a job system thread
+    ROOT_SPACE::ShaderHandle load( const std::string & p_path );
+    ROOT_SPACE::ShaderStatus status( ROOT_SPACE::ShaderHandle p_shader );
+
+    // the shader's current module, VK_NULL_HANDLE unless it is ready;
+    // valid until the matching release
+    VkShaderModule acquire( ROOT_SPACE::ShaderHandle p_shader );
+    void release( VkShaderModule p_module );
+
+    // returns once no load is queued or running
+    void wait(void);
+
+    // p_interval is the time between two polls of all files
+    void watch( bool p_enable, uint32_t p_intervalMs );
+
+private:
+    struct Module
+    {
+        VkShaderModule module;
+        uint32_t refs;
+    };
+
+    struct Shader
+    {
+        std::string path;
+        VkShaderModule module;
+        uint64_t hash;
+        ROOT_SPACE::ShaderStatus status;
+        bool loading;
+        int64_t mtime;          // what the file looked like when it was last queued
+        int64_t size;
+    };
+
+    void queue( ROOT_SPACE::ShaderHandle p_shader );
+    void reload( ROOT_SPACE::ShaderHandle p_shader );
+    // callers hold mMutex
+    VkShaderModule share( uint64_t p_hash );
+    void drop( VkShaderModule p_module );
+    void poll(void);
+    void watcherMain(void);
+
+    VkDevice mDevice;
+    ChangedFunc mChanged;
+
+    std::mutex mMutex;
+    std::vector< Shader > mShaders;
+    std::map< std::string, ROOT_SPACE::ShaderHandle > mPaths;
+    std::map< uint64_t, Module > mModules;              // by bytecode hash
+    std::map< VkShaderModule, uint64_t > mHashes;
+    std::vector< ROOT_SPACE::jobSystem::JobHandle > mJobs;
+
+    std::thread mWatcher;
+    std::mutex mWatchMutex;
+    std::condition_variable mWatchWake;
+    bool mWatchQuit;
+    uint32_t mInterval;
+};
+
+#endif //__SHADER_CACHE_H__
@@ -0,0 +1,91 @@
+#pragma once
+#ifndef __STAGING_RING_H__
+#define __STAGING_RING_H__
+
+#define GLFW_INCLUDE_NONE
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "vulkanAllocator.h"
+
+// One host visible buffer, mapped for its whole life and split into a
+// region per frame in flight. Uploads are copied into the current frame's
+// region and remembered; record turns everything queued into one copy
+// call per destination framed by two batched barriers. A region is only
+// written again after the frame's fence wait, so nothing ever waits on the
+// gpu and no memory is allocated or mapped per upload.
+class stagingRing
+{
+public:
+    stagingRing(void);
+
+    bool init( VkDevice p_device, vulkanAllocator * p_allocator, const VkPhysicalDeviceMemoryProperties & p_memoryProperties,
+               const VkPhysicalDeviceLimits & p_limits, uint32_t p_frameCount, VkDeviceSize p_frameBytes );
+    void destroy(void);
+
+    // call after the slot's fence wait, opens its region for uploads
+    void beginFrame( uint32_t p_frameSlot );
+
+    // safe from several threads; true if the ring is closed or the
+    // region is out of space
+    bool uploadBuffer( VkBuffer p_dst, VkDeviceSize p_offset, const void * p_data, VkDeviceSize p_size );
+    // p_format is p_dst's, the offset is aligned to its texel block
+    bool uploadImage( VkImage p_dst, VkFormat p_format, const VkBufferImageCopy & p_region, const void * p_data,
+                      VkDeviceSize p_size, VkImageLayout p_oldLayout, VkImageLayout p_newLayout );
+
+    bool empty(void);
+    // ends the frame's uploads without recording, for frames that have none
+    void close(void);
+
+    // flushes the region when the memory is not coherent and records every
+    // queued copy into p_cmd; the region stays closed until the next
+    // beginFrame
+    void record( VkCommandBuffer p_cmd );
+
+private:
+    struct BufferCopy
+    {
+        VkBuffer dst;
+        VkBufferCopy region;
+    };
+
+    struct ImageCopy
+    {
+        VkImage dst;
+        VkBufferImageCopy region;
+        VkImageLayout old_layout;
+        VkImageLayout new_layout;
+    };
+
+    // reserves p_size bytes in the open region, returns the ring offset
+    bool reserve( VkDeviceSize p_size, VkDeviceSize p_alignment, VkDeviceSize & p_offset );
+    void written(void);
+    void flush(void);
+
+    VkDevice mDevice;
+    vulkanAllocator * mAllocator;
+
+    VkBuffer mBuffer;
+    MemoryAllocation mMemory;
+    bool mCoherent;
+    VkDeviceSize mAtomSize;
+    VkDeviceSize mImageAlignment;
+
+    VkDeviceSize mFrameBytes;
+    VkDeviceSize mBegin;            // open region in ring offsets
+    VkDeviceSize mHead;
+    bool mOpen;
+
+    std::vector< BufferCopy > mBufferCopies;
+    std::vector< ImageCopy > mImageCopies;
+    // copies into reserved ranges run outside the lock, record and destroy
+    // wait for them to drain
+    uint32_t mWriting;
+    std::condition_variable mWritten;
+    std::mutex mMutex;
+};
+
+#endif //__STAGING_RING_H__
@@ -0,0 +1,55 @@
+#pragma once
+#ifndef __UNIFORM_RING_H__
+#define __UNIFORM_RING_H__
+
+#define GLFW_INCLUDE_NONE
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <atomic>
+
+#include "vulkanAllocator.h"
+#include "uniformAllocation.h"
+
+// Linear allocator for per draw constants over one persistently mapped
+// buffer with a region per frame in flight. An allocation is a single
+// atomic add, aligned to minUniformBufferOffsetAlignment, so any number of
+// recording threads can share it; the region rewinds once the frame's
+// fence was waited on. The buffer never changes while the frame ring
+// lives, one dynamic uniform descriptor covers every allocation.
+class uniformRing
+{
+public:
+    uniformRing(void);
+
+    bool init( VkDevice p_device, vulkanAllocator * p_allocator, const VkPhysicalDeviceMemoryProperties & p_memoryProperties,
+               const VkPhysicalDeviceLimits & p_limits, uint32_t p_frameCount, VkDeviceSize p_frameBytes );
+    void destroy(void);
+
+    // call after the slot's fence wait
+    void beginFrame( uint32_t p_frameSlot );
+    // makes the frame's writes visible to the device, before the submit
+    void endFrame(void);
+
+    ROOT_SPACE::UniformAllocation alloc( uint32_t p_size );
+
+    VkBuffer buffer(void) const;
+
+private:
+    VkDevice mDevice;
+    vulkanAllocator * mAllocator;
+
+    VkBuffer mBuffer;
+    MemoryAllocation mMemory;
+    bool mCoherent;
+    VkDeviceSize mAtomSize;
+    VkDeviceSize mAlignment;
+    VkDeviceSize mMaxRange;
+
+    VkDeviceSize mFrameBytes;
+    VkDeviceSize mBegin;
+    std::atomic< VkDeviceSize > mHead;
+    std::atomic< bool > mOpen;
+    std::atomic< bool > mOverflowed;    // logged once per frame
+};
+
+#endif //__UNIFORM_RING_H__
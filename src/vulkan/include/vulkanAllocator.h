@@ -0,0 +1,99 @@
+#pragma once
+#ifndef __VULKAN_ALLOCATOR_H__
+#define __VULKAN_ALLOCATOR_H__
+
+#define GLFW_INCLUDE_NONE
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <mutex>
+
+// a sub range of a VkDeviceMemory block handed out by vulkanAllocator
+typedef struct {
+    VkDeviceMemory memory;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    void * mapped;              // persistent mapping, null unless host visible
+    uint32_t memory_type;
+    uint32_t kind;
+    uint32_t block;             // UINT32_MAX for dedicated allocations
+} MemoryAllocation;
+
+typedef struct {
+    VkDeviceSize block_bytes;       // memory obtained from the driver
+    VkDeviceSize used_bytes;        // memory handed out to resources
+    VkDeviceSize largest_free;      // biggest allocation that fits without a new block
+    uint32_t block_count;
+    uint32_t dedicated_count;
+    uint32_t allocation_count;
+    uint32_t free_range_count;
+    float fragmentation;            // 0 when all free space is one range
+} MemoryStats;
+
+class vulkanAllocator
+{
+public:
+    // linear and optimal tiling resources never share a block, so
+    // bufferImageGranularity never has to be honoured between neighbours
+    enum ResourceKind
+    {
+        Linear = 0,
+        Optimal = 1,
+        KindCount = 2
+    };
+
+    vulkanAllocator(void);
+
+    bool init( VkDevice p_device, const VkPhysicalDeviceMemoryProperties & p_memoryProperties,
+               const VkPhysicalDeviceLimits & p_limits );
+    void destroy(void);
+
+    bool alloc( const VkMemoryRequirements & p_reqs, VkMemoryPropertyFlags p_required,
+                VkMemoryPropertyFlags p_preferred, ResourceKind p_kind, MemoryAllocation & p_allocation );
+    void free( MemoryAllocation & p_allocation );
+
+    // allocate and bind in one go
+    bool allocImage( VkImage p_image, VkMemoryPropertyFlags p_required, MemoryAllocation & p_allocation,
+                     VkImageTiling p_tiling = VK_IMAGE_TILING_OPTIMAL );
+    bool allocBuffer( VkBuffer p_buffer, VkMemoryPropertyFlags p_required, MemoryAllocation & p_allocation );
+
+    // releases blocks that hold no allocations
+    void trim(void);
+
+    MemoryStats stats(void);
+
+private:
+    struct Range
+    {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+    };
+
+    struct Block
+    {
+        VkDeviceMemory memory;
+        VkDeviceSize size;
+        VkDeviceSize used;
+        void * mapped;
+        uint32_t allocations;
+        std::vector< Range > free_ranges;   // sorted by offset, never adjacent
+    };
+
+    bool find_memory_type( uint32_t p_typeBits, VkMemoryPropertyFlags p_required,
+                           VkMemoryPropertyFlags p_preferred, uint32_t & p_typeIndex ) const;
+    VkDeviceSize block_size_for( uint32_t p_typeIndex ) const;
+    Block * create_block( uint32_t p_typeIndex, VkDeviceSize p_size );
+    void destroy_block( Block * p_block );
+    static bool alloc_from_block( Block & p_block, VkDeviceSize p_size, VkDeviceSize p_alignment, VkDeviceSize & p_offset );
+
+    VkDevice mDevice;
+    VkPhysicalDeviceMemoryProperties mMemoryProperties;
+    VkDeviceSize mNonCoherentAtomSize;
+
+    std::vector< Block * > mPools[VK_MAX_MEMORY_TYPES][KindCount];
+    uint32_t mDedicatedCount;
+    VkDeviceSize mDedicatedBytes;
+    std::mutex mMutex;
+};
+
+#endif //__VULKAN_ALLOCATOR_H__
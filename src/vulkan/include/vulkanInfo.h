@@ -5,13 +5,48 @@
 #define GLFW_INCLUDE_NONE
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
 #include <map>
-
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "renderContext.h"
+#include "deletionQueue.h"
+#include "startupReport.h"
+#include "deviceProfile.h"
+#include "spscQueue.h"
+#include "deviceDispatch.h"
+#include "descriptorCache.h"
+#include "bindlessTable.h"
+#include "shaderCache.h"
+#include "pipelineStateCache.h"
+
+#ifndef ROOT_SPACE
+#define ROOT_SPACE ws
+#endif //ROOT_SPACE
+
+#if defined(NDEBUG) && defined(__GNUC__)
+#define U_ASSERT_ONLY __attribute__((unused))
+#else
+#define U_ASSERT_ONLY
+#endif
+
+#define DEFAULT_FRAMES_IN_FLIGHT 2
+#define DEFAULT_STAGING_BYTES ( 16ull * 1024 * 1024 )
+#define DEFAULT_UNIFORM_BYTES ( 4ull * 1024 * 1024 )
+#define DEFAULT_SHADER_POLL_MS 250
+
+// a window state change travelling from the event thread to the render thread
 typedef struct {
-    VkImage image;
-    VkCommandBuffer cmd;
-    VkImageView view;
-} SwapchainBuffers;
+    GLFWwindow * handle;
+    ROOT_SPACE::PresentPolicy policy;
+    glm::ivec2 framebuffer_size;    // read on the event thread, glfw only answers there
+} RenderCommand;
 
 class vulkanInfo
 {
@@ -19,10 +54,20 @@ public:
 
     static vulkanInfo instance;
 
-    std::map< GLFWwindow *, VkSurfaceKHR > surfaces;
+    // one render context per window, plus the headless target; changed
+    // under contexts_mutex with the render thread paused, so lookups from
+    // other threads take the mutex and holders of render_mutex need not
+    std::map< GLFWwindow *, renderContext * > contexts;
+    std::mutex contexts_mutex;
+    renderContext * offscreen;
 
+    bool headless;
+    // resolved from profile and the environment by initGraphical
     bool validate;
     bool use_break;
+    ROOT_SPACE::DeviceProfile profile;
+    bool profile_set;
+    std::vector< ROOT_SPACE::DeviceCandidate > candidates;
     PFN_vkCreateDebugReportCallbackEXT CreateDebugReportCallback;
     PFN_vkDestroyDebugReportCallbackEXT DestroyDebugReportCallback;
     VkDebugReportCallbackEXT msg_callback;
@@ -37,46 +82,137 @@ public:
     VkQueueFamilyProperties *queue_props;
     uint32_t graphics_queue_node_index;
 
+    // dedicated queues when the device has the families for them, otherwise
+    // the same handle as queue; queue_lock maps a handle to its mutex
+    VkQueue compute_queue;
+    VkQueue transfer_queue;
+    uint32_t compute_queue_node_index;
+    uint32_t transfer_queue_node_index;
+    std::mutex queue_locks[3];
+
     uint32_t enabled_layer_count;
     uint32_t enabled_extension_count;
     const char * extension_names[64];
     const char * enabled_layers[64];
 
-    VkFormat format;
-    VkColorSpaceKHR color_space;
-
     PFN_vkGetPhysicalDeviceSurfaceSupportKHR fpGetPhysicalDeviceSurfaceSupportKHR;
     PFN_vkGetPhysicalDeviceSurfaceCapabilitiesKHR fpGetPhysicalDeviceSurfaceCapabilitiesKHR;
     PFN_vkGetPhysicalDeviceSurfaceFormatsKHR fpGetPhysicalDeviceSurfaceFormatsKHR;
     PFN_vkGetPhysicalDeviceSurfacePresentModesKHR fpGetPhysicalDeviceSurfacePresentModesKHR;
 
-    PFN_vkCreateSwapchainKHR fpCreateSwapchainKHR;
-    PFN_vkDestroySwapchainKHR fpDestroySwapchainKHR;
-    PFN_vkGetSwapchainImagesKHR fpGetSwapchainImagesKHR;
-    PFN_vkAcquireNextImageKHR fpAcquireNextImageKHR;
-    PFN_vkQueuePresentKHR fpQueuePresentKHR;
-
-    uint32_t swapchainImageCount;
-    VkSwapchainKHR swapchain;
-
-    SwapchainBuffers *buffers;
+    // general purpose pool for one off setup work outside the frame rings
     VkCommandPool cmd_pool;
-
-    struct {
-        VkFormat format;
-
-        VkImage image;
-        VkDeviceMemory mem;
-        VkImageView view;
-    } depth;
-
     VkCommandBuffer setup_cmd; 
-    VkCommandBuffer draw_cmd;
 
     VkPhysicalDeviceMemoryProperties memory_properties;
+    vulkanAllocator allocator;
+
+    // objects the graphics queue may still use, freed as frames complete
+    deletionQueue retired;
+
+    // set layouts shared by every render context's descriptor pools
+    descriptorCache descriptor_layouts;
+
+    // descriptor indexing as found by query_physical_device; only true when
+    // the profile asked for it and the gpu has every feature the table uses
+    bool properties2;
+    bool bindless_supported;
+    uint32_t bindless_images;
+    uint32_t bindless_buffers;
+    bindlessTable bindless;
+
+    // seeded from and written back to a per device/driver file in pipeline_cache_dir
+    VkPipelineCache pipeline_cache;
+    std::string pipeline_cache_dir;
+    // pipelines by state, compiled in the background into pipeline_cache
+    pipelineStateCache pipeline_states;
+    // spir-v modules by content, usable before the device exists
+    shaderCache shaders;
 
-    uint32_t current_buffer;
     uint32_t queue_count;
+
+    // defaults applied to every render context, 0 threads means every job system worker
+    uint32_t frame_count;
+    uint32_t record_threads;
+    // staging space of one frame in flight, 0 means DEFAULT_STAGING_BYTES
+    VkDeviceSize staging_bytes;
+    // uniform ring space of one frame in flight, 0 means DEFAULT_UNIFORM_BYTES
+    VkDeviceSize uniform_bytes;
+
+    // set while the device is still being built on a background thread;
+    // the first wait resolves it under device_mutex, device_pending lets
+    // every wait after that skip the lock
+    std::future< bool > device_ready;
+    std::mutex device_mutex;
+    std::atomic< bool > device_pending;
+    std::atomic< bool > device_failed;
+
+    // optional render thread; it owns every render context while it runs and
+    // holds render_mutex for each frame, other threads take it for rare
+    // structural changes and otherwise talk to it through render_commands
+    std::thread render_thread;
+    // published under render_mutex before the first frame, empty while
+    // there is no render thread; other threads only look at this
+    std::atomic< std::thread::id > render_thread_id;
+    // threads waiting in pause_render_thread, the render thread leaves
+    // render_mutex to them between frames instead of racing them for it
+    std::atomic< uint32_t > render_pauses;
+    std::condition_variable render_resume;
+    std::atomic< bool > render_quit;
+    std::atomic< bool > render_resync;
+    std::mutex render_mutex;
+    ROOT_SPACE::spscQueue< RenderCommand > render_commands;
+    // latest framebuffer sizes of commands that did not fit the queue,
+    // picked up with render_resync
+    std::mutex render_sizes_mutex;
+    std::map< GLFWwindow *, glm::ivec2 > render_sizes;
+
+    std::chrono::steady_clock::time_point startup_begin;
+    std::vector< ROOT_SPACE::StartupPhase > startup_phases;
+    std::mutex startup_mutex;
 };
 
+// device level entry points of vulkanInfo::instance.device, every device
+// call in the backend goes through it rather than the loader
+extern ROOT_SPACE::DeviceDispatch vkd;
+
+namespace ROOT_SPACE
+{
+    // times one init phase into the startup report; it counts as failed
+    // unless done() is reached, so early error returns are recorded as such
+    class startupScope
+    {
+    public:
+        startupScope( vulkanInfo & p_vulInfo, const char * p_name, const bool p_background = false );
+        ~startupScope(void);
+        void done(void);
+    private:
+        vulkanInfo & mVulInfo;
+        const char * mName;
+        bool mBackground;
+        bool mFailed;
+        std::chrono::steady_clock::time_point mBegin;
+    };
+
+    bool wait_device( vulkanInfo & p_vulInfo );
+    void resolve_device_profile( vulkanInfo & p_vulInfo );
+    bool select_physical_device( vulkanInfo & p_vulInfo, const VkPhysicalDevice * p_gpus, const uint32_t p_count );
+    std::unique_lock< std::mutex > pause_render_thread( vulkanInfo & p_vulInfo );
+    void apply_render_commands( vulkanInfo & p_vulInfo );
+    std::mutex & queue_lock( vulkanInfo & p_vulInfo, VkQueue p_queue );
+    bool memory_type_from_properties( vulkanInfo & p_vulInfo, uint32_t typeBits, VkFlags requirements_mask, uint32_t *typeIndex );
+    bool prepare_command_pool( vulkanInfo & p_vulInfo );
+    bool recreate_swapchain( vulkanInfo & p_vulInfo, renderContext & p_context );
+    void destroy_window_context( vulkanInfo & p_vulInfo, renderContext * p_context );
+    void destroy_offscreen( vulkanInfo & p_vulInfo );
+    bool prepare_frames( vulkanInfo & p_vulInfo, renderContext & p_context );
+    void destroy_frames( vulkanInfo & p_vulInfo, renderContext & p_context );
+    renderContext * find_context( vulkanInfo & p_vulInfo, window * p_window );
+    // caller holds contexts_mutex
+    renderContext * find_context_locked( vulkanInfo & p_vulInfo, window * p_window );
+    bool prepare_pipeline_cache( vulkanInfo & p_vulInfo );
+    bool save_pipeline_cache( vulkanInfo & p_vulInfo );
+    void destroy_pipeline_cache( vulkanInfo & p_vulInfo );
+}
+
 #endif //__VULKAN_INFO_H__
\ No newline at end of file
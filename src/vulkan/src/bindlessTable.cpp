@@ -0,0 +1,358 @@
+#include "bindlessTable.h"
+#include "vulkanInfo.h"
+#include "VGraphical.h"
+#include "bindless.h"
+#include "log.hpp"
+#include <cassert>
+
+bindlessTable::bindlessTable(void)
+{
+    mDevice = VK_NULL_HANDLE;
+    mRetired = nullptr;
+    mSetLayout = VK_NULL_HANDLE;
+    mPool = VK_NULL_HANDLE;
+    mSet = VK_NULL_HANDLE;
+    mPipelineLayout = VK_NULL_HANDLE;
+    mImages = Slots();
+    mBuffers = Slots();
+}
+
+bool bindlessTable::init( VkDevice p_device, deletionQueue * p_retired, uint32_t p_imageCount, uint32_t p_bufferCount )
+{
+    VkResult err;
+
+    mDevice = p_device;
+    mRetired = p_retired;
+
+    VkDescriptorSetLayoutBinding t_bindings[2] = {};
+    t_bindings[0].binding = 0;
+    t_bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    t_bindings[0].descriptorCount = p_imageCount;
+    t_bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+    t_bindings[1].binding = 1;
+    t_bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    t_bindings[1].descriptorCount = p_bufferCount;
+    t_bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+    // unwritten slots are fine as long as no shader reads them, and written
+    // ones may change while earlier frames still use other slots
+    const VkDescriptorBindingFlagsEXT t_flag = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT
+                                             | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT
+                                             | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+    const VkDescriptorBindingFlagsEXT t_flags[2] = { t_flag, t_flag };
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT t_bindingFlags = {};
+    t_bindingFlags.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    t_bindingFlags.bindingCount = 2;
+    t_bindingFlags.pBindingFlags = t_flags;
+
+    VkDescriptorSetLayoutCreateInfo t_layoutInfo = {};
+    t_layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    t_layoutInfo.pNext = &t_bindingFlags;
+    t_layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+    t_layoutInfo.bindingCount = 2;
+    t_layoutInfo.pBindings = t_bindings;
+
+    err = vkd.CreateDescriptorSetLayout( mDevice, &t_layoutInfo, nullptr, &mSetLayout );
+    if( err )
+    {
+        LOG.error( "bindlessTable Failure: vkCreateDescriptorSetLayout returned {0}", (int)err );
+        destroy();
+        return true;
+    }
+
+    VkDescriptorPoolSize t_sizes[2] = {};
+    t_sizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    t_sizes[0].descriptorCount = p_imageCount;
+    t_sizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    t_sizes[1].descriptorCount = p_bufferCount;
+
+    VkDescriptorPoolCreateInfo t_poolInfo = {};
+    t_poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    t_poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+    t_poolInfo.maxSets = 1;
+    t_poolInfo.poolSizeCount = 2;
+    t_poolInfo.pPoolSizes = t_sizes;
+
+    err = vkd.CreateDescriptorPool( mDevice, &t_poolInfo, nullptr, &mPool );
+    if( err )
+    {
+        LOG.error( "bindlessTable Failure: vkCreateDescriptorPool returned {0}", (int)err );
+        destroy();
+        return true;
+    }
+
+    VkDescriptorSetAllocateInfo t_setInfo = {};
+    t_setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    t_setInfo.descriptorPool = mPool;
+    t_setInfo.descriptorSetCount = 1;
+    t_setInfo.pSetLayouts = &mSetLayout;
+
+    err = vkd.AllocateDescriptorSets( mDevice, &t_setInfo, &mSet );
+    if( err )
+    {
+        LOG.error( "bindlessTable Failure: vkAllocateDescriptorSets returned {0}", (int)err );
+        destroy();
+        return true;
+    }
+
+    VkPushConstantRange t_range = {};
+    t_range.stageFlags = VK_SHADER_STAGE_ALL;
+    t_range.offset = 0;
+    t_range.size = BINDLESS_PUSH_CONSTANT_BYTES;
+
+    VkPipelineLayoutCreateInfo t_pipelineInfo = {};
+    t_pipelineInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    t_pipelineInfo.setLayoutCount = 1;
+    t_pipelineInfo.pSetLayouts = &mSetLayout;
+    t_pipelineInfo.pushConstantRangeCount = 1;
+    t_pipelineInfo.pPushConstantRanges = &t_range;
+
+    err = vkd.CreatePipelineLayout( mDevice, &t_pipelineInfo, nullptr, &mPipelineLayout );
+    if( err )
+    {
+        LOG.error( "bindlessTable Failure: vkCreatePipelineLayout returned {0}", (int)err );
+        destroy();
+        return true;
+    }
+
+    mImages.capacity = p_imageCount;
+    mImages.next = 0;
+    mImages.used.assign( p_imageCount, false );
+    mBuffers.capacity = p_bufferCount;
+    mBuffers.next = 0;
+    mBuffers.used.assign( p_bufferCount, false );
+    return false;
+}
+
+void bindlessTable::destroy(void)
+{
+    if( mPipelineLayout != VK_NULL_HANDLE )
+    {
+        vkd.DestroyPipelineLayout( mDevice, mPipelineLayout, nullptr );
+    }
+    // the set goes with its pool
+    if( mPool != VK_NULL_HANDLE )
+    {
+        vkd.DestroyDescriptorPool( mDevice, mPool, nullptr );
+    }
+    if( mSetLayout != VK_NULL_HANDLE )
+    {
+        vkd.DestroyDescriptorSetLayout( mDevice, mSetLayout, nullptr );
+    }
+
+    mPipelineLayout = VK_NULL_HANDLE;
+    mPool = VK_NULL_HANDLE;
+    mSet = VK_NULL_HANDLE;
+    mSetLayout = VK_NULL_HANDLE;
+    mImages = Slots();
+    mBuffers = Slots();
+}
+
+bool bindlessTable::ready(void) const
+{
+    return mSet != VK_NULL_HANDLE;
+}
+
+VkDescriptorSet bindlessTable::set(void) const
+{
+    return mSet;
+}
+
+VkDescriptorSetLayout bindlessTable::setLayout(void) const
+{
+    return mSetLayout;
+}
+
+VkPipelineLayout bindlessTable::pipelineLayout(void) const
+{
+    return mPipelineLayout;
+}
+
+uint32_t bindlessTable::take( Slots & p_slots )
+{
+    uint32_t t_index = BINDLESS_NONE;
+    if( !p_slots.free.empty() )
+    {
+        t_index = p_slots.free.back();
+        p_slots.free.pop_back();
+    }else if( p_slots.next < p_slots.capacity )
+    {
+        t_index = p_slots.next++;
+    }
+
+    if( t_index != BINDLESS_NONE )
+    {
+        p_slots.used[t_index] = true;
+    }
+    return t_index;
+}
+
+void bindlessTable::give( Slots & p_slots, uint32_t p_index, const char * p_kind )
+{
+    if( p_index == BINDLESS_NONE )
+    {
+        return;
+    }
+
+    {
+        std::lock_guard< std::mutex > t_lock( mMutex );
+
+        // a second release would put the slot on the free list twice and
+        // hand it to two owners later
+        if( p_index >= p_slots.next || !p_slots.used[p_index] )
+        {
+            LOG.warning( "bindlessTable: {0} slot {1} is not in use, release ignored", p_kind, p_index );
+            return;
+        }
+        p_slots.used[p_index] = false;
+    }
+
+    // shaders of frames still in flight may read the slot, whichever
+    // target drew with it, so it is reused once all of them are done
+    mRetired->retire( [this, &p_slots, p_index](void)
+    {
+        std::lock_guard< std::mutex > t_lock( mMutex );
+        p_slots.free.push_back( p_index );
+    } );
+}
+
+uint32_t bindlessTable::addImage( VkImageView p_view, VkSampler p_sampler, VkImageLayout p_layout )
+{
+    if( !ready() )
+    {
+        return BINDLESS_NONE;
+    }
+
+    // writes to one set have to be externally synchronized, so they share the lock
+    std::lock_guard< std::mutex > t_lock( mMutex );
+
+    const uint32_t t_index = take( mImages );
+    if( t_index == BINDLESS_NONE )
+    {
+        LOG.warning( "bindlessTable: all {0} image slots are in use", mImages.capacity );
+        return BINDLESS_NONE;
+    }
+
+    VkDescriptorImageInfo t_image = {};
+    t_image.sampler = p_sampler;
+    t_image.imageView = p_view;
+    t_image.imageLayout = p_layout;
+
+    VkWriteDescriptorSet t_write = {};
+    t_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    t_write.dstSet = mSet;
+    t_write.dstBinding = 0;
+    t_write.dstArrayElement = t_index;
+    t_write.descriptorCount = 1;
+    t_write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    t_write.pImageInfo = &t_image;
+
+    vkd.UpdateDescriptorSets( mDevice, 1, &t_write, 0, nullptr );
+    return t_index;
+}
+
+uint32_t bindlessTable::addBuffer( VkBuffer p_buffer, VkDeviceSize p_offset, VkDeviceSize p_range )
+{
+    if( !ready() )
+    {
+        return BINDLESS_NONE;
+    }
+
+    std::lock_guard< std::mutex > t_lock( mMutex );
+
+    const uint32_t t_index = take( mBuffers );
+    if( t_index == BINDLESS_NONE )
+    {
+        LOG.warning( "bindlessTable: all {0} buffer slots are in use", mBuffers.capacity );
+        return BINDLESS_NONE;
+    }
+
+    VkDescriptorBufferInfo t_buffer = {};
+    t_buffer.buffer = p_buffer;
+    t_buffer.offset = p_offset;
+    t_buffer.range = p_range;
+
+    VkWriteDescriptorSet t_write = {};
+    t_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    t_write.dstSet = mSet;
+    t_write.dstBinding = 1;
+    t_write.dstArrayElement = t_index;
+    t_write.descriptorCount = 1;
+    t_write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    t_write.pBufferInfo = &t_buffer;
+
+    vkd.UpdateDescriptorSets( mDevice, 1, &t_write, 0, nullptr );
+    return t_index;
+}
+
+void bindlessTable::releaseImage( uint32_t p_index )
+{
+    give( mImages, p_index, "image" );
+}
+
+void bindlessTable::releaseBuffer( uint32_t p_index )
+{
+    give( mBuffers, p_index, "buffer" );
+}
+
+namespace ROOT_SPACE
+{
+    bool VGraphical::hasBindless(void)
+    {
+        wait_device( vulkanInfo::instance );
+        return vulkanInfo::instance.bindless.ready();
+    }
+
+    VkDescriptorSet VGraphical::getBindlessSet(void)
+    {
+        wait_device( vulkanInfo::instance );
+        return vulkanInfo::instance.bindless.set();
+    }
+
+    VkDescriptorSetLayout VGraphical::getBindlessSetLayout(void)
+    {
+        wait_device( vulkanInfo::instance );
+        return vulkanInfo::instance.bindless.setLayout();
+    }
+
+    VkPipelineLayout VGraphical::getBindlessPipelineLayout(void)
+    {
+        wait_device( vulkanInfo::instance );
+        return vulkanInfo::instance.bindless.pipelineLayout();
+    }
+
+    void VGraphical::bindBindless( VkCommandBuffer p_cmd, const VkPipelineBindPoint p_bindPoint )
+    {
+        const bindlessTable & t_table = vulkanInfo::instance.bindless;
+        if( !t_table.ready() )
+        {
+            return;
+        }
+
+        VkDescriptorSet t_set = t_table.set();
+        vkd.CmdBindDescriptorSets( p_cmd, p_bindPoint, t_table.pipelineLayout(), 0, 1, &t_set, 0, nullptr );
+    }
+
+    uint32_t VGraphical::bindlessImage( VkImageView p_view, VkSampler p_sampler, const VkImageLayout p_layout )
+    {
+        wait_device( vulkanInfo::instance );
+        return vulkanInfo::instance.bindless.addImage( p_view, p_sampler, p_layout );
+    }
+
+    uint32_t VGraphical::bindlessBuffer( VkBuffer p_buffer, const VkDeviceSize p_offset, const VkDeviceSize p_range )
+    {
+        wait_device( vulkanInfo::instance );
+        return vulkanInfo::instance.bindless.addBuffer( p_buffer, p_offset, p_range );
+    }
+
+    void VGraphical::releaseBindlessImage( const uint32_t p_index )
+    {
+        vulkanInfo::instance.bindless.releaseImage( p_index );
+    }
+
+    void VGraphical::releaseBindlessBuffer( const uint32_t p_index )
+    {
+        vulkanInfo::instance.bindless.releaseBuffer( p_index );
+    }
+}
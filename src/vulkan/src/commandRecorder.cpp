@@ -0,0 +1,202 @@
+#include "commandRecorder.h"
+#include "vulkanInfo.h"
+#include "log.hpp"
+#include "jobSystem.h"
+#include <cassert>
+
+commandRecorder::commandRecorder(void)
+{
+    mDevice = VK_NULL_HANDLE;
+    mFrameSlot = 0;
+    mMaxChunks = 1;
+}
+
+bool commandRecorder::init( VkDevice p_device, uint32_t p_queueFamily, uint32_t p_frameCount, uint32_t p_maxChunks )
+{
+    VkResult U_ASSERT_ONLY err;
+
+    mDevice = p_device;
+    mFrameSlot = 0;
+    mMaxChunks = p_maxChunks > 0 ? p_maxChunks : 1;
+    mParticipants.resize( ROOT_SPACE::jobSystem::workerCount() + 1 );
+
+    for( size_t i = 0; i < mParticipants.size(); ++i )
+    {
+        mParticipants[i].frames.resize( p_frameCount );
+        for( uint32_t f = 0; f < p_frameCount; ++f )
+        {
+            VkCommandPoolCreateInfo cmd_pool_info = {};
+            cmd_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            cmd_pool_info.queueFamilyIndex = p_queueFamily;
+            cmd_pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+            err = vkd.CreateCommandPool( mDevice, &cmd_pool_info, nullptr, &mParticipants[i].frames[f].pool );
+            assert(!err);
+            mParticipants[i].frames[f].used = 0;
+        }
+    }
+
+    return false;
+}
+
+void commandRecorder::destroy(void)
+{
+    // destroying a pool frees every buffer allocated from it
+    for( size_t i = 0; i < mParticipants.size(); ++i )
+    {
+        for( size_t f = 0; f < mParticipants[i].frames.size(); ++f )
+        {
+            vkd.DestroyCommandPool( mDevice, mParticipants[i].frames[f].pool, nullptr );
+        }
+    }
+    mParticipants.clear();
+}
+
+void commandRecorder::beginFrame( uint32_t p_frameSlot )
+{
+    mFrameSlot = p_frameSlot;
+
+    for( size_t i = 0; i < mParticipants.size(); ++i )
+    {
+        FramePool & t_frame = mParticipants[i].frames[mFrameSlot];
+        if( t_frame.used > 0 )
+        {
+            vkd.ResetCommandPool( mDevice, t_frame.pool, 0 );
+            t_frame.used = 0;
+        }
+    }
+}
+
+uint32_t commandRecorder::participants(void) const
+{
+    return mMaxChunks;
+}
+
+VkCommandBuffer commandRecorder::next_buffer( uint32_t p_thread )
+{
+    // the job system was restarted with more threads than there are pools
+    if( p_thread >= mParticipants.size() )
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    FramePool & t_frame = mParticipants[p_thread].frames[mFrameSlot];
+
+    // buffers survive pool resets, so they are allocated once and recycled
+    if( t_frame.used == t_frame.buffers.size() )
+    {
+        VkCommandBufferAllocateInfo cmd = {};
+        cmd.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cmd.pNext = nullptr;
+        cmd.commandPool = t_frame.pool;
+        cmd.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        cmd.commandBufferCount = 1;
+
+        VkCommandBuffer t_buffer;
+        if( vkd.AllocateCommandBuffers( mDevice, &cmd, &t_buffer ) )
+        {
+            return VK_NULL_HANDLE;
+        }
+        t_frame.buffers.push_back( t_buffer );
+    }
+
+    return t_frame.buffers[t_frame.used++];
+}
+
+void commandRecorder::record_chunk( uint32_t p_chunk, Job & p_job )
+{
+    const uint32_t t_begin = (uint32_t)( (uint64_t)p_job.task_count * p_chunk / p_job.chunk_count );
+    const uint32_t t_end = (uint32_t)( (uint64_t)p_job.task_count * ( p_chunk + 1 ) / p_job.chunk_count );
+
+    p_job.results[p_chunk] = VK_NULL_HANDLE;
+    p_job.errors[p_chunk] = VK_SUCCESS;
+
+    if( t_begin == t_end )
+    {
+        return;
+    }
+
+    // the pool is in use for as long as the buffer records, not only while
+    // it is allocated, so outside threads hold the lock for the whole chunk
+    const uint32_t t_thread = ROOT_SPACE::jobSystem::threadIndex();
+    std::unique_lock< std::mutex > t_lock;
+    if( t_thread == 0 )
+    {
+        t_lock = std::unique_lock< std::mutex >( mOutsideMutex );
+    }
+
+    VkCommandBuffer t_cmd = next_buffer( t_thread );
+    if( t_cmd == VK_NULL_HANDLE )
+    {
+        p_job.errors[p_chunk] = VK_ERROR_OUT_OF_HOST_MEMORY;
+        return;
+    }
+
+    VkCommandBufferBeginInfo begin_info = {};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.pNext = nullptr;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if( p_job.inheritance->renderPass != VK_NULL_HANDLE )
+    {
+        begin_info.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    }
+    begin_info.pInheritanceInfo = p_job.inheritance;
+
+    VkResult err = vkd.BeginCommandBuffer( t_cmd, &begin_info );
+    if( err )
+    {
+        p_job.errors[p_chunk] = err;
+        return;
+    }
+
+    for( uint32_t t = t_begin; t < t_end; ++t )
+    {
+        ( *p_job.func )( t_cmd, t );
+    }
+
+    p_job.errors[p_chunk] = vkd.EndCommandBuffer( t_cmd );
+    p_job.results[p_chunk] = t_cmd;
+}
+
+bool commandRecorder::record( VkCommandBuffer p_primary, const VkCommandBufferInheritanceInfo * p_inheritance,
+                              uint32_t p_taskCount, const RecordFunc & p_func )
+{
+    if( p_taskCount == 0 )
+    {
+        return false;
+    }
+
+    Job t_job;
+    t_job.inheritance = p_inheritance;
+    t_job.func = &p_func;
+    t_job.task_count = p_taskCount;
+    t_job.chunk_count = p_taskCount < mMaxChunks ? p_taskCount : mMaxChunks;
+    t_job.results.resize( t_job.chunk_count );
+    t_job.errors.resize( t_job.chunk_count );
+
+    // one chunk per range, the calling thread records the first one itself
+    ROOT_SPACE::jobSystem::parallelFor( t_job.chunk_count, 1, [this, &t_job]( uint32_t p_begin, uint32_t p_end ) {
+        for( uint32_t c = p_begin; c < p_end; ++c )
+        {
+            record_chunk( c, t_job );
+        }
+    } );
+
+    std::vector< VkCommandBuffer > t_buffers;
+    t_buffers.reserve( t_job.results.size() );
+    for( size_t i = 0; i < t_job.results.size(); ++i )
+    {
+        if( t_job.errors[i] )
+        {
+            LOG.error( "commandRecorder: recording chunk {0} failed with {1}", (uint32_t)i, (int)t_job.errors[i] );
+            return true;
+        }
+        if( t_job.results[i] != VK_NULL_HANDLE )
+        {
+            t_buffers.push_back( t_job.results[i] );
+        }
+    }
+
+    vkd.CmdExecuteCommands( p_primary, (uint32_t)t_buffers.size(), t_buffers.data() );
+    return false;
+}
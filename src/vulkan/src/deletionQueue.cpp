@@ -0,0 +1,268 @@
+#include "deletionQueue.h"
+#include "vulkanInfo.h"
+#include "VGraphical.h"
+#include <algorithm>
+#include <cstring>
+
+deletionQueue::deletionQueue(void)
+{
+    mSubmitted = 0;
+    mCompleted = 0;
+}
+
+void deletionQueue::beginRecording( const void * p_recorder )
+{
+    std::lock_guard< std::mutex > t_lock( mMutex );
+    if( std::find( mRecording.begin(), mRecording.end(), p_recorder ) == mRecording.end() )
+    {
+        mRecording.push_back( p_recorder );
+    }
+}
+
+// drops p_recorder from everything retired during its recording, entries
+// left waiting for nobody are stamped with the latest submit
+void deletionQueue::stamp( const void * p_recorder, std::vector< DestroyFunc > & p_now )
+{
+    mRecording.erase( std::remove( mRecording.begin(), mRecording.end(), p_recorder ), mRecording.end() );
+
+    for( size_t i = 0; i < mPending.size(); )
+    {
+        Entry & t_entry = mPending[i];
+        t_entry.waiting.erase( std::remove( t_entry.waiting.begin(), t_entry.waiting.end(), p_recorder ), t_entry.waiting.end() );
+        if( !t_entry.waiting.empty() )
+        {
+            ++i;
+            continue;
+        }
+
+        t_entry.serial = mSubmitted;
+        if( t_entry.serial <= mCompleted )
+        {
+            p_now.push_back( t_entry.destroy );
+        }else
+        {
+            mStamped.push_back( t_entry );
+        }
+        mPending.erase( mPending.begin() + i );
+    }
+}
+
+void deletionQueue::endRecording( const void * p_recorder )
+{
+    std::vector< DestroyFunc > t_now;
+    {
+        std::lock_guard< std::mutex > t_lock( mMutex );
+        stamp( p_recorder, t_now );
+    }
+    run( t_now );
+}
+
+uint64_t deletionQueue::submit( const void * p_recorder )
+{
+    std::vector< DestroyFunc > t_now;
+    uint64_t t_serial;
+    {
+        std::lock_guard< std::mutex > t_lock( mMutex );
+        t_serial = ++mSubmitted;
+        stamp( p_recorder, t_now );
+    }
+    run( t_now );
+    return t_serial;
+}
+
+void deletionQueue::retire( const DestroyFunc & p_destroy, const void * p_owner )
+{
+    {
+        std::lock_guard< std::mutex > t_lock( mMutex );
+
+        Entry t_entry;
+        t_entry.destroy = p_destroy;
+        t_entry.owner = p_owner;
+        t_entry.serial = mSubmitted;
+        t_entry.waiting = mRecording;
+
+        if( !t_entry.waiting.empty() )
+        {
+            mPending.push_back( t_entry );
+            return;
+        }
+        if( t_entry.serial > mCompleted )
+        {
+            mStamped.push_back( t_entry );
+            return;
+        }
+    }
+
+    // nothing submitted can still reference it
+    p_destroy();
+}
+
+void deletionQueue::completed( uint64_t p_serial )
+{
+    std::vector< DestroyFunc > t_now;
+    {
+        std::lock_guard< std::mutex > t_lock( mMutex );
+        mCompleted = std::max( mCompleted, p_serial );
+        while( !mStamped.empty() && mStamped.front().serial <= mCompleted )
+        {
+            t_now.push_back( mStamped.front().destroy );
+            mStamped.pop_front();
+        }
+    }
+    run( t_now );
+}
+
+void deletionQueue::release( const void * p_owner )
+{
+    std::vector< DestroyFunc > t_now;
+    {
+        std::lock_guard< std::mutex > t_lock( mMutex );
+        for( size_t i = 0; i < mStamped.size(); )
+        {
+            if( mStamped[i].owner == p_owner )
+            {
+                t_now.push_back( mStamped[i].destroy );
+                mStamped.erase( mStamped.begin() + i );
+            }else
+            {
+                ++i;
+            }
+        }
+        for( size_t i = 0; i < mPending.size(); )
+        {
+            if( mPending[i].owner == p_owner )
+            {
+                t_now.push_back( mPending[i].destroy );
+                mPending.erase( mPending.begin() + i );
+            }else
+            {
+                ++i;
+            }
+        }
+    }
+    run( t_now );
+}
+
+void deletionQueue::flush(void)
+{
+    std::vector< DestroyFunc > t_now;
+    {
+        std::lock_guard< std::mutex > t_lock( mMutex );
+        for( size_t i = 0; i < mStamped.size(); ++i )
+        {
+            t_now.push_back( mStamped[i].destroy );
+        }
+        for( size_t i = 0; i < mPending.size(); ++i )
+        {
+            t_now.push_back( mPending[i].destroy );
+        }
+        mStamped.clear();
+        mPending.clear();
+        mRecording.clear();
+        mCompleted = mSubmitted;
+    }
+    run( t_now );
+}
+
+// outside the lock, a destroy function may retire further objects
+void deletionQueue::run( std::vector< DestroyFunc > & p_destroy )
+{
+    for( size_t i = 0; i < p_destroy.size(); ++i )
+    {
+        p_destroy[i]();
+    }
+}
+
+namespace ROOT_SPACE
+{
+    // non-dispatchable handles are pointers or uint64_t depending on the platform
+    template< typename T >
+    static T handle_from_bits( const uint64_t p_bits )
+    {
+        T t_handle;
+        memcpy( &t_handle, &p_bits, sizeof( T ) );
+        return t_handle;
+    }
+
+    VkDevice VGraphical::getDevice(void)
+    {
+        wait_device( vulkanInfo::instance );
+        return vulkanInfo::instance.device;
+    }
+
+    void VGraphical::retire( const DeviceObject p_type, const uint64_t p_handle )
+    {
+        if( p_handle == 0 )
+        {
+            return;
+        }
+
+        VkDevice t_device = vulkanInfo::instance.device;
+        deletionQueue::DestroyFunc t_destroy;
+
+        switch( p_type )
+        {
+        case DeviceObject::Buffer:
+            t_destroy = [t_device, p_handle]() { vkd.DestroyBuffer( t_device, handle_from_bits< VkBuffer >( p_handle ), nullptr ); };
+            break;
+        case DeviceObject::BufferView:
+            t_destroy = [t_device, p_handle]() { vkd.DestroyBufferView( t_device, handle_from_bits< VkBufferView >( p_handle ), nullptr ); };
+            break;
+        case DeviceObject::Image:
+            t_destroy = [t_device, p_handle]() { vkd.DestroyImage( t_device, handle_from_bits< VkImage >( p_handle ), nullptr ); };
+            break;
+        case DeviceObject::ImageView:
+            t_destroy = [t_device, p_handle]() { vkd.DestroyImageView( t_device, handle_from_bits< VkImageView >( p_handle ), nullptr ); };
+            break;
+        case DeviceObject::Sampler:
+            t_destroy = [t_device, p_handle]() { vkd.DestroySampler( t_device, handle_from_bits< VkSampler >( p_handle ), nullptr ); };
+            break;
+        case DeviceObject::DeviceMemory:
+            t_destroy = [t_device, p_handle]() { vkd.FreeMemory( t_device, handle_from_bits< VkDeviceMemory >( p_handle ), nullptr ); };
+            break;
+        case DeviceObject::ShaderModule:
+            t_destroy = [t_device, p_handle]() { vkd.DestroyShaderModule( t_device, handle_from_bits< VkShaderModule >( p_handle ), nullptr ); };
+            break;
+        case DeviceObject::Pipeline:
+            t_destroy = [t_device, p_handle]() { vkd.DestroyPipeline( t_device, handle_from_bits< VkPipeline >( p_handle ), nullptr ); };
+            break;
+        case DeviceObject::PipelineLayout:
+            t_destroy = [t_device, p_handle]() { vkd.DestroyPipelineLayout( t_device, handle_from_bits< VkPipelineLayout >( p_handle ), nullptr ); };
+            break;
+        case DeviceObject::DescriptorSetLayout:
+            t_destroy = [t_device, p_handle]() { vkd.DestroyDescriptorSetLayout( t_device, handle_from_bits< VkDescriptorSetLayout >( p_handle ), nullptr ); };
+            break;
+        case DeviceObject::DescriptorPool:
+            t_destroy = [t_device, p_handle]() { vkd.DestroyDescriptorPool( t_device, handle_from_bits< VkDescriptorPool >( p_handle ), nullptr ); };
+            break;
+        case DeviceObject::RenderPass:
+            t_destroy = [t_device, p_handle]() { vkd.DestroyRenderPass( t_device, handle_from_bits< VkRenderPass >( p_handle ), nullptr ); };
+            break;
+        case DeviceObject::Framebuffer:
+            t_destroy = [t_device, p_handle]() { vkd.DestroyFramebuffer( t_device, handle_from_bits< VkFramebuffer >( p_handle ), nullptr ); };
+            break;
+        case DeviceObject::Semaphore:
+            t_destroy = [t_device, p_handle]() { vkd.DestroySemaphore( t_device, handle_from_bits< VkSemaphore >( p_handle ), nullptr ); };
+            break;
+        case DeviceObject::Fence:
+            t_destroy = [t_device, p_handle]() { vkd.DestroyFence( t_device, handle_from_bits< VkFence >( p_handle ), nullptr ); };
+            break;
+        case DeviceObject::Event:
+            t_destroy = [t_device, p_handle]() { vkd.DestroyEvent( t_device, handle_from_bits< VkEvent >( p_handle ), nullptr ); };
+            break;
+        case DeviceObject::QueryPool:
+            t_destroy = [t_device, p_handle]() { vkd.DestroyQueryPool( t_device, handle_from_bits< VkQueryPool >( p_handle ), nullptr ); };
+            break;
+        case DeviceObject::CommandPool:
+            t_destroy = [t_device, p_handle]() { vkd.DestroyCommandPool( t_device, handle_from_bits< VkCommandPool >( p_handle ), nullptr ); };
+            break;
+        }
+
+        vulkanInfo::instance.retired.retire( t_destroy );
+    }
+
+    void VGraphical::retire( const std::function< void( void ) > & p_destroy )
+    {
+        vulkanInfo::instance.retired.retire( p_destroy );
+    }
+}
@@ -0,0 +1,103 @@
+#include "descriptorCache.h"
+#include "vulkanInfo.h"
+#include "log.hpp"
+#include <cassert>
+#include <algorithm>
+
+descriptorCache::descriptorCache(void)
+{
+    mDevice = VK_NULL_HANDLE;
+}
+
+bool descriptorCache::init( VkDevice p_device )
+{
+    mDevice = p_device;
+    return false;
+}
+
+void descriptorCache::destroy(void)
+{
+    std::lock_guard< std::mutex > t_lock( mMutex );
+
+    for( std::map< std::vector< uint64_t >, Entry >::iterator t_it = mLayouts.begin(); t_it != mLayouts.end(); ++t_it )
+    {
+        vkd.DestroyDescriptorSetLayout( mDevice, t_it->second.layout, nullptr );
+    }
+    mLayouts.clear();
+    mSizes.clear();
+}
+
+VkDescriptorSetLayout descriptorCache::layout( const std::vector< VkDescriptorSetLayoutBinding > & p_bindings )
+{
+    // binding order does not change the layout
+    std::vector< VkDescriptorSetLayoutBinding > t_bindings( p_bindings );
+    std::sort( t_bindings.begin(), t_bindings.end(),
+               []( const VkDescriptorSetLayoutBinding & p_a, const VkDescriptorSetLayoutBinding & p_b ) { return p_a.binding < p_b.binding; } );
+
+    std::vector< uint64_t > t_key;
+    for( size_t i = 0; i < t_bindings.size(); ++i )
+    {
+        const VkDescriptorSetLayoutBinding & t_binding = t_bindings[i];
+        t_key.push_back( ( (uint64_t)t_binding.binding << 32 ) | (uint32_t)t_binding.descriptorType );
+        t_key.push_back( ( (uint64_t)t_binding.descriptorCount << 32 ) | t_binding.stageFlags );
+        // immutable samplers are part of the layout, by handle
+        for( uint32_t s = 0; t_binding.pImmutableSamplers && s < t_binding.descriptorCount; ++s )
+        {
+            t_key.push_back( (uint64_t)(uintptr_t)t_binding.pImmutableSamplers[s] );
+        }
+    }
+
+    std::lock_guard< std::mutex > t_lock( mMutex );
+
+    std::map< std::vector< uint64_t >, Entry >::iterator t_found = mLayouts.find( t_key );
+    if( t_found != mLayouts.end() )
+    {
+        return t_found->second.layout;
+    }
+
+    VkDescriptorSetLayoutCreateInfo t_info = {};
+    t_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    t_info.bindingCount = (uint32_t)t_bindings.size();
+    t_info.pBindings = t_bindings.data();
+
+    Entry t_entry;
+    VkResult err = vkd.CreateDescriptorSetLayout( mDevice, &t_info, nullptr, &t_entry.layout );
+    if( err )
+    {
+        LOG.error( "descriptorCache Failure: vkCreateDescriptorSetLayout returned {0}", (int)err );
+        return VK_NULL_HANDLE;
+    }
+
+    for( size_t i = 0; i < t_bindings.size(); ++i )
+    {
+        size_t t_size = 0;
+        while( t_size < t_entry.sizes.size() && t_entry.sizes[t_size].type != t_bindings[i].descriptorType )
+        {
+            ++t_size;
+        }
+        if( t_size == t_entry.sizes.size() )
+        {
+            VkDescriptorPoolSize t_new = { t_bindings[i].descriptorType, 0 };
+            t_entry.sizes.push_back( t_new );
+        }
+        t_entry.sizes[t_size].descriptorCount += t_bindings[i].descriptorCount;
+    }
+
+    mLayouts[t_key] = t_entry;
+    mSizes[t_entry.layout] = t_entry.sizes;
+    return t_entry.layout;
+}
+
+bool descriptorCache::poolSizes( VkDescriptorSetLayout p_layout, std::vector< VkDescriptorPoolSize > & p_sizes )
+{
+    std::lock_guard< std::mutex > t_lock( mMutex );
+
+    std::map< VkDescriptorSetLayout, std::vector< VkDescriptorPoolSize > >::iterator t_found = mSizes.find( p_layout );
+    if( t_found == mSizes.end() )
+    {
+        return true;
+    }
+
+    p_sizes = t_found->second;
+    return false;
+}
@@ -0,0 +1,185 @@
+#include "descriptorPools.h"
+#include "vulkanInfo.h"
+#include "VGraphical.h"
+#include "log.hpp"
+#include "jobSystem.h"
+#include <cassert>
+
+// sets one pool of a chain holds, chains grow by whole pools
+#define DESCRIPTOR_SETS_PER_POOL 64
+
+descriptorPools::descriptorPools(void)
+{
+    mDevice = VK_NULL_HANDLE;
+    mCache = nullptr;
+    mFrameSlot = 0;
+}
+
+bool descriptorPools::init( VkDevice p_device, descriptorCache * p_cache, uint32_t p_frameCount )
+{
+    mDevice = p_device;
+    mCache = p_cache;
+    mFrameSlot = 0;
+    mParticipants.resize( ROOT_SPACE::jobSystem::workerCount() + 1 );
+
+    for( size_t i = 0; i < mParticipants.size(); ++i )
+    {
+        mParticipants[i].frames.resize( p_frameCount );
+    }
+
+    return false;
+}
+
+void descriptorPools::destroy(void)
+{
+    // destroying a pool frees every set allocated from it
+    for( size_t i = 0; i < mParticipants.size(); ++i )
+    {
+        for( size_t f = 0; f < mParticipants[i].frames.size(); ++f )
+        {
+            Chains & t_chains = mParticipants[i].frames[f];
+            for( Chains::iterator t_it = t_chains.begin(); t_it != t_chains.end(); ++t_it )
+            {
+                for( size_t p = 0; p < t_it->second.pools.size(); ++p )
+                {
+                    vkd.DestroyDescriptorPool( mDevice, t_it->second.pools[p], nullptr );
+                }
+            }
+        }
+    }
+    mParticipants.clear();
+}
+
+void descriptorPools::beginFrame( uint32_t p_frameSlot )
+{
+    mFrameSlot = p_frameSlot;
+
+    for( size_t i = 0; i < mParticipants.size(); ++i )
+    {
+        Chains & t_chains = mParticipants[i].frames[mFrameSlot];
+        for( Chains::iterator t_it = t_chains.begin(); t_it != t_chains.end(); ++t_it )
+        {
+            Chain & t_chain = t_it->second;
+            if( !t_chain.used )
+            {
+                continue;
+            }
+
+            for( size_t p = 0; p <= t_chain.current && p < t_chain.pools.size(); ++p )
+            {
+                vkd.ResetDescriptorPool( mDevice, t_chain.pools[p], 0 );
+            }
+            t_chain.current = 0;
+            t_chain.used = false;
+        }
+    }
+}
+
+bool descriptorPools::grow( VkDescriptorSetLayout p_layout, Chain & p_chain )
+{
+    std::vector< VkDescriptorPoolSize > t_sizes;
+    if( mCache->poolSizes( p_layout, t_sizes ) )
+    {
+        LOG.error( "descriptorPools Failure: the layout was not created through VGraphical::getDescriptorSetLayout" );
+        return true;
+    }
+
+    for( size_t i = 0; i < t_sizes.size(); ++i )
+    {
+        t_sizes[i].descriptorCount *= DESCRIPTOR_SETS_PER_POOL;
+    }
+
+    VkDescriptorPoolCreateInfo t_info = {};
+    t_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    t_info.maxSets = DESCRIPTOR_SETS_PER_POOL;
+    t_info.poolSizeCount = (uint32_t)t_sizes.size();
+    t_info.pPoolSizes = t_sizes.data();
+
+    VkDescriptorPool t_pool;
+    VkResult err = vkd.CreateDescriptorPool( mDevice, &t_info, nullptr, &t_pool );
+    if( err )
+    {
+        LOG.error( "descriptorPools Failure: vkCreateDescriptorPool returned {0}", (int)err );
+        return true;
+    }
+
+    p_chain.pools.push_back( t_pool );
+    return false;
+}
+
+VkDescriptorSet descriptorPools::alloc( VkDescriptorSetLayout p_layout )
+{
+    const uint32_t t_thread = ROOT_SPACE::jobSystem::threadIndex();
+
+    // the job system was restarted with more threads than there are pools
+    if( t_thread >= mParticipants.size() )
+    {
+        LOG.error( "descriptorPools Failure: thread {0} has no pools", t_thread );
+        return VK_NULL_HANDLE;
+    }
+
+    std::unique_lock< std::mutex > t_lock;
+    if( t_thread == 0 )
+    {
+        t_lock = std::unique_lock< std::mutex >( mOutsideMutex );
+    }
+
+    Chain & t_chain = mParticipants[t_thread].frames[mFrameSlot][p_layout];
+    t_chain.used = true;
+
+    VkDescriptorSetAllocateInfo t_info = {};
+    t_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    t_info.descriptorSetCount = 1;
+    t_info.pSetLayouts = &p_layout;
+
+    // a full pool moves the chain on to the next one, new pools are only
+    // made the first time a frame needs that many sets
+    for( ;; )
+    {
+        if( t_chain.current == t_chain.pools.size() && grow( p_layout, t_chain ) )
+        {
+            return VK_NULL_HANDLE;
+        }
+
+        t_info.descriptorPool = t_chain.pools[t_chain.current];
+
+        VkDescriptorSet t_set;
+        VkResult err = vkd.AllocateDescriptorSets( mDevice, &t_info, &t_set );
+        if( err == VK_SUCCESS )
+        {
+            return t_set;
+        }
+        if( err != VK_ERROR_OUT_OF_POOL_MEMORY && err != VK_ERROR_FRAGMENTED_POOL )
+        {
+            LOG.error( "descriptorPools Failure: vkAllocateDescriptorSets returned {0}", (int)err );
+            return VK_NULL_HANDLE;
+        }
+
+        ++t_chain.current;
+    }
+}
+
+namespace ROOT_SPACE
+{
+    VkDescriptorSetLayout VGraphical::getDescriptorSetLayout( const std::vector< VkDescriptorSetLayoutBinding > & p_bindings )
+    {
+        if( wait_device( vulkanInfo::instance ) )
+        {
+            return VK_NULL_HANDLE;
+        }
+
+        return vulkanInfo::instance.descriptor_layouts.layout( p_bindings );
+    }
+
+    VkDescriptorSet VGraphical::allocDescriptorSet( VkDescriptorSetLayout p_layout, window * p_window )
+    {
+        renderContext * t_context = find_context( vulkanInfo::instance, p_window );
+        if( !t_context || !t_context->frames )
+        {
+            LOG.error( "allocDescriptorSet Failure: no render context for this target" );
+            return VK_NULL_HANDLE;
+        }
+
+        return t_context->descriptors.alloc( p_layout );
+    }
+}
@@ -0,0 +1,307 @@
+#include "vulkanInfo.h"
+#include "VGraphical.h"
+#include "log.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+namespace ROOT_SPACE
+{
+    // unset leaves p_value alone, "0", "false" and "off" clear it
+    static void env_flag( const char * p_name, bool & p_value )
+    {
+        const char * t_value = getenv( p_name );
+        if( !t_value || !*t_value )
+        {
+            return;
+        }
+
+        std::string t_flag( t_value );
+        std::transform( t_flag.begin(), t_flag.end(), t_flag.begin(), ::tolower );
+        p_value = !( t_flag == "0" || t_flag == "false" || t_flag == "off" );
+    }
+
+    static bool has_features( const VkPhysicalDeviceFeatures & p_available, const VkPhysicalDeviceFeatures & p_required )
+    {
+        // the struct is nothing but VkBool32 members
+        const VkBool32 * t_available = (const VkBool32 *)&p_available;
+        const VkBool32 * t_required = (const VkBool32 *)&p_required;
+        for( size_t i = 0; i < sizeof( VkPhysicalDeviceFeatures ) / sizeof( VkBool32 ); ++i )
+        {
+            if( t_required[i] && !t_available[i] )
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool has_extension( const std::vector< VkExtensionProperties > & p_extensions, const char * p_name )
+    {
+        for( size_t i = 0; i < p_extensions.size(); ++i )
+        {
+            if( !strcmp( p_extensions[i].extensionName, p_name ) )
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // fills in everything but selected; unsuitable devices keep a score of -1
+    static DeviceCandidate rate_device( vulkanInfo & p_vulInfo, VkPhysicalDevice p_gpu )
+    {
+        VkResult U_ASSERT_ONLY err;
+        const DeviceProfile & t_profile = p_vulInfo.profile;
+
+        VkPhysicalDeviceProperties t_props;
+        VkPhysicalDeviceFeatures t_features;
+        VkPhysicalDeviceMemoryProperties t_memory;
+        vkGetPhysicalDeviceProperties( p_gpu, &t_props );
+        vkGetPhysicalDeviceFeatures( p_gpu, &t_features );
+        vkGetPhysicalDeviceMemoryProperties( p_gpu, &t_memory );
+
+        DeviceCandidate t_candidate;
+        t_candidate.name = t_props.deviceName;
+        t_candidate.type = t_props.deviceType;
+        t_candidate.device_memory = 0;
+        t_candidate.suitable = false;
+        t_candidate.score = -1;
+        t_candidate.selected = false;
+
+        for( uint32_t i = 0; i < t_memory.memoryHeapCount; ++i )
+        {
+            if( t_memory.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT )
+            {
+                t_candidate.device_memory = std::max< uint64_t >( t_candidate.device_memory, t_memory.memoryHeaps[i].size );
+            }
+        }
+
+        uint32_t t_familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties( p_gpu, &t_familyCount, nullptr );
+        std::vector< VkQueueFamilyProperties > t_families( t_familyCount );
+        vkGetPhysicalDeviceQueueFamilyProperties( p_gpu, &t_familyCount, t_families.data() );
+
+        uint32_t t_extensionCount = 0;
+        err = vkEnumerateDeviceExtensionProperties( p_gpu, nullptr, &t_extensionCount, nullptr );
+        assert( !err );
+        std::vector< VkExtensionProperties > t_extensions( t_extensionCount );
+        err = vkEnumerateDeviceExtensionProperties( p_gpu, nullptr, &t_extensionCount, t_extensions.data() );
+        assert( !err );
+
+        // create_device takes the first graphics family, windows need it to present
+        bool t_graphics = false;
+        bool t_present = false;
+        bool t_asyncCompute = false;
+        bool t_dma = false;
+        for( uint32_t i = 0; i < t_familyCount; ++i )
+        {
+            const VkQueueFlags t_flags = t_families[i].queueFlags;
+            if( ( t_flags & VK_QUEUE_GRAPHICS_BIT ) && !t_graphics )
+            {
+                t_graphics = true;
+                t_present = p_vulInfo.headless || glfwGetPhysicalDevicePresentationSupport( p_vulInfo.inst, p_gpu, i );
+            }
+            if( ( t_flags & VK_QUEUE_COMPUTE_BIT ) && !( t_flags & VK_QUEUE_GRAPHICS_BIT ) )
+            {
+                t_asyncCompute = true;
+            }
+            if( ( t_flags & VK_QUEUE_TRANSFER_BIT ) && !( t_flags & ( VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT ) ) )
+            {
+                t_dma = true;
+            }
+        }
+
+        if( !t_graphics )
+        {
+            t_candidate.rejected = "no graphics queue";
+            return t_candidate;
+        }
+        if( !t_present )
+        {
+            t_candidate.rejected = "cannot present";
+            return t_candidate;
+        }
+        if( !p_vulInfo.headless && !has_extension( t_extensions, VK_KHR_SWAPCHAIN_EXTENSION_NAME ) )
+        {
+            t_candidate.rejected = "missing " VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+            return t_candidate;
+        }
+        for( size_t i = 0; i < t_profile.device_extensions.size(); ++i )
+        {
+            if( !has_extension( t_extensions, t_profile.device_extensions[i].c_str() ) )
+            {
+                t_candidate.rejected = "missing " + t_profile.device_extensions[i];
+                return t_candidate;
+            }
+        }
+        if( !has_features( t_features, t_profile.required_features ) )
+        {
+            t_candidate.rejected = "missing required features";
+            return t_candidate;
+        }
+        if( t_candidate.device_memory < t_profile.min_device_memory )
+        {
+            t_candidate.rejected = "not enough device memory";
+            return t_candidate;
+        }
+
+        // the type outweighs everything else, the rest only orders gpus of
+        // the same kind
+        int64_t t_score = 0;
+        switch( t_props.deviceType )
+        {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            t_score = t_profile.prefer_integrated ? 5000 : 10000;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            t_score = t_profile.prefer_integrated ? 10000 : 5000;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            t_score = 2000;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:
+            t_score = 1000;
+            break;
+        default:
+            break;
+        }
+
+        t_score += t_asyncCompute ? 500 : 0;
+        t_score += t_dma ? 500 : 0;
+        // 32 per GiB, so heaps up to about 100GiB stay below a type step
+        t_score += (int64_t)( t_candidate.device_memory >> 25 );
+
+        t_candidate.suitable = true;
+        t_candidate.score = t_score;
+        return t_candidate;
+    }
+
+    // p_request is an enumeration index or a case insensitive part of the name
+    static bool matches_request( const std::string & p_request, const uint32_t p_index, const std::string & p_name )
+    {
+        if( std::all_of( p_request.begin(), p_request.end(), ::isdigit ) )
+        {
+            return (uint32_t)atoi( p_request.c_str() ) == p_index;
+        }
+
+        std::string t_request( p_request );
+        std::string t_name( p_name );
+        std::transform( t_request.begin(), t_request.end(), t_request.begin(), ::tolower );
+        std::transform( t_name.begin(), t_name.end(), t_name.begin(), ::tolower );
+        return t_name.find( t_request ) != std::string::npos;
+    }
+
+    void resolve_device_profile( vulkanInfo & p_vulInfo )
+    {
+        if( !p_vulInfo.profile_set )
+        {
+            p_vulInfo.profile = VGraphical::defaultDeviceProfile();
+        }
+
+        DeviceProfile & t_profile = p_vulInfo.profile;
+        env_flag( "VGRAPHICAL_VALIDATION", t_profile.validate );
+        env_flag( "VGRAPHICAL_BREAK", t_profile.break_on_error );
+        env_flag( "VGRAPHICAL_BINDLESS", t_profile.bindless );
+
+        const char * t_gpu = getenv( "VGRAPHICAL_GPU" );
+        if( t_gpu && *t_gpu )
+        {
+            t_profile.gpu = t_gpu;
+        }
+
+        p_vulInfo.validate = t_profile.validate;
+        p_vulInfo.use_break = t_profile.break_on_error;
+    }
+
+    bool select_physical_device( vulkanInfo & p_vulInfo, const VkPhysicalDevice * p_gpus, const uint32_t p_count )
+    {
+        const DeviceProfile & t_profile = p_vulInfo.profile;
+        p_vulInfo.candidates.clear();
+
+        int64_t t_best = -1;
+        uint32_t t_bestIndex = UINT32_MAX;
+        uint32_t t_requested = UINT32_MAX;
+
+        for( uint32_t i = 0; i < p_count; ++i )
+        {
+            DeviceCandidate t_candidate = rate_device( p_vulInfo, p_gpus[i] );
+
+            if( t_candidate.suitable )
+            {
+                LOG.info( "gpu {0}: {1}, score {2}", i, t_candidate.name, t_candidate.score );
+            }else
+            {
+                LOG.info( "gpu {0}: {1}, skipped: {2}", i, t_candidate.name, t_candidate.rejected );
+            }
+
+            if( !t_profile.gpu.empty() && t_requested == UINT32_MAX && matches_request( t_profile.gpu, i, t_candidate.name ) )
+            {
+                t_requested = i;
+            }
+            if( t_candidate.suitable && t_candidate.score > t_best )
+            {
+                t_best = t_candidate.score;
+                t_bestIndex = i;
+            }
+
+            p_vulInfo.candidates.push_back( t_candidate );
+        }
+
+        if( t_requested != UINT32_MAX )
+        {
+            if( !p_vulInfo.candidates[t_requested].suitable )
+            {
+                LOG.error( "select gpu Failure: requested gpu {0} is not usable: {1}", p_vulInfo.candidates[t_requested].name,
+                           p_vulInfo.candidates[t_requested].rejected );
+                return true;
+            }
+            t_bestIndex = t_requested;
+        }else if( !t_profile.gpu.empty() )
+        {
+            LOG.warning( "select gpu: no gpu matches \"{0}\", picking by score", t_profile.gpu );
+        }
+
+        if( t_bestIndex == UINT32_MAX )
+        {
+            LOG.error( "select gpu Failure: none of the {0} gpus is usable", p_count );
+            return true;
+        }
+
+        p_vulInfo.candidates[t_bestIndex].selected = true;
+        p_vulInfo.gpu = p_gpus[t_bestIndex];
+        LOG.info( "using gpu {0}: {1}", t_bestIndex, p_vulInfo.candidates[t_bestIndex].name );
+        return false;
+    }
+
+    DeviceProfile VGraphical::defaultDeviceProfile(void)
+    {
+        DeviceProfile t_profile;
+#ifdef NDEBUG
+        t_profile.validate = false;
+#else
+        t_profile.validate = true;
+#endif
+        t_profile.break_on_error = false;
+        t_profile.prefer_integrated = false;
+        t_profile.min_device_memory = 0;
+        memset( &t_profile.required_features, 0, sizeof( t_profile.required_features ) );
+        t_profile.bindless = true;
+        t_profile.bindless_images = 16384;
+        t_profile.bindless_buffers = 4096;
+        return t_profile;
+    }
+
+    void VGraphical::setDeviceProfile( const DeviceProfile & p_profile )
+    {
+        vulkanInfo::instance.profile = p_profile;
+        vulkanInfo::instance.profile_set = true;
+    }
+
+    std::vector< DeviceCandidate > VGraphical::getDeviceCandidates(void)
+    {
+        return vulkanInfo::instance.candidates;
+    }
+}
@@ -0,0 +1,650 @@
+#include "vulkanInfo.h"
+#include "VGraphical.h"
+#include "log.hpp"
+#include "cpuProfiler.h"
+#include "jobSystem.h"
+#include <cassert>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace ROOT_SPACE
+{
+    bool prepare_frames( vulkanInfo & p_vulInfo, renderContext & p_context )
+    {
+        VkResult U_ASSERT_ONLY err;
+
+        if( p_context.frame_count == 0 )
+        {
+            p_context.frame_count = DEFAULT_FRAMES_IN_FLIGHT;
+        }
+
+        p_context.frames = (FrameData *)malloc( sizeof( FrameData ) * p_context.frame_count );
+        assert( p_context.frames );
+        p_context.frame_index = 0;
+
+        for( uint32_t i = 0; i < p_context.frame_count; ++i )
+        {
+            FrameData & t_frame = p_context.frames[i];
+            t_frame.serial = 0;
+
+            // transient: the pool is reset as a whole every time the slot comes around
+            VkCommandPoolCreateInfo cmd_pool_info = {};
+            cmd_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            cmd_pool_info.queueFamilyIndex = p_vulInfo.graphics_queue_node_index;
+            cmd_pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+            err = vkd.CreateCommandPool( p_vulInfo.device, &cmd_pool_info, nullptr, &t_frame.cmd_pool );
+            assert(!err);
+
+            VkCommandBufferAllocateInfo cmd = {};
+            cmd.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            cmd.pNext = nullptr;
+            cmd.commandPool = t_frame.cmd_pool;
+            cmd.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            cmd.commandBufferCount = 1;
+
+            err = vkd.AllocateCommandBuffers( p_vulInfo.device, &cmd, &t_frame.cmd );
+            assert(!err);
+
+            err = vkd.AllocateCommandBuffers( p_vulInfo.device, &cmd, &t_frame.upload_cmd );
+            assert(!err);
+
+            // created signaled so the first wait on every slot returns at once
+            VkFenceCreateInfo fence_info = {};
+            fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            fence_info.pNext = nullptr;
+            fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+            err = vkd.CreateFence( p_vulInfo.device, &fence_info, nullptr, &t_frame.fence );
+            assert(!err);
+
+            VkSemaphoreCreateInfo semaphore_info = {};
+            semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            semaphore_info.pNext = nullptr;
+            semaphore_info.flags = 0;
+
+            err = vkd.CreateSemaphore( p_vulInfo.device, &semaphore_info, nullptr, &t_frame.acquire_semaphore );
+            assert(!err);
+
+            err = vkd.CreateSemaphore( p_vulInfo.device, &semaphore_info, nullptr, &t_frame.render_semaphore );
+            assert(!err);
+        }
+
+        // recording shares the job system threads with everything else
+        const uint32_t t_helpers = p_vulInfo.record_threads ? p_vulInfo.record_threads : jobSystem::workerCount();
+
+        if( p_context.graph.init( p_vulInfo.device, &p_vulInfo.allocator, &p_vulInfo.retired ) )
+        {
+            return true;
+        }
+
+        const VkDeviceSize t_stagingBytes = p_vulInfo.staging_bytes ? p_vulInfo.staging_bytes : DEFAULT_STAGING_BYTES;
+        if( p_context.staging.init( p_vulInfo.device, &p_vulInfo.allocator, p_vulInfo.memory_properties, p_vulInfo.gpu_props.limits,
+                                    p_context.frame_count, t_stagingBytes ) )
+        {
+            return true;
+        }
+
+        const VkDeviceSize t_uniformBytes = p_vulInfo.uniform_bytes ? p_vulInfo.uniform_bytes : DEFAULT_UNIFORM_BYTES;
+        if( p_context.uniforms.init( p_vulInfo.device, &p_vulInfo.allocator, p_vulInfo.memory_properties, p_vulInfo.gpu_props.limits,
+                                     p_context.frame_count, t_uniformBytes ) )
+        {
+            return true;
+        }
+
+        if( p_context.descriptors.init( p_vulInfo.device, &p_vulInfo.descriptor_layouts, p_context.frame_count ) )
+        {
+            return true;
+        }
+
+        if( p_context.profiler.init( p_vulInfo.device, p_vulInfo.gpu_props.limits,
+                                     p_vulInfo.queue_props[p_vulInfo.graphics_queue_node_index].timestampValidBits, p_context.frame_count ) )
+        {
+            return true;
+        }
+
+        return p_context.recorder.init( p_vulInfo.device, p_vulInfo.graphics_queue_node_index, p_context.frame_count, t_helpers + 1 );
+    }
+
+    void destroy_frames( vulkanInfo & p_vulInfo, renderContext & p_context )
+    {
+        if( !p_context.frames )
+        {
+            return;
+        }
+
+        uint64_t t_serial = 0;
+        for( uint32_t i = 0; i < p_context.frame_count; ++i )
+        {
+            vkd.WaitForFences( p_vulInfo.device, 1, &p_context.frames[i].fence, VK_TRUE, UINT64_MAX );
+            t_serial = std::max( t_serial, p_context.frames[i].serial );
+        }
+        p_vulInfo.retired.endRecording( &p_context );
+        p_vulInfo.retired.completed( t_serial );
+
+        p_context.recorder.destroy();
+        p_context.profiler.destroy();
+        p_context.staging.destroy();
+        p_context.uniforms.destroy();
+        p_context.descriptors.destroy();
+        p_context.graph.destroy();
+
+        for( uint32_t i = 0; i < p_context.frame_count; ++i )
+        {
+            FrameData & t_frame = p_context.frames[i];
+            vkd.DestroySemaphore( p_vulInfo.device, t_frame.render_semaphore, nullptr );
+            vkd.DestroySemaphore( p_vulInfo.device, t_frame.acquire_semaphore, nullptr );
+            vkd.DestroyFence( p_vulInfo.device, t_frame.fence, nullptr );
+            vkd.FreeCommandBuffers( p_vulInfo.device, t_frame.cmd_pool, 1, &t_frame.cmd );
+            vkd.FreeCommandBuffers( p_vulInfo.device, t_frame.cmd_pool, 1, &t_frame.upload_cmd );
+            vkd.DestroyCommandPool( p_vulInfo.device, t_frame.cmd_pool, nullptr );
+        }
+
+        free( p_context.frames );
+        p_context.frames = nullptr;
+        p_context.frame_index = 0;
+        p_context.present_pending = false;
+        p_context.present_frame = nullptr;
+    }
+
+    // the vulkanInfo fields prepare_frames reads
+    typedef struct {
+        uint32_t frame_count;
+        VkDeviceSize staging_bytes;
+        VkDeviceSize uniform_bytes;
+        uint32_t record_threads;
+    } FrameSettings;
+
+    static FrameSettings frame_settings( const vulkanInfo & p_vulInfo )
+    {
+        FrameSettings t_settings;
+        t_settings.frame_count = p_vulInfo.frame_count;
+        t_settings.staging_bytes = p_vulInfo.staging_bytes;
+        t_settings.uniform_bytes = p_vulInfo.uniform_bytes;
+        t_settings.record_threads = p_vulInfo.record_threads;
+        return t_settings;
+    }
+
+    static void restore_frame_settings( vulkanInfo & p_vulInfo, const FrameSettings & p_settings )
+    {
+        p_vulInfo.frame_count = p_settings.frame_count;
+        p_vulInfo.staging_bytes = p_settings.staging_bytes;
+        p_vulInfo.uniform_bytes = p_settings.uniform_bytes;
+        p_vulInfo.record_threads = p_settings.record_threads;
+    }
+
+    // rebuilds the frame ring of every context with the current defaults;
+    // if one fails the settings go back to p_previous and the contexts
+    // already torn down are rebuilt with them, the rest were never touched
+    static bool rebuild_frames( vulkanInfo & p_vulInfo, const FrameSettings & p_previous )
+    {
+        std::unique_lock< std::mutex > t_pause = pause_render_thread( p_vulInfo );
+
+        std::vector< renderContext * > t_contexts;
+        for( std::map< GLFWwindow *, renderContext * >::iterator t_it = p_vulInfo.contexts.begin(); t_it != p_vulInfo.contexts.end(); ++t_it )
+        {
+            t_contexts.push_back( t_it->second );
+        }
+        if( p_vulInfo.offscreen )
+        {
+            t_contexts.push_back( p_vulInfo.offscreen );
+        }
+
+        for( size_t i = 0; i < t_contexts.size(); ++i )
+        {
+            destroy_frames( p_vulInfo, *t_contexts[i] );
+            t_contexts[i]->frame_count = p_vulInfo.frame_count;
+            if( !prepare_frames( p_vulInfo, *t_contexts[i] ) )
+            {
+                continue;
+            }
+
+            LOG.error( "frame settings Failure: frame ring rebuild failed, restoring the previous settings" );
+            restore_frame_settings( p_vulInfo, p_previous );
+            for( size_t j = 0; j <= i; ++j )
+            {
+                destroy_frames( p_vulInfo, *t_contexts[j] );
+                t_contexts[j]->frame_count = p_vulInfo.frame_count;
+                if( prepare_frames( p_vulInfo, *t_contexts[j] ) )
+                {
+                    // frames stays null, every entry point refuses the context
+                    LOG.error( "frame settings Failure: the previous frame ring could not be restored either" );
+                    destroy_frames( p_vulInfo, *t_contexts[j] );
+                }
+            }
+            return true;
+        }
+
+        return false;
+    }
+
+    bool VGraphical::setFramesInFlight( const uint32_t p_count )
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+
+        if( p_count == 0 )
+        {
+            LOG.error( "setFramesInFlight Failure: at least one frame is required" );
+            return true;
+        }
+
+        if( p_count == vulInfo.frame_count )
+        {
+            return false;
+        }
+
+        // before any context exists only the count is recorded
+        const FrameSettings t_previous = frame_settings( vulInfo );
+        vulInfo.frame_count = p_count;
+        return rebuild_frames( vulInfo, t_previous );
+    }
+
+    bool VGraphical::setStagingSize( const uint64_t p_bytes )
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+
+        if( p_bytes == 0 )
+        {
+            LOG.error( "setStagingSize Failure: the staging ring cannot be empty" );
+            return true;
+        }
+
+        if( p_bytes == vulInfo.staging_bytes )
+        {
+            return false;
+        }
+
+        const FrameSettings t_previous = frame_settings( vulInfo );
+        vulInfo.staging_bytes = p_bytes;
+        return rebuild_frames( vulInfo, t_previous );
+    }
+
+    bool VGraphical::setUniformRingSize( const uint64_t p_bytes )
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+
+        if( p_bytes == 0 )
+        {
+            LOG.error( "setUniformRingSize Failure: the uniform ring cannot be empty" );
+            return true;
+        }
+
+        if( p_bytes == vulInfo.uniform_bytes )
+        {
+            return false;
+        }
+
+        const FrameSettings t_previous = frame_settings( vulInfo );
+        vulInfo.uniform_bytes = p_bytes;
+        return rebuild_frames( vulInfo, t_previous );
+    }
+
+    bool VGraphical::setRecordingThreads( const uint32_t p_count )
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+
+        if( p_count == vulInfo.record_threads )
+        {
+            return false;
+        }
+
+        const FrameSettings t_previous = frame_settings( vulInfo );
+        vulInfo.record_threads = p_count;
+        return rebuild_frames( vulInfo, t_previous );
+    }
+
+    bool VGraphical::recordParallel( VkCommandBuffer p_primary, const VkCommandBufferInheritanceInfo & p_inheritance,
+                                     const uint32_t p_taskCount, const std::function< void( VkCommandBuffer, uint32_t ) > & p_func,
+                                     window * p_window )
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+
+        renderContext * t_context = find_context( vulInfo, p_window );
+        if( !t_context || !t_context->frames )
+        {
+            LOG.error( "recordParallel Failure: no render context for this target" );
+            return true;
+        }
+
+        return t_context->recorder.record( p_primary, &p_inheritance, p_taskCount, p_func );
+    }
+
+    bool VGraphical::beginFrame( VkCommandBuffer & p_cmd, window * p_window )
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+        VkResult err;
+
+        p_cmd = VK_NULL_HANDLE;
+
+        renderContext * t_context = find_context( vulInfo, p_window );
+        if( !t_context || !t_context->buffers || !t_context->frames )
+        {
+            LOG.error( "beginFrame Failure: no render targets, call initWindow or initOffscreen first" );
+            return true;
+        }
+
+        // windows close their cpu frame in present, the offscreen target here
+        if( !t_context->handle )
+        {
+            cpuProfiler::frameMark();
+        }
+
+        CPU_ZONE( "beginFrame" );
+
+        if( t_context->resize_pending )
+        {
+            if( recreate_swapchain( vulInfo, *t_context ) )
+            {
+                return true;
+            }
+            if( t_context->resize_pending )
+            {
+                return false;
+            }
+        }
+
+        FrameData & t_frame = t_context->frames[t_context->frame_index];
+
+        // only blocks when the cpu is frame_count frames ahead of the gpu
+        {
+            CPU_ZONE( "frame fence wait" );
+            err = vkd.WaitForFences( vulInfo.device, 1, &t_frame.fence, VK_TRUE, UINT64_MAX );
+            assert(!err);
+        }
+
+        // the slot's last submit is done, and with it everything before it
+        vulInfo.retired.completed( t_frame.serial );
+
+        if( t_context->swapchain != VK_NULL_HANDLE )
+        {
+            CPU_ZONE( "acquire" );
+            err = vkd.AcquireNextImageKHR( vulInfo.device, t_context->swapchain, UINT64_MAX,
+                                                 t_frame.acquire_semaphore, VK_NULL_HANDLE, &t_context->current_buffer );
+            if( err == VK_ERROR_OUT_OF_DATE_KHR )
+            {
+                // the surface changed under us before the resize event arrived
+                t_context->resize_pending = true;
+                if( recreate_swapchain( vulInfo, *t_context ) )
+                {
+                    return true;
+                }
+                if( t_context->resize_pending )
+                {
+                    return false;
+                }
+                err = vkd.AcquireNextImageKHR( vulInfo.device, t_context->swapchain, UINT64_MAX,
+                                                     t_frame.acquire_semaphore, VK_NULL_HANDLE, &t_context->current_buffer );
+            }
+
+            if( err == VK_SUBOPTIMAL_KHR )
+            {
+                t_context->resize_pending = true;
+            }else if( err != VK_SUCCESS )
+            {
+                LOG.error( "beginFrame Failure: vkAcquireNextImageKHR returned {0}", (int)err );
+                return true;
+            }
+        }else
+        {
+            t_context->current_buffer = ( t_context->current_buffer + 1 ) % t_context->swapchainImageCount;
+        }
+
+        // the fence stays signaled until endFrame resets it right before
+        // the submit, so a frame that bails out never strands the slot
+        err = vkd.ResetCommandPool( vulInfo.device, t_frame.cmd_pool, 0 );
+        assert(!err);
+
+        t_context->recorder.beginFrame( t_context->frame_index );
+        t_context->staging.beginFrame( t_context->frame_index );
+        t_context->uniforms.beginFrame( t_context->frame_index );
+        t_context->descriptors.beginFrame( t_context->frame_index );
+        t_context->graph.beginFrame();
+        t_context->graph_backbuffer = GRAPH_RESOURCE_NONE;
+
+        VkCommandBufferBeginInfo begin_info = {};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.pNext = nullptr;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        begin_info.pInheritanceInfo = nullptr;
+
+        err = vkd.BeginCommandBuffer( t_frame.cmd, &begin_info );
+        assert(!err);
+
+        t_context->profiler.beginFrame( t_context->frame_index, t_frame.cmd );
+
+        // objects retired from here on wait for this frame's submit too
+        vulInfo.retired.beginRecording( t_context );
+
+        p_cmd = t_frame.cmd;
+        return false;
+    }
+
+    bool VGraphical::endFrame( window * p_window )
+    {
+        CPU_ZONE( "endFrame" );
+
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+        VkResult err;
+
+        renderContext * t_context = find_context( vulInfo, p_window );
+        if( !t_context || !t_context->frames )
+        {
+            LOG.error( "endFrame Failure: no render context for this target" );
+            return true;
+        }
+
+        FrameData & t_frame = t_context->frames[t_context->frame_index];
+        const bool t_present = t_context->swapchain != VK_NULL_HANDLE;
+
+        // passes declared this frame run after what was recorded directly;
+        // the graph fails before recording anything, so the frame is still
+        // submitted to consume the acquire and signal the slot's fence
+        bool t_failed = false;
+        if( !t_context->graph.empty() && t_context->graph.execute( t_frame.cmd, &t_context->profiler ) )
+        {
+            LOG.error( "endFrame Failure: the frame graph could not be executed" );
+            t_failed = true;
+        }
+
+        t_context->profiler.endFrame();
+        t_context->uniforms.endFrame();
+
+        err = vkd.EndCommandBuffer( t_frame.cmd );
+        assert(!err);
+
+        // uploads get their own buffer ahead of the frame's, so copies queued
+        // while recording still land before every command that reads them
+        VkCommandBuffer t_cmds[2] = { t_frame.upload_cmd, t_frame.cmd };
+        const bool t_uploads = !t_context->staging.empty();
+        if( t_uploads )
+        {
+            VkCommandBufferBeginInfo begin_info = {};
+            begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+            err = vkd.BeginCommandBuffer( t_frame.upload_cmd, &begin_info );
+            assert(!err);
+            t_context->staging.record( t_frame.upload_cmd );
+            err = vkd.EndCommandBuffer( t_frame.upload_cmd );
+            assert(!err);
+        }else
+        {
+            t_context->staging.close();
+        }
+
+        // the acquire semaphore plus anything handed over by other queues
+        std::vector< VkSemaphore > t_waits;
+        std::vector< VkPipelineStageFlags > t_waitStages;
+        if( t_present )
+        {
+            t_waits.push_back( t_frame.acquire_semaphore );
+            t_waitStages.push_back( VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT );
+        }
+        {
+            std::lock_guard< std::mutex > t_lock( t_context->frame_waits_mutex );
+            t_waits.insert( t_waits.end(), t_context->frame_waits.begin(), t_context->frame_waits.end() );
+            t_waitStages.insert( t_waitStages.end(), t_context->frame_wait_stages.begin(), t_context->frame_wait_stages.end() );
+            t_context->frame_waits.clear();
+            t_context->frame_wait_stages.clear();
+        }
+
+        VkSubmitInfo submit_info = {};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.pNext = nullptr;
+        submit_info.waitSemaphoreCount = (uint32_t)t_waits.size();
+        submit_info.pWaitSemaphores = t_waits.data();
+        submit_info.pWaitDstStageMask = t_waitStages.data();
+        submit_info.commandBufferCount = t_uploads ? 2 : 1;
+        submit_info.pCommandBuffers = t_uploads ? t_cmds : &t_frame.cmd;
+        submit_info.signalSemaphoreCount = t_present ? 1 : 0;
+        submit_info.pSignalSemaphores = &t_frame.render_semaphore;
+
+        {
+            std::lock_guard< std::mutex > t_lock( queue_lock( vulInfo, vulInfo.queue ) );
+            t_frame.serial = vulInfo.retired.submit( t_context );
+
+            err = vkd.ResetFences( vulInfo.device, 1, &t_frame.fence );
+            assert(!err);
+
+            err = vkd.QueueSubmit( vulInfo.queue, 1, &submit_info, t_frame.fence );
+            if( err )
+            {
+                LOG.error( "endFrame Failure: vkQueueSubmit returned {0}", (int)err );
+
+                // nothing was queued with the fence: drain what was, and swap
+                // in a signaled fence so the slot's next wait returns at once
+                vkd.QueueWaitIdle( vulInfo.queue );
+                vkd.DestroyFence( vulInfo.device, t_frame.fence, nullptr );
+
+                VkFenceCreateInfo fence_info = {};
+                fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+                fence_info.pNext = nullptr;
+                fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+                VkResult U_ASSERT_ONLY t_err = vkd.CreateFence( vulInfo.device, &fence_info, nullptr, &t_frame.fence );
+                assert(!t_err);
+
+                t_context->frame_index = ( t_context->frame_index + 1 ) % t_context->frame_count;
+                return true;
+            }
+        }
+
+        t_context->frame_index = ( t_context->frame_index + 1 ) % t_context->frame_count;
+
+        // presentation is batched across all windows in VGraphical::present
+        if( t_present )
+        {
+            t_context->present_pending = true;
+            t_context->present_frame = &t_frame;
+        }
+
+        return t_failed;
+    }
+
+    VkImage VGraphical::getCurrentImage( window * p_window )
+    {
+        renderContext * t_context = find_context( vulkanInfo::instance, p_window );
+        if( !t_context || !t_context->buffers )
+        {
+            return VK_NULL_HANDLE;
+        }
+        return t_context->buffers[t_context->current_buffer].image;
+    }
+
+    VkImageView VGraphical::getCurrentImageView( window * p_window )
+    {
+        renderContext * t_context = find_context( vulkanInfo::instance, p_window );
+        if( !t_context || !t_context->buffers )
+        {
+            return VK_NULL_HANDLE;
+        }
+        return t_context->buffers[t_context->current_buffer].view;
+    }
+
+    VkExtent2D VGraphical::getExtent( window * p_window )
+    {
+        renderContext * t_context = find_context( vulkanInfo::instance, p_window );
+        if( !t_context )
+        {
+            VkExtent2D t_none = { 0, 0 };
+            return t_none;
+        }
+        return t_context->extent;
+    }
+
+    bool VGraphical::present(void)
+    {
+        // a frame closes where its presentation starts, present shows up in the next one
+        cpuProfiler::frameMark();
+        CPU_ZONE( "present" );
+
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+
+        std::vector< renderContext * > t_contexts;
+        std::vector< VkSemaphore > t_waits;
+        std::vector< VkSwapchainKHR > t_swapchains;
+        std::vector< uint32_t > t_indices;
+
+        std::unique_lock< std::mutex > t_lock( vulInfo.contexts_mutex );
+        for( std::map< GLFWwindow *, renderContext * >::iterator t_it = vulInfo.contexts.begin(); t_it != vulInfo.contexts.end(); ++t_it )
+        {
+            renderContext * t_context = t_it->second;
+            if( !t_context->present_pending )
+            {
+                continue;
+            }
+
+            t_contexts.push_back( t_context );
+            t_waits.push_back( t_context->present_frame->render_semaphore );
+            t_swapchains.push_back( t_context->swapchain );
+            t_indices.push_back( t_context->current_buffer );
+            t_context->present_pending = false;
+        }
+        t_lock.unlock();
+
+        if( t_swapchains.empty() )
+        {
+            return false;
+        }
+
+        std::vector< VkResult > t_results( t_swapchains.size(), VK_SUCCESS );
+
+        VkPresentInfoKHR present = {};
+        present.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        present.pNext = nullptr;
+        present.waitSemaphoreCount = (uint32_t)t_waits.size();
+        present.pWaitSemaphores = t_waits.data();
+        present.swapchainCount = (uint32_t)t_swapchains.size();
+        present.pSwapchains = t_swapchains.data();
+        present.pImageIndices = t_indices.data();
+        present.pResults = t_results.data();
+
+        VkResult err;
+        {
+            std::lock_guard< std::mutex > t_lock( queue_lock( vulInfo, vulInfo.queue ) );
+            err = vkd.QueuePresentKHR( vulInfo.queue, &present );
+        }
+
+        bool t_failed = false;
+        for( size_t i = 0; i < t_results.size(); ++i )
+        {
+            if( t_results[i] == VK_SUBOPTIMAL_KHR || t_results[i] == VK_ERROR_OUT_OF_DATE_KHR )
+            {
+                t_contexts[i]->resize_pending = true;
+            }else if( t_results[i] != VK_SUCCESS )
+            {
+                LOG.error( "present Failure: vkQueuePresentKHR returned {0} for swapchain {1}", (int)t_results[i], (uint32_t)i );
+                t_failed = true;
+            }
+        }
+
+        if( err != VK_SUCCESS && err != VK_SUBOPTIMAL_KHR && err != VK_ERROR_OUT_OF_DATE_KHR && !t_failed )
+        {
+            LOG.error( "present Failure: vkQueuePresentKHR returned {0}", (int)err );
+            t_failed = true;
+        }
+
+        return t_failed;
+    }
+}
@@ -0,0 +1,924 @@
+#include "frameGraph.h"
+#include "vulkanInfo.h"
+#include "VGraphical.h"
+#include "log.hpp"
+#include "cpuProfiler.h"
+#include <cassert>
+#include <algorithm>
+
+using ROOT_SPACE::GraphResource;
+using ROOT_SPACE::GraphUsage;
+using ROOT_SPACE::GraphAccess;
+
+// stages, access, layout and usage bit that go with one GraphUsage
+typedef struct {
+    VkPipelineStageFlags stages;
+    VkAccessFlags access;
+    VkImageLayout layout;
+    bool reads;
+    bool writes;
+    VkImageUsageFlags image_usage;
+    VkBufferUsageFlags buffer_usage;
+} UsageInfo;
+
+static const VkPipelineStageFlags SHADER_STAGES = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+static const VkPipelineStageFlags DEPTH_STAGES = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+static UsageInfo usage_info( const GraphUsage p_usage )
+{
+    UsageInfo t_info = {};
+    switch( p_usage )
+    {
+    case GraphUsage::ColorAttachment:
+        t_info = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                   VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true, true, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, 0 };
+        break;
+    case GraphUsage::DepthAttachment:
+        t_info = { DEPTH_STAGES, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                   VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true, true, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0 };
+        break;
+    case GraphUsage::DepthRead:
+        t_info = { DEPTH_STAGES, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                   VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, true, false, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0 };
+        break;
+    case GraphUsage::Sampled:
+        t_info = { SHADER_STAGES, VK_ACCESS_SHADER_READ_BIT,
+                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, true, false, VK_IMAGE_USAGE_SAMPLED_BIT, VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT };
+        break;
+    case GraphUsage::StorageRead:
+        t_info = { SHADER_STAGES, VK_ACCESS_SHADER_READ_BIT,
+                   VK_IMAGE_LAYOUT_GENERAL, true, false, VK_IMAGE_USAGE_STORAGE_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT };
+        break;
+    case GraphUsage::StorageWrite:
+        t_info = { SHADER_STAGES, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                   VK_IMAGE_LAYOUT_GENERAL, true, true, VK_IMAGE_USAGE_STORAGE_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT };
+        break;
+    case GraphUsage::TransferSrc:
+        t_info = { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, true, false, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT };
+        break;
+    case GraphUsage::TransferDst:
+        t_info = { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, false, true, VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_BUFFER_USAGE_TRANSFER_DST_BIT };
+        break;
+    case GraphUsage::VertexBuffer:
+        t_info = { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+                   VK_IMAGE_LAYOUT_UNDEFINED, true, false, 0, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT };
+        break;
+    case GraphUsage::IndexBuffer:
+        t_info = { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT,
+                   VK_IMAGE_LAYOUT_UNDEFINED, true, false, 0, VK_BUFFER_USAGE_INDEX_BUFFER_BIT };
+        break;
+    case GraphUsage::UniformBuffer:
+        t_info = { SHADER_STAGES, VK_ACCESS_UNIFORM_READ_BIT,
+                   VK_IMAGE_LAYOUT_UNDEFINED, true, false, 0, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT };
+        break;
+    case GraphUsage::IndirectBuffer:
+        t_info = { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+                   VK_IMAGE_LAYOUT_UNDEFINED, true, false, 0, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT };
+        break;
+    }
+    return t_info;
+}
+
+static VkImageAspectFlags aspect_of( const VkFormat p_format )
+{
+    switch( p_format )
+    {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    case VK_FORMAT_S8_UINT:
+        return VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+        return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
+frameGraph::frameGraph(void)
+{
+    mDevice = VK_NULL_HANDLE;
+    mAllocator = nullptr;
+    mRetired = nullptr;
+    mStats = ROOT_SPACE::GraphStats();
+}
+
+bool frameGraph::init( VkDevice p_device, vulkanAllocator * p_allocator, deletionQueue * p_retired )
+{
+    mDevice = p_device;
+    mAllocator = p_allocator;
+    mRetired = p_retired;
+    return false;
+}
+
+// only once the frames using the transients are done
+void frameGraph::destroy(void)
+{
+    if( mDevice == VK_NULL_HANDLE )
+    {
+        return;
+    }
+
+    mRetired->release( this );
+    release( mDevice, mAllocator, mRealized );
+    mRealizedKey.clear();
+    mResources.clear();
+    mPasses.clear();
+    mDevice = VK_NULL_HANDLE;
+}
+
+void frameGraph::beginFrame(void)
+{
+    mResources.clear();
+    mPasses.clear();
+}
+
+GraphResource frameGraph::importImage( const char * p_name, VkImage p_image, VkImageView p_view, VkFormat p_format,
+                                       const VkExtent2D & p_extent, VkImageLayout p_initialLayout, VkImageLayout p_finalLayout,
+                                       VkPipelineStageFlags p_initialStages, VkAccessFlags p_initialAccess )
+{
+    Resource t_resource = {};
+    t_resource.name = p_name;
+    t_resource.is_image = true;
+    t_resource.imported = true;
+    t_resource.format = p_format;
+    t_resource.extent = p_extent;
+    t_resource.image = p_image;
+    t_resource.view = p_view;
+    t_resource.initial_layout = p_initialLayout;
+    t_resource.final_layout = p_finalLayout;
+    t_resource.initial_stages = p_initialStages;
+    t_resource.initial_access = p_initialAccess;
+    t_resource.physical = UINT32_MAX;
+
+    mResources.push_back( t_resource );
+    return (GraphResource)( mResources.size() - 1 );
+}
+
+GraphResource frameGraph::importBuffer( const char * p_name, VkBuffer p_buffer, VkDeviceSize p_size )
+{
+    Resource t_resource = {};
+    t_resource.name = p_name;
+    t_resource.is_image = false;
+    t_resource.imported = true;
+    t_resource.size = p_size;
+    t_resource.buffer = p_buffer;
+    t_resource.physical = UINT32_MAX;
+
+    mResources.push_back( t_resource );
+    return (GraphResource)( mResources.size() - 1 );
+}
+
+GraphResource frameGraph::createImage( const char * p_name, VkFormat p_format, const VkExtent2D & p_extent )
+{
+    Resource t_resource = {};
+    t_resource.name = p_name;
+    t_resource.is_image = true;
+    t_resource.imported = false;
+    t_resource.format = p_format;
+    t_resource.extent = p_extent;
+    t_resource.initial_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    t_resource.final_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    t_resource.physical = UINT32_MAX;
+
+    mResources.push_back( t_resource );
+    return (GraphResource)( mResources.size() - 1 );
+}
+
+GraphResource frameGraph::createBuffer( const char * p_name, VkDeviceSize p_size )
+{
+    Resource t_resource = {};
+    t_resource.name = p_name;
+    t_resource.is_image = false;
+    t_resource.imported = false;
+    t_resource.size = p_size;
+    t_resource.physical = UINT32_MAX;
+
+    mResources.push_back( t_resource );
+    return (GraphResource)( mResources.size() - 1 );
+}
+
+bool frameGraph::addPass( const char * p_name, const std::vector< GraphAccess > & p_accesses, const PassFunc & p_func, bool p_keep )
+{
+    for( size_t i = 0; i < p_accesses.size(); ++i )
+    {
+        if( p_accesses[i].resource >= mResources.size() )
+        {
+            LOG.error( "frame graph pass {0} Failure: unknown resource {1}", p_name, p_accesses[i].resource );
+            return true;
+        }
+
+        const Resource & t_resource = mResources[p_accesses[i].resource];
+        const UsageInfo t_info = usage_info( p_accesses[i].usage );
+        if( t_resource.is_image ? t_info.image_usage == 0 : t_info.buffer_usage == 0 )
+        {
+            LOG.error( "frame graph pass {0} Failure: {1} cannot be used that way", p_name, t_resource.name );
+            return true;
+        }
+    }
+
+    Pass t_pass;
+    t_pass.name = p_name;
+    t_pass.accesses = p_accesses;
+    t_pass.func = p_func;
+    t_pass.keep = p_keep;
+
+    mPasses.push_back( t_pass );
+    return false;
+}
+
+bool frameGraph::empty(void) const
+{
+    return mPasses.empty();
+}
+
+// walks the passes backwards from the imported resources, a pass survives
+// if it writes something a surviving pass or the outside world reads
+void frameGraph::cull( std::vector< uint32_t > & p_live )
+{
+    std::vector< bool > t_needed( mResources.size(), false );
+    for( size_t i = 0; i < mResources.size(); ++i )
+    {
+        t_needed[i] = mResources[i].imported;
+    }
+
+    std::vector< bool > t_alive( mPasses.size(), false );
+    for( size_t p = mPasses.size(); p-- > 0; )
+    {
+        const Pass & t_pass = mPasses[p];
+
+        bool t_live = t_pass.keep;
+        for( size_t i = 0; i < t_pass.accesses.size() && !t_live; ++i )
+        {
+            t_live = usage_info( t_pass.accesses[i].usage ).writes && t_needed[t_pass.accesses[i].resource];
+        }
+
+        if( !t_live )
+        {
+            continue;
+        }
+
+        t_alive[p] = true;
+        for( size_t i = 0; i < t_pass.accesses.size(); ++i )
+        {
+            if( usage_info( t_pass.accesses[i].usage ).reads )
+            {
+                t_needed[t_pass.accesses[i].resource] = true;
+            }
+        }
+    }
+
+    p_live.clear();
+    for( size_t p = 0; p < mPasses.size(); ++p )
+    {
+        if( t_alive[p] )
+        {
+            p_live.push_back( (uint32_t)p );
+        }
+    }
+}
+
+void frameGraph::release( VkDevice p_device, vulkanAllocator * p_allocator, Realized & p_realized )
+{
+    for( size_t i = 0; i < p_realized.physicals.size(); ++i )
+    {
+        Physical & t_physical = p_realized.physicals[i];
+        if( t_physical.view != VK_NULL_HANDLE )
+        {
+            vkd.DestroyImageView( p_device, t_physical.view, nullptr );
+        }
+        if( t_physical.image != VK_NULL_HANDLE )
+        {
+            vkd.DestroyImage( p_device, t_physical.image, nullptr );
+        }
+        if( t_physical.buffer != VK_NULL_HANDLE )
+        {
+            vkd.DestroyBuffer( p_device, t_physical.buffer, nullptr );
+        }
+    }
+
+    for( size_t i = 0; i < p_realized.slots.size(); ++i )
+    {
+        p_allocator->free( p_realized.slots[i].mem );
+    }
+
+    p_realized.physicals.clear();
+    p_realized.slots.clear();
+}
+
+// creates the transients and packs them into as few memory slots as
+// lifetimes allow, largest first so small resources fill in behind them
+bool frameGraph::realize( const std::vector< uint32_t > & p_transients )
+{
+    VkResult U_ASSERT_ONLY err;
+
+    Realized t_realized;
+    t_realized.physicals.resize( p_transients.size() );
+
+    for( size_t i = 0; i < p_transients.size(); ++i )
+    {
+        const Resource & t_resource = mResources[p_transients[i]];
+        Physical & t_physical = t_realized.physicals[i];
+        t_physical.image = VK_NULL_HANDLE;
+        t_physical.view = VK_NULL_HANDLE;
+        t_physical.buffer = VK_NULL_HANDLE;
+        t_physical.slot = UINT32_MAX;
+
+        if( t_resource.is_image )
+        {
+            VkImageCreateInfo t_info = {};
+            t_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            t_info.pNext = nullptr;
+            t_info.imageType = VK_IMAGE_TYPE_2D;
+            t_info.format = t_resource.format;
+            t_info.extent.width = t_resource.extent.width;
+            t_info.extent.height = t_resource.extent.height;
+            t_info.extent.depth = 1;
+            t_info.mipLevels = 1;
+            t_info.arrayLayers = 1;
+            t_info.samples = VK_SAMPLE_COUNT_1_BIT;
+            t_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+            t_info.usage = t_resource.usage;
+            t_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            t_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            err = vkd.CreateImage( mDevice, &t_info, nullptr, &t_physical.image );
+            assert(!err);
+            vkd.GetImageMemoryRequirements( mDevice, t_physical.image, &t_physical.reqs );
+        }else
+        {
+            VkBufferCreateInfo t_info = {};
+            t_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            t_info.pNext = nullptr;
+            t_info.size = t_resource.size;
+            t_info.usage = t_resource.usage;
+            t_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            err = vkd.CreateBuffer( mDevice, &t_info, nullptr, &t_physical.buffer );
+            assert(!err);
+            vkd.GetBufferMemoryRequirements( mDevice, t_physical.buffer, &t_physical.reqs );
+        }
+    }
+
+    std::vector< uint32_t > t_order( p_transients.size() );
+    for( size_t i = 0; i < t_order.size(); ++i )
+    {
+        t_order[i] = (uint32_t)i;
+    }
+    std::stable_sort( t_order.begin(), t_order.end(), [&t_realized]( uint32_t a, uint32_t b ) {
+        return t_realized.physicals[a].reqs.size > t_realized.physicals[b].reqs.size;
+    } );
+
+    for( size_t o = 0; o < t_order.size(); ++o )
+    {
+        const uint32_t t_index = t_order[o];
+        const Resource & t_resource = mResources[p_transients[t_index]];
+        Physical & t_physical = t_realized.physicals[t_index];
+
+        for( uint32_t s = 0; s < t_realized.slots.size() && t_physical.slot == UINT32_MAX; ++s )
+        {
+            Slot & t_slot = t_realized.slots[s];
+            if( t_slot.is_image != t_resource.is_image || !( t_slot.type_bits & t_physical.reqs.memoryTypeBits ) )
+            {
+                continue;
+            }
+
+            bool t_overlaps = false;
+            for( size_t m = 0; m < t_slot.members.size() && !t_overlaps; ++m )
+            {
+                const Resource & t_other = mResources[p_transients[t_slot.members[m]]];
+                t_overlaps = t_resource.first_pass <= t_other.last_pass && t_other.first_pass <= t_resource.last_pass;
+            }
+
+            if( !t_overlaps )
+            {
+                t_slot.size = std::max( t_slot.size, t_physical.reqs.size );
+                t_slot.alignment = std::max( t_slot.alignment, t_physical.reqs.alignment );
+                t_slot.type_bits &= t_physical.reqs.memoryTypeBits;
+                t_slot.members.push_back( t_index );
+                t_physical.slot = s;
+            }
+        }
+
+        if( t_physical.slot == UINT32_MAX )
+        {
+            Slot t_slot = {};
+            t_slot.size = t_physical.reqs.size;
+            t_slot.alignment = t_physical.reqs.alignment;
+            t_slot.type_bits = t_physical.reqs.memoryTypeBits;
+            t_slot.is_image = t_resource.is_image;
+            t_slot.members.push_back( t_index );
+            t_physical.slot = (uint32_t)t_realized.slots.size();
+            t_realized.slots.push_back( t_slot );
+        }
+    }
+
+    for( size_t s = 0; s < t_realized.slots.size(); ++s )
+    {
+        Slot & t_slot = t_realized.slots[s];
+
+        VkMemoryRequirements t_reqs;
+        t_reqs.size = t_slot.size;
+        t_reqs.alignment = t_slot.alignment;
+        t_reqs.memoryTypeBits = t_slot.type_bits;
+
+        if( mAllocator->alloc( t_reqs, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0,
+                               t_slot.is_image ? vulkanAllocator::Optimal : vulkanAllocator::Linear, t_slot.mem ) )
+        {
+            LOG.error( "frame graph Failure: no memory for {0} bytes of transients", (uint64_t)t_slot.size );
+            release( mDevice, mAllocator, t_realized );
+            return true;
+        }
+
+        for( size_t m = 0; m < t_slot.members.size(); ++m )
+        {
+            Physical & t_physical = t_realized.physicals[t_slot.members[m]];
+            if( t_physical.image != VK_NULL_HANDLE )
+            {
+                err = vkd.BindImageMemory( mDevice, t_physical.image, t_slot.mem.memory, t_slot.mem.offset );
+            }else
+            {
+                err = vkd.BindBufferMemory( mDevice, t_physical.buffer, t_slot.mem.memory, t_slot.mem.offset );
+            }
+            assert(!err);
+        }
+    }
+
+    for( size_t i = 0; i < p_transients.size(); ++i )
+    {
+        const Resource & t_resource = mResources[p_transients[i]];
+        Physical & t_physical = t_realized.physicals[i];
+        if( !t_resource.is_image )
+        {
+            continue;
+        }
+
+        VkImageViewCreateInfo t_view = {};
+        t_view.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        t_view.pNext = nullptr;
+        t_view.image = t_physical.image;
+        t_view.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        t_view.format = t_resource.format;
+        t_view.subresourceRange.aspectMask = aspect_of( t_resource.format );
+        t_view.subresourceRange.baseMipLevel = 0;
+        t_view.subresourceRange.levelCount = 1;
+        t_view.subresourceRange.baseArrayLayer = 0;
+        t_view.subresourceRange.layerCount = 1;
+
+        err = vkd.CreateImageView( mDevice, &t_view, nullptr, &t_physical.view );
+        assert(!err);
+    }
+
+    // the old set may still be in use by frames in flight
+    if( !mRealized.physicals.empty() || !mRealized.slots.empty() )
+    {
+        VkDevice t_device = mDevice;
+        vulkanAllocator * t_allocator = mAllocator;
+        Realized t_old = mRealized;
+        mRetired->retire( [t_device, t_allocator, t_old]() mutable {
+            release( t_device, t_allocator, t_old );
+        }, this );
+    }
+    mRealized = t_realized;
+    return false;
+}
+
+bool frameGraph::execute( VkCommandBuffer p_cmd, gpuProfiler * p_profiler )
+{
+    CPU_ZONE( "frame graph" );
+
+    std::vector< uint32_t > t_live;
+    cull( t_live );
+
+    mStats = ROOT_SPACE::GraphStats();
+    mStats.pass_count = (uint32_t)t_live.size();
+    mStats.culled_count = (uint32_t)( mPasses.size() - t_live.size() );
+
+    // lifetimes and usage flags over the surviving passes
+    for( size_t i = 0; i < mResources.size(); ++i )
+    {
+        mResources[i].first_pass = UINT32_MAX;
+        mResources[i].last_pass = 0;
+    }
+    for( uint32_t l = 0; l < t_live.size(); ++l )
+    {
+        const Pass & t_pass = mPasses[t_live[l]];
+        for( size_t i = 0; i < t_pass.accesses.size(); ++i )
+        {
+            Resource & t_resource = mResources[t_pass.accesses[i].resource];
+            const UsageInfo t_info = usage_info( t_pass.accesses[i].usage );
+            t_resource.first_pass = std::min( t_resource.first_pass, l );
+            t_resource.last_pass = std::max( t_resource.last_pass, l );
+            t_resource.usage |= t_resource.is_image ? t_info.image_usage : t_info.buffer_usage;
+        }
+    }
+
+    // the transients are only rebuilt when their descriptions change
+    std::vector< uint32_t > t_transients;
+    std::vector< uint64_t > t_key;
+    for( size_t i = 0; i < mResources.size(); ++i )
+    {
+        const Resource & t_resource = mResources[i];
+        if( t_resource.imported || t_resource.first_pass == UINT32_MAX )
+        {
+            continue;
+        }
+
+        t_transients.push_back( (uint32_t)i );
+        t_key.push_back( ( (uint64_t)t_resource.is_image << 32 ) | (uint64_t)t_resource.format );
+        t_key.push_back( ( (uint64_t)t_resource.extent.width << 32 ) | (uint64_t)t_resource.extent.height );
+        t_key.push_back( (uint64_t)t_resource.size );
+        t_key.push_back( ( (uint64_t)t_resource.usage << 32 ) | (uint64_t)t_resource.first_pass );
+        t_key.push_back( (uint64_t)t_resource.last_pass );
+    }
+
+    if( t_key != mRealizedKey )
+    {
+        if( realize( t_transients ) )
+        {
+            mRealizedKey.clear();
+            return true;
+        }
+        mRealizedKey = t_key;
+    }
+
+    for( size_t i = 0; i < t_transients.size(); ++i )
+    {
+        Resource & t_resource = mResources[t_transients[i]];
+        const Physical & t_physical = mRealized.physicals[i];
+        t_resource.physical = (uint32_t)i;
+        t_resource.image = t_physical.image;
+        t_resource.view = t_physical.view;
+        t_resource.buffer = t_physical.buffer;
+
+        mStats.unaliased_bytes += t_physical.reqs.size;
+    }
+    mStats.transient_count = (uint32_t)t_transients.size();
+    for( size_t s = 0; s < mRealized.slots.size(); ++s )
+    {
+        mStats.transient_bytes += mRealized.slots[s].size;
+    }
+
+    // transients start out undefined and wait for whatever used their
+    // memory last, be it an aliased neighbour or the previous frame
+    std::vector< State > t_states( mResources.size() );
+    for( size_t i = 0; i < mResources.size(); ++i )
+    {
+        const Resource & t_resource = mResources[i];
+        State & t_state = t_states[i];
+        t_state.layout = t_resource.initial_layout;
+        t_state.write_stages = t_resource.initial_stages;
+        t_state.write_access = t_resource.initial_access;
+        t_state.read_stages = 0;
+        t_state.read_access = 0;
+    }
+
+    std::vector< VkImageMemoryBarrier > t_imageBarriers;
+    for( uint32_t l = 0; l < t_live.size(); ++l )
+    {
+        const Pass & t_pass = mPasses[t_live[l]];
+
+        // several accesses to one resource in a pass act as one
+        std::vector< uint32_t > t_touched;
+        std::vector< UsageInfo > t_merged;
+        for( size_t i = 0; i < t_pass.accesses.size(); ++i )
+        {
+            const UsageInfo t_info = usage_info( t_pass.accesses[i].usage );
+            std::vector< uint32_t >::iterator t_it = std::find( t_touched.begin(), t_touched.end(), t_pass.accesses[i].resource );
+            if( t_it == t_touched.end() )
+            {
+                t_touched.push_back( t_pass.accesses[i].resource );
+                t_merged.push_back( t_info );
+                continue;
+            }
+
+            UsageInfo & t_into = t_merged[t_it - t_touched.begin()];
+            t_into.stages |= t_info.stages;
+            t_into.access |= t_info.access;
+            t_into.reads = t_into.reads || t_info.reads;
+            t_into.writes = t_into.writes || t_info.writes;
+            if( t_into.layout != t_info.layout )
+            {
+                t_into.layout = VK_IMAGE_LAYOUT_GENERAL;
+            }
+        }
+
+        t_imageBarriers.clear();
+        VkMemoryBarrier t_memory = {};
+        t_memory.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        VkPipelineStageFlags t_srcStages = 0;
+        VkPipelineStageFlags t_dstStages = 0;
+
+        for( size_t i = 0; i < t_touched.size(); ++i )
+        {
+            Resource & t_resource = mResources[t_touched[i]];
+            State & t_state = t_states[t_touched[i]];
+            const UsageInfo & t_use = t_merged[i];
+
+            Slot * t_slot = t_resource.imported ? nullptr : &mRealized.slots[mRealized.physicals[t_resource.physical].slot];
+            if( t_slot && l == t_resource.first_pass )
+            {
+                t_state.write_stages = t_slot->tail_stages;
+                t_state.write_access = t_slot->tail_access;
+            }
+
+            const VkImageLayout t_oldLayout = t_state.layout;
+            const bool t_transition = t_resource.is_image && t_oldLayout != t_use.layout;
+
+            VkPipelineStageFlags t_src = 0;
+            VkAccessFlags t_srcAccess = 0;
+            bool t_barrier = false;
+
+            if( t_transition || t_use.writes )
+            {
+                // write after read only needs the readers done, write after
+                // write and layout changes also need the old writes flushed
+                t_src = t_state.write_stages | t_state.read_stages;
+                t_srcAccess = t_state.write_access;
+                t_barrier = t_transition || t_src != 0;
+
+                t_state.layout = t_resource.is_image ? t_use.layout : t_state.layout;
+                t_state.write_stages = t_use.stages;
+                t_state.write_access = t_use.writes ? ( t_use.access & ( VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                                                         VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT ) ) : 0;
+                t_state.read_stages = t_use.stages;
+                t_state.read_access = t_use.access;
+            }else if( t_state.write_access != 0 &&
+                      ( ( t_state.read_stages & t_use.stages ) != t_use.stages || ( t_state.read_access & t_use.access ) != t_use.access ) )
+            {
+                // read after write that is not yet visible to these stages
+                t_src = t_state.write_stages;
+                t_srcAccess = t_state.write_access;
+                t_barrier = true;
+
+                t_state.read_stages |= t_use.stages;
+                t_state.read_access |= t_use.access;
+            }else
+            {
+                // nothing to make visible, remembered for the next writer
+                t_state.read_stages |= t_use.stages;
+                t_state.read_access |= t_use.access;
+            }
+
+            if( t_barrier )
+            {
+                t_srcStages |= t_src;
+                t_dstStages |= t_use.stages;
+
+                if( t_resource.is_image )
+                {
+                    VkImageMemoryBarrier t_image = {};
+                    t_image.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                    t_image.pNext = nullptr;
+                    t_image.srcAccessMask = t_srcAccess;
+                    t_image.dstAccessMask = t_use.access;
+                    t_image.oldLayout = t_oldLayout;
+                    t_image.newLayout = t_use.layout;
+                    t_image.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                    t_image.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                    t_image.image = t_resource.image;
+                    t_image.subresourceRange.aspectMask = aspect_of( t_resource.format );
+                    t_image.subresourceRange.baseMipLevel = 0;
+                    t_image.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+                    t_image.subresourceRange.baseArrayLayer = 0;
+                    t_image.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+                    t_imageBarriers.push_back( t_image );
+                }else
+                {
+                    t_memory.srcAccessMask |= t_srcAccess;
+                    t_memory.dstAccessMask |= t_use.access;
+                }
+            }
+
+            if( t_slot )
+            {
+                t_slot->tail_stages = t_state.write_stages | t_state.read_stages;
+                t_slot->tail_access = t_state.write_access;
+            }
+        }
+
+        if( t_srcStages != 0 || !t_imageBarriers.empty() )
+        {
+            const bool t_hasMemory = t_memory.srcAccessMask != 0 || t_memory.dstAccessMask != 0;
+            vkd.CmdPipelineBarrier( p_cmd, t_srcStages ? t_srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, t_dstStages, 0,
+                                  t_hasMemory ? 1 : 0, t_hasMemory ? &t_memory : nullptr,
+                                  0, nullptr,
+                                  (uint32_t)t_imageBarriers.size(), t_imageBarriers.data() );
+            mStats.barrier_count++;
+        }
+
+        uint32_t t_scope = UINT32_MAX;
+        if( p_profiler )
+        {
+            t_scope = p_profiler->begin( p_cmd, t_pass.name );
+        }
+
+        if( t_pass.func )
+        {
+            t_pass.func( p_cmd );
+        }
+
+        if( p_profiler )
+        {
+            p_profiler->end( p_cmd, t_scope );
+        }
+    }
+
+    // hand imported images back in the layout the outside world expects
+    t_imageBarriers.clear();
+    VkPipelineStageFlags t_srcStages = 0;
+    for( size_t i = 0; i < mResources.size(); ++i )
+    {
+        const Resource & t_resource = mResources[i];
+        const State & t_state = t_states[i];
+        if( !t_resource.imported || !t_resource.is_image || t_resource.final_layout == VK_IMAGE_LAYOUT_UNDEFINED ||
+            t_resource.final_layout == t_state.layout )
+        {
+            continue;
+        }
+
+        VkImageMemoryBarrier t_image = {};
+        t_image.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        t_image.pNext = nullptr;
+        t_image.srcAccessMask = t_state.write_access;
+        t_image.dstAccessMask = 0;
+        t_image.oldLayout = t_state.layout;
+        t_image.newLayout = t_resource.final_layout;
+        t_image.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        t_image.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        t_image.image = t_resource.image;
+        t_image.subresourceRange.aspectMask = aspect_of( t_resource.format );
+        t_image.subresourceRange.baseMipLevel = 0;
+        t_image.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+        t_image.subresourceRange.baseArrayLayer = 0;
+        t_image.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+        t_imageBarriers.push_back( t_image );
+
+        t_srcStages |= t_state.write_stages | t_state.read_stages;
+    }
+
+    if( !t_imageBarriers.empty() )
+    {
+        vkd.CmdPipelineBarrier( p_cmd, t_srcStages ? t_srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                              0, nullptr, 0, nullptr, (uint32_t)t_imageBarriers.size(), t_imageBarriers.data() );
+        mStats.barrier_count++;
+    }
+
+    mPasses.clear();
+    return false;
+}
+
+VkImage frameGraph::image( GraphResource p_resource ) const
+{
+    return p_resource < mResources.size() ? mResources[p_resource].image : VK_NULL_HANDLE;
+}
+
+VkImageView frameGraph::view( GraphResource p_resource ) const
+{
+    return p_resource < mResources.size() ? mResources[p_resource].view : VK_NULL_HANDLE;
+}
+
+VkBuffer frameGraph::buffer( GraphResource p_resource ) const
+{
+    return p_resource < mResources.size() ? mResources[p_resource].buffer : VK_NULL_HANDLE;
+}
+
+ROOT_SPACE::GraphStats frameGraph::stats(void) const
+{
+    return mStats;
+}
+
+namespace ROOT_SPACE
+{
+    // the graph is only open between beginFrame and endFrame
+    static renderContext * graph_context( vulkanInfo & p_vulInfo, window * p_window, const char * p_caller )
+    {
+        renderContext * t_context = find_context( p_vulInfo, p_window );
+        if( !t_context || !t_context->frames )
+        {
+            LOG.error( "{0} Failure: no render context for this target", p_caller );
+            return nullptr;
+        }
+        return t_context;
+    }
+
+    GraphResource VGraphical::graphBackbuffer( window * p_window )
+    {
+        renderContext * t_context = graph_context( vulkanInfo::instance, p_window, "graphBackbuffer" );
+        if( !t_context )
+        {
+            return GRAPH_RESOURCE_NONE;
+        }
+
+        if( t_context->graph_backbuffer == GRAPH_RESOURCE_NONE )
+        {
+            const SwapchainBuffers & t_buffer = t_context->buffers[t_context->current_buffer];
+            const bool t_present = t_context->swapchain != VK_NULL_HANDLE;
+
+            // swapchain images wait on the acquire semaphore at color output,
+            // so their first transition has to come after that stage; an
+            // offscreen image may still be in use by an earlier frame on the
+            // queue, whatever it was used for, since there can be fewer
+            // images than frames in flight
+            t_context->graph_backbuffer = t_context->graph.importImage( "backbuffer", t_buffer.image, t_buffer.view, t_context->format, t_context->extent,
+                                                                        VK_IMAGE_LAYOUT_UNDEFINED,
+                                                                        t_present ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_UNDEFINED,
+                                                                        t_present ? VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                                                        t_present ? 0 : VK_ACCESS_MEMORY_WRITE_BIT );
+        }
+
+        return t_context->graph_backbuffer;
+    }
+
+    GraphResource VGraphical::graphCreateImage( const char * p_name, const VkFormat p_format, const VkExtent2D & p_extent, window * p_window )
+    {
+        renderContext * t_context = graph_context( vulkanInfo::instance, p_window, "graphCreateImage" );
+        return t_context ? t_context->graph.createImage( p_name, p_format, p_extent ) : GRAPH_RESOURCE_NONE;
+    }
+
+    GraphResource VGraphical::graphCreateBuffer( const char * p_name, const VkDeviceSize p_size, window * p_window )
+    {
+        renderContext * t_context = graph_context( vulkanInfo::instance, p_window, "graphCreateBuffer" );
+        return t_context ? t_context->graph.createBuffer( p_name, p_size ) : GRAPH_RESOURCE_NONE;
+    }
+
+    GraphResource VGraphical::graphImportImage( const char * p_name, VkImage p_image, VkImageView p_view, const VkFormat p_format,
+                                                const VkExtent2D & p_extent, const VkImageLayout p_initialLayout,
+                                                const VkImageLayout p_finalLayout, window * p_window )
+    {
+        renderContext * t_context = graph_context( vulkanInfo::instance, p_window, "graphImportImage" );
+        return t_context ? t_context->graph.importImage( p_name, p_image, p_view, p_format, p_extent, p_initialLayout, p_finalLayout ) : GRAPH_RESOURCE_NONE;
+    }
+
+    GraphResource VGraphical::graphImportBuffer( const char * p_name, VkBuffer p_buffer, const VkDeviceSize p_size, window * p_window )
+    {
+        renderContext * t_context = graph_context( vulkanInfo::instance, p_window, "graphImportBuffer" );
+        return t_context ? t_context->graph.importBuffer( p_name, p_buffer, p_size ) : GRAPH_RESOURCE_NONE;
+    }
+
+    bool VGraphical::graphAddPass( const char * p_name, const std::vector< GraphAccess > & p_accesses,
+                                   const std::function< void( VkCommandBuffer ) > & p_func, const bool p_keep,
+                                   window * p_window )
+    {
+        renderContext * t_context = graph_context( vulkanInfo::instance, p_window, "graphAddPass" );
+        if( !t_context )
+        {
+            return true;
+        }
+        return t_context->graph.addPass( p_name, p_accesses, p_func, p_keep );
+    }
+
+    VkImage VGraphical::graphImage( const GraphResource p_resource, window * p_window )
+    {
+        renderContext * t_context = find_context( vulkanInfo::instance, p_window );
+        return t_context ? t_context->graph.image( p_resource ) : VK_NULL_HANDLE;
+    }
+
+    VkImageView VGraphical::graphImageView( const GraphResource p_resource, window * p_window )
+    {
+        renderContext * t_context = find_context( vulkanInfo::instance, p_window );
+        return t_context ? t_context->graph.view( p_resource ) : VK_NULL_HANDLE;
+    }
+
+    VkBuffer VGraphical::graphBuffer( const GraphResource p_resource, window * p_window )
+    {
+        renderContext * t_context = find_context( vulkanInfo::instance, p_window );
+        return t_context ? t_context->graph.buffer( p_resource ) : VK_NULL_HANDLE;
+    }
+
+    GraphStats VGraphical::getGraphStats( window * p_window )
+    {
+        renderContext * t_context = find_context( vulkanInfo::instance, p_window );
+        return t_context ? t_context->graph.stats() : GraphStats();
+    }
+
+    VkFormat VGraphical::getDepthFormat(void)
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+
+        if( wait_device( vulInfo ) )
+        {
+            return VK_FORMAT_UNDEFINED;
+        }
+
+        const VkFormat candidates[] = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D16_UNORM };
+
+        for( uint32_t i = 0; i < sizeof( candidates ) / sizeof( candidates[0] ); ++i )
+        {
+            VkFormatProperties props;
+            vkGetPhysicalDeviceFormatProperties( vulInfo.gpu, candidates[i], &props );
+            if( props.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT )
+            {
+                return candidates[i];
+            }
+        }
+
+        // required to be supported by every implementation
+        return VK_FORMAT_D16_UNORM;
+    }
+}
@@ -0,0 +1,340 @@
+#include "gpuProfiler.h"
+#include "vulkanInfo.h"
+#include "VGraphical.h"
+#include "log.hpp"
+#include <cassert>
+#include <cstdio>
+#include <algorithm>
+
+// scopes per frame slot, each one takes a begin and an end query
+#define GPU_PROFILER_SCOPES 256
+#define GPU_PROFILER_HISTORY 128
+#define GPU_PROFILER_TRACE_EVENTS 16384
+
+gpuProfiler::gpuProfiler(void)
+{
+    mDevice = VK_NULL_HANDLE;
+    mPeriod = 1.0;
+    mMask = ~0ull;
+    mCapacity = 0;
+    mFrameSlot = 0;
+    mUsed = 0;
+    mOrigin = 0;
+    mTraceHead = 0;
+}
+
+bool gpuProfiler::init( VkDevice p_device, const VkPhysicalDeviceLimits & p_limits, uint32_t p_validBits, uint32_t p_frameCount )
+{
+    VkResult U_ASSERT_ONLY err;
+
+    mDevice = p_device;
+    mFrameSlot = 0;
+    mUsed = 0;
+
+    if( p_validBits == 0 )
+    {
+        LOG.warning( "gpu profiler disabled: the graphics queue does not support timestamps" );
+        mCapacity = 0;
+        return false;
+    }
+
+    mPeriod = p_limits.timestampPeriod;
+    mMask = p_validBits >= 64 ? ~0ull : ( ( 1ull << p_validBits ) - 1 );
+    mCapacity = GPU_PROFILER_SCOPES;
+
+    mFrames.resize( p_frameCount );
+    for( uint32_t i = 0; i < p_frameCount; ++i )
+    {
+        VkQueryPoolCreateInfo t_info = {};
+        t_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        t_info.pNext = nullptr;
+        t_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        t_info.queryCount = mCapacity * 2;
+
+        err = vkd.CreateQueryPool( mDevice, &t_info, nullptr, &mFrames[i].pool );
+        assert(!err);
+
+        mFrames[i].names.resize( mCapacity, nullptr );
+        mFrames[i].used = 0;
+    }
+
+    return false;
+}
+
+void gpuProfiler::destroy(void)
+{
+    for( size_t i = 0; i < mFrames.size(); ++i )
+    {
+        vkd.DestroyQueryPool( mDevice, mFrames[i].pool, nullptr );
+    }
+    mFrames.clear();
+    mCapacity = 0;
+}
+
+void gpuProfiler::beginFrame( uint32_t p_frameSlot, VkCommandBuffer p_cmd )
+{
+    if( mFrames.empty() )
+    {
+        return;
+    }
+
+    mFrameSlot = p_frameSlot;
+    FrameQueries & t_frame = mFrames[mFrameSlot];
+
+    collect( t_frame );
+
+    t_frame.used = 0;
+    mUsed = 0;
+    vkd.CmdResetQueryPool( p_cmd, t_frame.pool, 0, mCapacity * 2 );
+}
+
+void gpuProfiler::endFrame(void)
+{
+    if( mFrames.empty() )
+    {
+        return;
+    }
+
+    mFrames[mFrameSlot].used = std::min( (uint32_t)mUsed, mCapacity );
+}
+
+uint32_t gpuProfiler::begin( VkCommandBuffer p_cmd, const char * p_name )
+{
+    if( mFrames.empty() )
+    {
+        return UINT32_MAX;
+    }
+
+    const uint32_t t_scope = mUsed.fetch_add( 1 );
+    if( t_scope >= mCapacity )
+    {
+        return UINT32_MAX;
+    }
+
+    FrameQueries & t_frame = mFrames[mFrameSlot];
+    t_frame.names[t_scope] = p_name;
+    vkd.CmdWriteTimestamp( p_cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, t_frame.pool, t_scope * 2 );
+
+    return t_scope;
+}
+
+void gpuProfiler::end( VkCommandBuffer p_cmd, uint32_t p_scope )
+{
+    if( p_scope >= mCapacity || mFrames.empty() )
+    {
+        return;
+    }
+
+    vkd.CmdWriteTimestamp( p_cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mFrames[mFrameSlot].pool, p_scope * 2 + 1 );
+}
+
+void gpuProfiler::collect( FrameQueries & p_frame )
+{
+    if( p_frame.used == 0 )
+    {
+        return;
+    }
+
+    // value and availability per query; a scope whose end was never
+    // recorded stays unavailable and is skipped instead of waited for
+    std::vector< uint64_t > t_results( p_frame.used * 2 * 2 );
+    VkResult t_err = vkd.GetQueryPoolResults( mDevice, p_frame.pool, 0, p_frame.used * 2,
+                                            t_results.size() * sizeof( uint64_t ), t_results.data(), 2 * sizeof( uint64_t ),
+                                            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT );
+    if( t_err != VK_SUCCESS && t_err != VK_NOT_READY )
+    {
+        LOG.error( "gpu profiler: vkGetQueryPoolResults returned {0}", (int)t_err );
+        return;
+    }
+
+    std::lock_guard< std::mutex > t_lock( mMutex );
+    if( mTrace.empty() )
+    {
+        mTrace.resize( GPU_PROFILER_TRACE_EVENTS );
+    }
+
+    for( uint32_t i = 0; i < p_frame.used; ++i )
+    {
+        const uint64_t * t_begin = &t_results[i * 4];
+        const uint64_t * t_end = &t_results[i * 4 + 2];
+        if( !t_begin[1] || !t_end[1] )
+        {
+            continue;
+        }
+
+        if( mOrigin == 0 )
+        {
+            mOrigin = t_begin[0];
+        }
+
+        const double t_duration = (double)( ( t_end[0] - t_begin[0] ) & mMask ) * mPeriod / 1000.0;
+
+        TraceEvent & t_event = mTrace[mTraceHead];
+        t_event.name = p_frame.names[i];
+        t_event.begin_us = (double)( ( t_begin[0] - mOrigin ) & mMask ) * mPeriod / 1000.0;
+        t_event.duration_us = t_duration;
+        mTraceHead = ( mTraceHead + 1 ) % GPU_PROFILER_TRACE_EVENTS;
+
+        PassHistory & t_history = mHistory[p_frame.names[i]];
+        if( t_history.samples.empty() )
+        {
+            t_history.samples.resize( GPU_PROFILER_HISTORY );
+            t_history.head = 0;
+            t_history.count = 0;
+        }
+        t_history.samples[t_history.head] = t_duration / 1000.0;
+        t_history.head = ( t_history.head + 1 ) % GPU_PROFILER_HISTORY;
+        t_history.count = std::min( t_history.count + 1, (uint32_t)GPU_PROFILER_HISTORY );
+    }
+}
+
+void gpuProfiler::stats( std::vector< ROOT_SPACE::GpuPassStats > & p_out ) const
+{
+    std::lock_guard< std::mutex > t_lock( mMutex );
+    for( std::map< std::string, PassHistory >::const_iterator t_it = mHistory.begin(); t_it != mHistory.end(); ++t_it )
+    {
+        const PassHistory & t_history = t_it->second;
+
+        ROOT_SPACE::GpuPassStats t_stats;
+        t_stats.name = t_it->first;
+        t_stats.samples = t_history.count;
+        t_stats.last_ms = t_history.samples[( t_history.head + GPU_PROFILER_HISTORY - 1 ) % GPU_PROFILER_HISTORY];
+        t_stats.min_ms = t_stats.last_ms;
+        t_stats.max_ms = t_stats.last_ms;
+
+        double t_sum = 0.0;
+        for( uint32_t i = 0; i < t_history.count; ++i )
+        {
+            const double t_sample = t_history.samples[i];
+            t_sum += t_sample;
+            t_stats.min_ms = std::min( t_stats.min_ms, t_sample );
+            t_stats.max_ms = std::max( t_stats.max_ms, t_sample );
+        }
+        t_stats.avg_ms = t_sum / t_history.count;
+
+        p_out.push_back( t_stats );
+    }
+}
+
+void gpuProfiler::trace( std::vector< TraceEvent > & p_out ) const
+{
+    std::lock_guard< std::mutex > t_lock( mMutex );
+    // oldest first, the ring may not have wrapped yet
+    for( size_t i = 0; i < mTrace.size(); ++i )
+    {
+        const TraceEvent & t_event = mTrace[( mTraceHead + i ) % mTrace.size()];
+        if( t_event.name )
+        {
+            p_out.push_back( t_event );
+        }
+    }
+}
+
+namespace ROOT_SPACE
+{
+    uint32_t VGraphical::gpuBegin( VkCommandBuffer p_cmd, const char * p_name, window * p_window )
+    {
+        renderContext * t_context = find_context( vulkanInfo::instance, p_window );
+        if( !t_context )
+        {
+            return UINT32_MAX;
+        }
+        return t_context->profiler.begin( p_cmd, p_name );
+    }
+
+    void VGraphical::gpuEnd( VkCommandBuffer p_cmd, const uint32_t p_scope, window * p_window )
+    {
+        renderContext * t_context = find_context( vulkanInfo::instance, p_window );
+        if( t_context )
+        {
+            t_context->profiler.end( p_cmd, p_scope );
+        }
+    }
+
+    std::vector< GpuPassStats > VGraphical::getGpuStats( window * p_window )
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+        std::vector< GpuPassStats > t_stats;
+
+        // held throughout so the context cannot be destroyed under us
+        std::lock_guard< std::mutex > t_lock( vulInfo.contexts_mutex );
+        renderContext * t_context = find_context_locked( vulInfo, p_window );
+        if( t_context )
+        {
+            t_context->profiler.stats( t_stats );
+        }
+        return t_stats;
+    }
+
+    static void write_json_string( FILE * p_file, const char * p_text )
+    {
+        fputc( '"', p_file );
+        for( const char * t_c = p_text; *t_c; ++t_c )
+        {
+            if( *t_c == '"' || *t_c == '\\' )
+            {
+                fputc( '\\', p_file );
+            }
+            fputc( *t_c, p_file );
+        }
+        fputc( '"', p_file );
+    }
+
+    bool VGraphical::exportGpuTrace( const std::string & p_path )
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+
+        FILE * t_file = fopen( p_path.c_str(), "w" );
+        if( !t_file )
+        {
+            LOG.error( "exportGpuTrace Failure: cannot open {0}", p_path );
+            return true;
+        }
+
+        // copied out under the lock, contexts may be destroyed once it is released
+        std::vector< bool > t_windows;
+        std::vector< std::vector< gpuProfiler::TraceEvent > > t_traces;
+        {
+            std::lock_guard< std::mutex > t_lock( vulInfo.contexts_mutex );
+            for( std::map< GLFWwindow *, renderContext * >::iterator t_it = vulInfo.contexts.begin(); t_it != vulInfo.contexts.end(); ++t_it )
+            {
+                t_windows.push_back( true );
+                t_traces.push_back( std::vector< gpuProfiler::TraceEvent >() );
+                t_it->second->profiler.trace( t_traces.back() );
+            }
+            if( vulInfo.offscreen )
+            {
+                t_windows.push_back( false );
+                t_traces.push_back( std::vector< gpuProfiler::TraceEvent >() );
+                vulInfo.offscreen->profiler.trace( t_traces.back() );
+            }
+        }
+
+        // one trace thread per render target, complete ("X") events in microseconds
+        fprintf( t_file, "{\"traceEvents\":[" );
+        bool t_first = true;
+        for( size_t i = 0; i < t_traces.size(); ++i )
+        {
+            fprintf( t_file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}",
+                     t_first ? "" : ",", (uint32_t)i, t_windows[i] ? "gpu window" : "gpu offscreen", (uint32_t)i );
+            t_first = false;
+
+            const std::vector< gpuProfiler::TraceEvent > & t_events = t_traces[i];
+            for( size_t e = 0; e < t_events.size(); ++e )
+            {
+                fprintf( t_file, ",\n{\"name\":" );
+                write_json_string( t_file, t_events[e].name );
+                fprintf( t_file, ",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                         (uint32_t)i, t_events[e].begin_us, t_events[e].duration_us );
+            }
+        }
+        fprintf( t_file, "\n],\"displayTimeUnit\":\"ms\"}\n" );
+
+        if( fclose( t_file ) != 0 )
+        {
+            LOG.error( "exportGpuTrace Failure: cannot write {0}", p_path );
+            return true;
+        }
+        return false;
+    }
+}
@@ -1,17 +1,14 @@
 #include "vulkanInfo.h"
 #include "VGraphical.h"
 #include "log.hpp"
+#include "cpuProfiler.h"
 #include <cassert>
+#include <algorithm>
 
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
 
-#if defined(NDEBUG) && defined(__GNUC__)
-#define U_ASSERT_ONLY __attribute__((unused))
-#else
-#define U_ASSERT_ONLY
-#endif
-
 vulkanInfo vulkanInfo::instance;
+ROOT_SPACE::DeviceDispatch vkd;
 
 namespace ROOT_SPACE
 {
@@ -28,13 +25,32 @@ namespace ROOT_SPACE
 
     #define GET_DEVICE_PROC_ADDR(dev, entrypoint)                                  \
     {                                                                          \
-        vulInfo.fp##entrypoint =                                                 \
+        vkd.entrypoint =                                                       \
             (PFN_vk##entrypoint)vkGetDeviceProcAddr(dev, "vk" #entrypoint);    \
-        if (vulInfo.fp##entrypoint == nullptr) {                                    \
-            LOG.error("vkGetDeviceProcAddr Failure: vkGetDeviceProcAddr failed to find vk" #entrypoint );                           \
+        if (vkd.entrypoint == nullptr) {                                       \
+            LOG.error("vkGetDeviceProcAddr Failure: vkGetDeviceProcAddr failed to find vk" #entrypoint ); \
+            t_missing = true;                                                  \
         }                                                                      \
     }
 
+    // fills vkd once per device, the loader's exported functions would
+    // look the device's dispatch table up again on every call
+    static bool load_device_dispatch( vulkanInfo & p_vulInfo )
+    {
+        bool t_missing = false;
+        vkd = DeviceDispatch();
+
+        #define LOAD_DEVICE_FUNCTION( name ) GET_DEVICE_PROC_ADDR( p_vulInfo.device, name )
+        VGRAPHICAL_DEVICE_FUNCTIONS( LOAD_DEVICE_FUNCTION )
+        if( !p_vulInfo.headless )
+        {
+            VGRAPHICAL_SWAPCHAIN_FUNCTIONS( LOAD_DEVICE_FUNCTION )
+        }
+        #undef LOAD_DEVICE_FUNCTION
+
+        return t_missing;
+    }
+
     /*
     * Return 1 (true) if all layer names specified in check_names
     * can be found in given layer properties.
@@ -100,7 +116,7 @@ namespace ROOT_SPACE
         return false;
     }
 
-static bool memory_type_from_properties(vulkanInfo & p_vulInfo, uint32_t typeBits,
+bool memory_type_from_properties(vulkanInfo & p_vulInfo, uint32_t typeBits,
                                         VkFlags requirements_mask,
                                         uint32_t *typeIndex) {
     uint32_t i;
@@ -120,57 +136,69 @@ static bool memory_type_from_properties(vulkanInfo & p_vulInfo, uint32_t typeBit
     return false;
 }
 
-    bool VGraphical::initGraphical(void)
+    bool prepare_command_pool( vulkanInfo & p_vulInfo )
     {
+        VkResult U_ASSERT_ONLY err;
 
-        glfwSetErrorCallback( VGraphical::__glfw_error_callback );
+		VkCommandPoolCreateInfo cmd_pool_info = {};
+		cmd_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		cmd_pool_info.queueFamilyIndex = p_vulInfo.graphics_queue_node_index;
+		cmd_pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
-        if (!glfwInit()) 
-        {
-            LOG.error("Cannot initialize GLFW.\nExiting ...");
-            return true;
-        }
+        err = vkd.CreateCommandPool(p_vulInfo.device, &cmd_pool_info, nullptr, &p_vulInfo.cmd_pool);
+        assert(!err);
 
-        if (!glfwVulkanSupported())
-        {
-            LOG.error("GLFW failed to find the Vulkan loader.\nExiting ...");
-            return true;
-        }
+		VkCommandBufferAllocateInfo cmd = {};
+        cmd.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cmd.pNext = nullptr;
+        cmd.commandPool = p_vulInfo.cmd_pool;
+        cmd.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        cmd.commandBufferCount = 1;
 
-        VkResult err;
+        err = vkd.AllocateCommandBuffers(p_vulInfo.device, &cmd, &p_vulInfo.setup_cmd);
+        assert(!err);
 
-        vulkanInfo & vulInfo = vulkanInfo::instance;
-		vulInfo.validate = true;
+        return false;
+    }
 
-        vulInfo.enabled_layer_count = 0;
-        vulInfo.enabled_extension_count = 0;
+    bool VGraphical::isHeadless(void)
+    {
+        return vulkanInfo::instance.headless;
+    }
 
-        const char **instance_validation_layers = nullptr;
+    static const char * instance_validation_layers[] = {
+        "VK_LAYER_KHRONOS_validation"
+    };
 
+    static const char * instance_validation_layers_alt1[] = {
+        "VK_LAYER_LUNARG_standard_validation"
+    };
 
-        char *instance_validation_layers_alt1[] = {
-            "VK_LAYER_LUNARG_standard_validation"
-        };
+    static const char * instance_validation_layers_alt2[] = {
+        "VK_LAYER_GOOGLE_threading",       "VK_LAYER_LUNARG_parameter_validation",
+        "VK_LAYER_LUNARG_object_tracker",  "VK_LAYER_LUNARG_image",
+        "VK_LAYER_LUNARG_core_validation", "VK_LAYER_LUNARG_swapchain",
+        "VK_LAYER_GOOGLE_unique_objects"
+    };
+
+    // only talks to the loader, so it runs while glfw initializes
+    static bool enumerate_instance_support( vulkanInfo & p_vulInfo, bool * p_debugReport )
+    {
+        startupScope t_phase( p_vulInfo, "instance enumeration", true );
+        VkResult U_ASSERT_ONLY err;
+
+        *p_debugReport = false;
+        p_vulInfo.properties2 = false;
 
-        char *instance_validation_layers_alt2[] = {
-            "VK_LAYER_GOOGLE_threading",       "VK_LAYER_LUNARG_parameter_validation",
-            "VK_LAYER_LUNARG_object_tracker",  "VK_LAYER_LUNARG_image",
-            "VK_LAYER_LUNARG_core_validation", "VK_LAYER_LUNARG_swapchain",
-            "VK_LAYER_GOOGLE_unique_objects"
-        };
-       
         /* Look for validation layers */
         VkBool32 validation_found = 0;
-        if( vulInfo.validate )
+        if( p_vulInfo.validate )
         {
             //get instance layer count
             uint32_t instance_layer_count = 0;
             err = vkEnumerateInstanceLayerProperties(&instance_layer_count, nullptr);
             assert(!err);
 
-            instance_validation_layers = (const char **)instance_validation_layers_alt1;
-
-            
             if (instance_layer_count > 0) 
             {
                 //check instance layer count
@@ -182,61 +210,48 @@ static bool memory_type_from_properties(vulkanInfo & p_vulInfo, uint32_t typeBit
 
                 //check 
                 validation_found = vulkan_check_layers(
-                    ARRAY_SIZE(instance_validation_layers_alt1),
+                    ARRAY_SIZE(instance_validation_layers),
                     instance_validation_layers, instance_layer_count,
                     instance_layers);
-                if (validation_found) 
+                if (validation_found)
+                {
+                    p_vulInfo.enabled_layer_count = ARRAY_SIZE(instance_validation_layers);
+                    p_vulInfo.enabled_layers[0] = instance_validation_layers[0];
+                } else if ((validation_found = vulkan_check_layers(
+                    ARRAY_SIZE(instance_validation_layers_alt1),
+                    instance_validation_layers_alt1, instance_layer_count,
+                    instance_layers)))
                 {
-                    vulInfo.enabled_layer_count = ARRAY_SIZE(instance_validation_layers_alt1);
-                    vulInfo.enabled_layers[0] = instance_validation_layers[0];
+                    p_vulInfo.enabled_layer_count = ARRAY_SIZE(instance_validation_layers_alt1);
+                    p_vulInfo.enabled_layers[0] = instance_validation_layers_alt1[0];
                 } else 
                 {
                     // use alternative set of validation layers
-                    instance_validation_layers = (const char **)instance_validation_layers_alt2;
-                    vulInfo.enabled_layer_count = ARRAY_SIZE(instance_validation_layers_alt2);
+                    p_vulInfo.enabled_layer_count = ARRAY_SIZE(instance_validation_layers_alt2);
                     validation_found = vulkan_check_layers(
                         ARRAY_SIZE(instance_validation_layers_alt2),
-                        instance_validation_layers, instance_layer_count,
+                        instance_validation_layers_alt2, instance_layer_count,
                         instance_layers);
-                    uint32_t validation_layer_count =
-                        ARRAY_SIZE(instance_validation_layers_alt2);
-                    for (uint32_t i = 0; i < validation_layer_count; i++) 
+                    for (uint32_t i = 0; i < p_vulInfo.enabled_layer_count; i++) 
                     {
-                        vulInfo.enabled_layers[i] = instance_validation_layers[i];
+                        p_vulInfo.enabled_layers[i] = instance_validation_layers_alt2[i];
                     }
                 }
                 free(instance_layers);
             }
 
+            // a missing sdk should not keep the application from running
             if(!validation_found)
             {
-				LOG.error ( "vkEnumerateInstanceLayerProperties failed to find "
-					"required validation layer.\n\n"
+				LOG.warning ( "vkEnumerateInstanceLayerProperties failed to find "
+					"a validation layer, running without validation.\n\n"
 					"Please look at the Getting Started guide for additional "
 					"information." );
-                return true;
+                p_vulInfo.enabled_layer_count = 0;
+                p_vulInfo.validate = false;
             }
         }
 
-        /* Look for instance extensions */
-        uint32_t required_extension_count = 0;
-        const char **required_extensions = glfwGetRequiredInstanceExtensions(&required_extension_count);
-        if (!required_extensions)
-        {
-            LOG.error("glfwGetRequiredInstanceExtensions failed to find the "
-                 "platform surface extensions.\n\nDo you have a compatible "
-                 "Vulkan installable client driver (ICD) installed?\nPlease "
-                 "look at the Getting Started guide for additional "
-                 "information.");
-            return true;
-        }
-
-        for (uint32_t i = 0; i < required_extension_count; i++)
-        {
-            vulInfo.extension_names[vulInfo.enabled_extension_count++] = required_extensions[i];
-            assert( vulInfo.enabled_extension_count < 64 );
-        }
-
         uint32_t instance_extension_count = 0;
         err = vkEnumerateInstanceExtensionProperties( nullptr, &instance_extension_count, nullptr );
         assert( !err );
@@ -251,107 +266,131 @@ static bool memory_type_from_properties(vulkanInfo & p_vulInfo, uint32_t typeBit
             {
                 if ( !strcmp( VK_EXT_DEBUG_REPORT_EXTENSION_NAME, instance_extensions[i].extensionName ) ) 
                 {
-                    if ( vulInfo.validate ) 
-                    {
-                        vulInfo.extension_names[vulInfo.enabled_extension_count++] = VK_EXT_DEBUG_REPORT_EXTENSION_NAME;
-                    }
+                    *p_debugReport = true;
+                }
+                if ( !strcmp( VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME, instance_extensions[i].extensionName ) ) 
+                {
+                    p_vulInfo.properties2 = true;
                 }
-                assert( vulInfo.enabled_extension_count < 64 );
             }
 
             free( instance_extensions );
         }
 
-		VkApplicationInfo app;
-		app.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-		app.pNext = nullptr;
-		app.pApplicationName = "haha";
-		app.applicationVersion = 0;
-		app.pEngineName = "ws";
-		app.engineVersion = 0;
-		app.apiVersion = VK_API_VERSION_1_0;
-
-		VkInstanceCreateInfo inst_info;
-		inst_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-		inst_info.pNext = nullptr;
-        inst_info.flags = 0;
-		inst_info.pApplicationInfo = &app;
-		inst_info.enabledLayerCount = vulInfo.enabled_layer_count;
-		inst_info.ppEnabledLayerNames = (const char *const *)instance_validation_layers;
-		inst_info.enabledExtensionCount = vulInfo.enabled_extension_count;
-		inst_info.ppEnabledExtensionNames = (const char *const *)vulInfo.extension_names;
-
-        uint32_t gpu_count;
+        t_phase.done();
+        return false;
+    }
 
-        err = vkCreateInstance( &inst_info, nullptr, &vulInfo.inst );
-        if (err == VK_ERROR_INCOMPATIBLE_DRIVER) 
-        {
-            LOG.error( "vkCreateInstance Failure: Cannot find a compatible Vulkan installable client driver "
-                    "(ICD).\n\nPlease look at the Getting Started guide for "
-                    "additional information." );
-            return true;
-        } else if (err == VK_ERROR_EXTENSION_NOT_PRESENT) 
-        {
-            LOG.error( "vkCreateInstance Failure: Cannot find a specified extension library"
-                    ".\nMake sure your layers path is set appropriately" );
-            return true;
-        } else if (err) 
+    // true when the gpu has every descriptor indexing feature bindlessTable
+    // relies on; lowers the table sizes to what it can hold
+    static bool query_descriptor_indexing( vulkanInfo & p_vulInfo )
+    {
+        PFN_vkGetPhysicalDeviceFeatures2KHR t_getFeatures2 =
+            (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr( p_vulInfo.inst, "vkGetPhysicalDeviceFeatures2KHR" );
+        PFN_vkGetPhysicalDeviceProperties2KHR t_getProperties2 =
+            (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr( p_vulInfo.inst, "vkGetPhysicalDeviceProperties2KHR" );
+        if( !t_getFeatures2 || !t_getProperties2 )
         {
-            LOG.error( "vkCreateInstance Failure: vkCreateInstance failed.\n\nDo you have a compatible Vulkan "
-                    "installable client driver (ICD) installed?\nPlease look at "
-                    "the Getting Started guide for additional information." );
-            return true;
+            return false;
         }
 
-        /* Make initial call to query gpu_count, then second call for gpu info*/
-        err = vkEnumeratePhysicalDevices( vulInfo.inst, &gpu_count, nullptr );
-        assert( !err && gpu_count > 0 );
+        VkPhysicalDeviceDescriptorIndexingFeaturesEXT t_indexing = {};
+        t_indexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+        VkPhysicalDeviceFeatures2KHR t_features = {};
+        t_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+        t_features.pNext = &t_indexing;
+        t_getFeatures2( p_vulInfo.gpu, &t_features );
+
+        if( !t_indexing.runtimeDescriptorArray || !t_indexing.descriptorBindingPartiallyBound
+            || !t_indexing.descriptorBindingUpdateUnusedWhilePending
+            || !t_indexing.descriptorBindingSampledImageUpdateAfterBind || !t_indexing.descriptorBindingStorageBufferUpdateAfterBind
+            || !t_indexing.shaderSampledImageArrayNonUniformIndexing || !t_indexing.shaderStorageBufferArrayNonUniformIndexing )
+        {
+            return false;
+        }
 
-        if ( gpu_count > 0 ) 
+        VkPhysicalDeviceDescriptorIndexingPropertiesEXT t_limits = {};
+        t_limits.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+        VkPhysicalDeviceProperties2KHR t_properties = {};
+        t_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+        t_properties.pNext = &t_limits;
+        t_getProperties2( p_vulInfo.gpu, &t_properties );
+
+        // images count as a sampler and a sampled image each, every stage sees the whole table
+        uint32_t t_images = std::min( p_vulInfo.profile.bindless_images, t_limits.maxDescriptorSetUpdateAfterBindSampledImages );
+        t_images = std::min( t_images, t_limits.maxDescriptorSetUpdateAfterBindSamplers );
+        t_images = std::min( t_images, t_limits.maxPerStageDescriptorUpdateAfterBindSampledImages );
+        t_images = std::min( t_images, t_limits.maxPerStageDescriptorUpdateAfterBindSamplers );
+        uint32_t t_buffers = std::min( p_vulInfo.profile.bindless_buffers, t_limits.maxDescriptorSetUpdateAfterBindStorageBuffers );
+        t_buffers = std::min( t_buffers, t_limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers );
+
+        // both arrays share the per stage resource budget
+        const uint32_t t_resources = t_limits.maxPerStageUpdateAfterBindResources;
+        if( (uint64_t)t_images * 2 + t_buffers > t_resources )
         {
-            VkPhysicalDevice *physical_devices = (VkPhysicalDevice *)malloc(sizeof(VkPhysicalDevice) * gpu_count );
-            err = vkEnumeratePhysicalDevices( vulInfo.inst, &gpu_count, physical_devices );
-            assert(!err);
+            const uint64_t t_asked = (uint64_t)t_images * 2 + t_buffers;
+            t_images = (uint32_t)( (uint64_t)t_images * t_resources / t_asked );
+            t_buffers = (uint32_t)( (uint64_t)t_buffers * t_resources / t_asked );
+        }
 
-            /* For tri demo we just grab the first physical device */
-            vulInfo.gpu = physical_devices[0];
-            free(physical_devices);
-        }else
+        if( !t_images || !t_buffers )
         {
-            LOG.error( "vkEnumeratePhysicalDevices reported zero accessible devices."
-                 "\n\nDo you have a compatible Vulkan installable client"
-                 " driver (ICD) installed?\nPlease look at the Getting Started"
-                 " guide for additional information." );
-            return true;
+            return false;
         }
 
+        p_vulInfo.bindless_images = t_images;
+        p_vulInfo.bindless_buffers = t_buffers;
+        return true;
+    }
+
+    // device extensions and properties, overlapped with the debug report setup
+    static bool query_physical_device( vulkanInfo & p_vulInfo )
+    {
+        startupScope t_phase( p_vulInfo, "physical device queries", true );
+        VkResult U_ASSERT_ONLY err;
+
         /* Look for device extensions */
         uint32_t device_extension_count = 0;
         VkBool32 swapchainExtFound = 0;
-        vulInfo.enabled_extension_count = 0;
+        VkBool32 indexingExtFound = 0;
+        VkBool32 maintenance3ExtFound = 0;
+        p_vulInfo.enabled_extension_count = 0;
 
-        err = vkEnumerateDeviceExtensionProperties( vulInfo.gpu, nullptr, &device_extension_count, nullptr );
+        err = vkEnumerateDeviceExtensionProperties( p_vulInfo.gpu, nullptr, &device_extension_count, nullptr );
 
         assert( !err );
 
         if (device_extension_count > 0) 
         {
             VkExtensionProperties *device_extensions = (VkExtensionProperties *)malloc (sizeof( VkExtensionProperties ) * device_extension_count );
-            err = vkEnumerateDeviceExtensionProperties( vulInfo.gpu, nullptr, &device_extension_count, device_extensions );
+            err = vkEnumerateDeviceExtensionProperties( p_vulInfo.gpu, nullptr, &device_extension_count, device_extensions );
             assert( !err );
 
             for (uint32_t i = 0; i < device_extension_count; i++) {
-                if ( !strcmp( VK_KHR_SWAPCHAIN_EXTENSION_NAME, device_extensions[i].extensionName ) ) {
+                if ( !p_vulInfo.headless && !strcmp( VK_KHR_SWAPCHAIN_EXTENSION_NAME, device_extensions[i].extensionName ) ) {
                     swapchainExtFound = 1;
-                    vulInfo.extension_names[vulInfo.enabled_extension_count++] = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+                    p_vulInfo.extension_names[p_vulInfo.enabled_extension_count++] = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
                 }
-                assert(vulInfo.enabled_extension_count < 64);
+                if ( !strcmp( VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME, device_extensions[i].extensionName ) ) {
+                    indexingExtFound = 1;
+                }
+                if ( !strcmp( VK_KHR_MAINTENANCE3_EXTENSION_NAME, device_extensions[i].extensionName ) ) {
+                    maintenance3ExtFound = 1;
+                }
+                assert(p_vulInfo.enabled_extension_count < 64);
             }
 
             free(device_extensions);
         }
 
-        if ( !swapchainExtFound ) {
+        // selection already skipped gpus without them
+        for ( size_t i = 0; i < p_vulInfo.profile.device_extensions.size(); i++ )
+        {
+            p_vulInfo.extension_names[p_vulInfo.enabled_extension_count++] = p_vulInfo.profile.device_extensions[i].c_str();
+            assert( p_vulInfo.enabled_extension_count < 64 );
+        }
+
+        if ( !p_vulInfo.headless && !swapchainExtFound ) {
             LOG.error("vkCreateInstance Failure: vkEnumerateDeviceExtensionProperties failed to find "
                     "the " VK_KHR_SWAPCHAIN_EXTENSION_NAME
                     " extension.\n\nDo you have a compatible "
@@ -360,88 +399,124 @@ static bool memory_type_from_properties(vulkanInfo & p_vulInfo, uint32_t typeBit
                     "information.\n");
         }
 
-        if( vulInfo.validate )
+        vkGetPhysicalDeviceProperties( p_vulInfo.gpu, &p_vulInfo.gpu_props );
+        
+        // Query with nullptr data to get count
+        vkGetPhysicalDeviceQueueFamilyProperties( p_vulInfo.gpu, &p_vulInfo.queue_count, nullptr );
+
+        p_vulInfo.queue_props = ( VkQueueFamilyProperties * )malloc( p_vulInfo.queue_count * sizeof( VkQueueFamilyProperties ) );
+        vkGetPhysicalDeviceQueueFamilyProperties(p_vulInfo.gpu, &p_vulInfo.queue_count, p_vulInfo.queue_props);
+
+        assert(p_vulInfo.queue_count >= 1);
+
+        vkGetPhysicalDeviceFeatures(p_vulInfo.gpu, &p_vulInfo.gpu_features);
+
+        p_vulInfo.bindless_supported = false;
+        if ( p_vulInfo.profile.bindless )
         {
-            vulInfo.CreateDebugReportCallback =
-            (PFN_vkCreateDebugReportCallbackEXT)vkGetInstanceProcAddr(
-                vulInfo.inst, "vkCreateDebugReportCallbackEXT");
-            if (!vulInfo.CreateDebugReportCallback) 
+            if ( p_vulInfo.properties2 && indexingExtFound && maintenance3ExtFound && query_descriptor_indexing( p_vulInfo ) )
             {
-                LOG.error( "vkGetProcAddr Failure: GetProcAddr: Unable to find vkCreateDebugReportCallbackEXT" );
-                return true;
+                p_vulInfo.bindless_supported = true;
+                p_vulInfo.extension_names[p_vulInfo.enabled_extension_count++] = VK_KHR_MAINTENANCE3_EXTENSION_NAME;
+                p_vulInfo.extension_names[p_vulInfo.enabled_extension_count++] = VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME;
+                assert( p_vulInfo.enabled_extension_count < 64 );
+                LOG.info( "bindless table: {0} images, {1} buffers", p_vulInfo.bindless_images, p_vulInfo.bindless_buffers );
+            }else
+            {
+                LOG.info( "bindless table: " VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME " unusable, descriptor sets only" );
             }
+        }
 
-            vulInfo.DestroyDebugReportCallback =
-            (PFN_vkDestroyDebugReportCallbackEXT)vkGetInstanceProcAddr(
-                vulInfo.inst, "vkDestroyDebugReportCallbackEXT");
+        // Get Memory information and properties
+        vkGetPhysicalDeviceMemoryProperties(p_vulInfo.gpu, &p_vulInfo.memory_properties);
 
-            if (!vulInfo.DestroyDebugReportCallback) 
-            {
-                LOG.error( "vkGetProcAddr Failure: GetProcAddr: Unable to find vkDestroyDebugReportCallbackEXT" );
-                return true;
-            }
+        t_phase.done();
+        return false;
+    }
 
-            vulInfo.DebugReportMessage =
-            (PFN_vkDebugReportMessageEXT)vkGetInstanceProcAddr(
-                vulInfo.inst, "vkDebugReportMessageEXT");
-            if( !vulInfo.DebugReportMessage )
+    // everything the render contexts need from the device; with an
+    // asynchronous init this runs while the app creates its windows
+    static bool create_device( vulkanInfo & vulInfo, const bool p_background )
+    {
+        startupScope t_phase( vulInfo, "device creation", p_background );
+        VkResult U_ASSERT_ONLY err;
+
+        // The device queue is created up front, so pick the first graphics
+        // family now; initWindow verifies it can also present.
+        vulInfo.graphics_queue_node_index = UINT32_MAX;
+        for ( uint32_t i = 0; i < vulInfo.queue_count; i++ )
+        {
+            if ( ( vulInfo.queue_props[i].queueFlags & VK_QUEUE_GRAPHICS_BIT ) != 0 )
             {
-                LOG.error("vkGetProcAddr Failure: GetProcAddr: Unable to find vkDebugReportMessageEXT" );
-                return true;
+                vulInfo.graphics_queue_node_index = i;
+                break;
             }
+        }
 
-            VkDebugReportCallbackCreateInfoEXT dbgCreateInfo;
-            dbgCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_REPORT_CREATE_INFO_EXT;
-            dbgCreateInfo.flags =
-                VK_DEBUG_REPORT_ERROR_BIT_EXT | VK_DEBUG_REPORT_WARNING_BIT_EXT;
-            dbgCreateInfo.pfnCallback = vulInfo.use_break ? BreakCallback : dbgFunc;
-            dbgCreateInfo.pUserData = &vulInfo;
-            dbgCreateInfo.pNext = nullptr;
+        if ( vulInfo.graphics_queue_node_index == UINT32_MAX )
+        {
+            LOG.error( "vkCreateDevice Failure: Could not find a graphics queue" );
+            return true;
+        }
 
-            err = vulInfo.CreateDebugReportCallback(vulInfo.inst, &dbgCreateInfo, nullptr,
-                                              &vulInfo.msg_callback);
-            switch (err) {
-            case VK_SUCCESS:
-                break;
-            case VK_ERROR_OUT_OF_HOST_MEMORY:
-                    LOG.error( "CreateDebugReportCallback Failure: CreateDebugReportCallback: out of host memory" );
-                    return true;
-                break;
-            default:
-                    LOG.error( "CreateDebugReportCallback Failure CreateDebugReportCallback: unknown failure" );
-                    return true;
-                break;
+        // async compute wants a family without graphics, transfer one with
+        // neither (the dma engines); whatever is missing falls back
+        vulInfo.compute_queue_node_index = vulInfo.graphics_queue_node_index;
+        vulInfo.transfer_queue_node_index = vulInfo.graphics_queue_node_index;
+        for ( uint32_t i = 0; i < vulInfo.queue_count; i++ )
+        {
+            const VkQueueFlags t_flags = vulInfo.queue_props[i].queueFlags;
+            if ( ( t_flags & VK_QUEUE_COMPUTE_BIT ) && !( t_flags & VK_QUEUE_GRAPHICS_BIT )
+                 && vulInfo.compute_queue_node_index == vulInfo.graphics_queue_node_index )
+            {
+                vulInfo.compute_queue_node_index = i;
+            }
+            if ( ( t_flags & VK_QUEUE_TRANSFER_BIT ) && !( t_flags & ( VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT ) )
+                 && vulInfo.transfer_queue_node_index == vulInfo.graphics_queue_node_index )
+            {
+                vulInfo.transfer_queue_node_index = i;
             }
         }
 
-        // Having these GIPA queries of device extension entry points both
-        // BEFORE and AFTER vkCreateDevice is a good test for the loader
-        GET_INSTANCE_PROC_ADDR( vulInfo.inst, GetPhysicalDeviceSurfaceCapabilitiesKHR );
-        GET_INSTANCE_PROC_ADDR( vulInfo.inst, GetPhysicalDeviceSurfaceFormatsKHR );
-        GET_INSTANCE_PROC_ADDR( vulInfo.inst, GetPhysicalDeviceSurfacePresentModesKHR );
-        GET_INSTANCE_PROC_ADDR( vulInfo.inst, GetPhysicalDeviceSurfaceSupportKHR );
-
-        vkGetPhysicalDeviceProperties( vulInfo.gpu, &vulInfo.gpu_props );
-        
-        // Query with nullptr data to get count
-        vkGetPhysicalDeviceQueueFamilyProperties( vulInfo.gpu, &vulInfo.queue_count, nullptr );
+        // no dma family, uploads may still use the compute family
+        if ( vulInfo.transfer_queue_node_index == vulInfo.graphics_queue_node_index )
+        {
+            vulInfo.transfer_queue_node_index = vulInfo.compute_queue_node_index;
+        }
 
-        vulInfo.queue_props = ( VkQueueFamilyProperties * )malloc( vulInfo.queue_count * sizeof( VkQueueFamilyProperties ) );
-        vkGetPhysicalDeviceQueueFamilyProperties(vulInfo.gpu, &vulInfo.queue_count, vulInfo.queue_props);
+        // one create info per distinct family, a family shared by compute and
+        // transfer gets a second queue when it has one
+        const uint32_t t_families[3] = { vulInfo.graphics_queue_node_index, vulInfo.compute_queue_node_index, vulInfo.transfer_queue_node_index };
+        uint32_t t_queueIndices[3] = { 0, 0, 0 };
+        float queue_priorities[3] = { 0.0f, 0.0f, 0.0f };
+		VkDeviceQueueCreateInfo queues[3] = {};
+        uint32_t queue_info_count = 0;
 
-        assert(vulInfo.queue_count >= 1);
+        for ( uint32_t t = 0; t < 3; t++ )
+        {
+            uint32_t j = 0;
+            while ( j < queue_info_count && queues[j].queueFamilyIndex != t_families[t] )
+            {
+                j++;
+            }
 
-        vkGetPhysicalDeviceFeatures(vulInfo.gpu, &vulInfo.gpu_features);
+            if ( j == queue_info_count )
+            {
+                queues[j].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+                queues[j].flags = 0;
+                queues[j].pNext = nullptr;
+                queues[j].queueFamilyIndex = t_families[t];
+                queues[j].queueCount = 1;
+                queues[j].pQueuePriorities = queue_priorities;
+                queue_info_count++;
+            }else if ( t_families[t] != vulInfo.graphics_queue_node_index
+                       && queues[j].queueCount < vulInfo.queue_props[t_families[t]].queueCount )
+            {
+                queues[j].queueCount++;
+            }
 
-        //init device
-        float queue_priorities[1] = {0.0};
-		VkDeviceQueueCreateInfo queue = {};
-        queue.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queue.flags = 0;
-        queue.pNext = nullptr;
-        queue.queueFamilyIndex = vulInfo.graphics_queue_node_index;
-        queue.queueCount = 1;
-        queue.pQueuePriorities = queue_priorities;
+            t_queueIndices[t] = queues[j].queueCount - 1;
+        }
 
         VkPhysicalDeviceFeatures features;
         memset(&features, 0, sizeof(features));
@@ -450,12 +525,31 @@ static bool memory_type_from_properties(vulkanInfo & p_vulInfo, uint32_t typeBit
             features.shaderClipDistance = VK_TRUE;
         }
 
+        // selection made sure the gpu has all of them
+        const VkBool32 * t_required = (const VkBool32 *)&vulInfo.profile.required_features;
+        VkBool32 * t_enabled = (VkBool32 *)&features;
+        for ( size_t i = 0; i < sizeof( VkPhysicalDeviceFeatures ) / sizeof( VkBool32 ); i++ )
+        {
+            t_enabled[i] = t_enabled[i] || t_required[i];
+        }
+
+        // just what bindlessTable uses, shaders index the arrays non uniformly
+        VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexing_features = {};
+        indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+        indexing_features.runtimeDescriptorArray = VK_TRUE;
+        indexing_features.descriptorBindingPartiallyBound = VK_TRUE;
+        indexing_features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        indexing_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        indexing_features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        indexing_features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        indexing_features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+
 		VkDeviceCreateInfo device = {};
         device.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-        device.pNext = nullptr;
+        device.pNext = vulInfo.bindless_supported ? &indexing_features : nullptr;
         device.flags = 0;
-        device.queueCreateInfoCount = 1;
-        device.pQueueCreateInfos = &queue;
+        device.queueCreateInfoCount = queue_info_count;
+        device.pQueueCreateInfos = queues;
         device.enabledLayerCount = 0;
         device.ppEnabledLayerNames = nullptr;
         device.enabledExtensionCount = vulInfo.enabled_extension_count;
@@ -465,352 +559,412 @@ static bool memory_type_from_properties(vulkanInfo & p_vulInfo, uint32_t typeBit
         err = vkCreateDevice(vulInfo.gpu, &device, nullptr, &vulInfo.device);
         assert(!err);
 
-        GET_DEVICE_PROC_ADDR(vulInfo.device, CreateSwapchainKHR);
-        GET_DEVICE_PROC_ADDR(vulInfo.device, DestroySwapchainKHR);
-        GET_DEVICE_PROC_ADDR(vulInfo.device, GetSwapchainImagesKHR);
-        GET_DEVICE_PROC_ADDR(vulInfo.device, AcquireNextImageKHR);
-        GET_DEVICE_PROC_ADDR(vulInfo.device, QueuePresentKHR);
+        if( load_device_dispatch( vulInfo ) )
+        {
+            return true;
+        }
+
+        vkd.GetDeviceQueue( vulInfo.device, vulInfo.graphics_queue_node_index, t_queueIndices[0], &vulInfo.queue );
+        vkd.GetDeviceQueue( vulInfo.device, vulInfo.compute_queue_node_index, t_queueIndices[1], &vulInfo.compute_queue );
+        vkd.GetDeviceQueue( vulInfo.device, vulInfo.transfer_queue_node_index, t_queueIndices[2], &vulInfo.transfer_queue );
+
+        LOG.info( "queue families: graphics {0}, compute {1}, transfer {2}", vulInfo.graphics_queue_node_index,
+                  vulInfo.compute_queue_node_index, vulInfo.transfer_queue_node_index );
+
+        if( vulInfo.allocator.init( vulInfo.device, vulInfo.memory_properties, vulInfo.gpu_props.limits ) )
+        {
+            return true;
+        }
+
+        {
+            startupScope t_cachePhase( vulInfo, "pipeline cache", p_background );
+            if( prepare_pipeline_cache( vulInfo ) )
+            {
+                return true;
+            }
+            vulInfo.pipeline_states.init( vulInfo.device, vulInfo.pipeline_cache, &vulInfo.shaders, &vulInfo.retired );
+            // loads requested before now start here
+            vulInfo.shaders.init( vulInfo.device, []( ShaderHandle p_shader )
+            {
+                vulkanInfo::instance.pipeline_states.shaderChanged( p_shader );
+            } );
+            t_cachePhase.done();
+        }
+
+        if( prepare_command_pool( vulInfo ) )
+        {
+            return true;
+        }
+
+        vulInfo.descriptor_layouts.init( vulInfo.device );
 
+        // the table is an optimization, applications check hasBindless
+        if( vulInfo.bindless_supported
+            && vulInfo.bindless.init( vulInfo.device, &vulInfo.retired, vulInfo.bindless_images, vulInfo.bindless_buffers ) )
+        {
+            LOG.warning( "bindless table could not be created, descriptor sets only" );
+        }
+
+        t_phase.done();
         return false;
     }
 
-    bool VGraphical::initWindow( window & p_window )
+    bool wait_device( vulkanInfo & p_vulInfo )
     {
-        vulkanInfo & vulInfo = vulkanInfo::instance;
-        VkResult U_ASSERT_ONLY err;
+        if( p_vulInfo.device_pending.load( std::memory_order_acquire ) )
+        {
+            // callers on several threads may arrive at once, only one gets the future
+            std::lock_guard< std::mutex > t_lock( p_vulInfo.device_mutex );
+            if( p_vulInfo.device_ready.valid() )
+            {
+                p_vulInfo.device_failed.store( p_vulInfo.device_ready.get(), std::memory_order_relaxed );
+                p_vulInfo.device_pending.store( false, std::memory_order_release );
+            }
+        }
+        return p_vulInfo.device_failed.load( std::memory_order_relaxed );
+    }
 
-        // Create a WSI surface for the window:
-        VkSurfaceKHR t_surface;
-        vulInfo.surfaces[p_window._GLFW_WindowHandle()] = t_surface;
-        glfwCreateWindowSurface( vulInfo.inst, p_window._GLFW_WindowHandle(), nullptr, &vulInfo.surfaces[p_window._GLFW_WindowHandle()]);
+    bool VGraphical::initGraphical( const bool p_headless, const bool p_asyncDevice )
+    {
+        CPU_ZONE( "initGraphical" );
 
-        // Iterate over each queue to learn whether it supports presenting:
-        VkBool32 *supportsPresent = (VkBool32 *)malloc(vulInfo.queue_count * sizeof(VkBool32));
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+        vulInfo.headless = p_headless;
+        vulInfo.device_failed.store( false, std::memory_order_relaxed );
+        vulInfo.device_pending.store( false, std::memory_order_relaxed );
 
-        for ( uint32_t i = 0; i < vulInfo.queue_count; i++) {
-            vulInfo.fpGetPhysicalDeviceSurfaceSupportKHR(vulInfo.gpu, i, vulInfo.surfaces[p_window._GLFW_WindowHandle()], &supportsPresent[i]);
+        vulInfo.startup_begin = std::chrono::steady_clock::now();
+        {
+            std::lock_guard< std::mutex > t_lock( vulInfo.startup_mutex );
+            vulInfo.startup_phases.clear();
         }
 
-        // Search for a graphics and a present queue in the array of queue
-        // families, try to find one that supports both
-        uint32_t graphicsQueueNodeIndex = UINT32_MAX;
-        uint32_t presentQueueNodeIndex = UINT32_MAX;
+        VkResult err;
+
+        resolve_device_profile( vulInfo );
+
+        vulInfo.enabled_layer_count = 0;
+        vulInfo.enabled_extension_count = 0;
+
+        // joined by the future's destructor on any early return
+        bool t_debugReport = false;
+        std::future< bool > t_enumeration = std::async( std::launch::async, enumerate_instance_support, std::ref( vulInfo ), &t_debugReport );
 
-        for ( uint32_t i = 0; i < vulInfo.queue_count; i++ ) 
+        // headless contexts never touch glfw, so they work without a display
+        if( !vulInfo.headless )
         {
-            if ( ( vulInfo.queue_props[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0 ) 
+            startupScope t_phase( vulInfo, "glfw init" );
+
+            glfwSetErrorCallback( VGraphical::__glfw_error_callback );
+
+            if (!glfwInit()) 
             {
-                if ( graphicsQueueNodeIndex == UINT32_MAX ) {
-                    graphicsQueueNodeIndex = i;
-                }
+                LOG.error("Cannot initialize GLFW.\nExiting ...");
+                return true;
+            }
 
-                if (supportsPresent[i] == VK_TRUE) {
-                    graphicsQueueNodeIndex = i;
-                    presentQueueNodeIndex = i;
-                    break;
-                }
+            if (!glfwVulkanSupported())
+            {
+                LOG.error("GLFW failed to find the Vulkan loader.\nExiting ...");
+                return true;
             }
+
+            t_phase.done();
         }
-        if ( presentQueueNodeIndex == UINT32_MAX ) 
+
+        if( t_enumeration.get() )
         {
-            // If didn't find a queue that supports both graphics and present, then
-            // find a separate present queue.
-            for ( uint32_t i = 0; i < vulInfo.queue_count; ++i ) 
+            return true;
+        }
+
+        /* Look for instance extensions */
+        if( !vulInfo.headless )
+        {
+            uint32_t required_extension_count = 0;
+            const char **required_extensions = glfwGetRequiredInstanceExtensions(&required_extension_count);
+            if (!required_extensions)
             {
-                if (supportsPresent[i] == VK_TRUE) 
-                {
-                    presentQueueNodeIndex = i;
-                    break;
-                }
+                LOG.error("glfwGetRequiredInstanceExtensions failed to find the "
+                     "platform surface extensions.\n\nDo you have a compatible "
+                     "Vulkan installable client driver (ICD) installed?\nPlease "
+                     "look at the Getting Started guide for additional "
+                     "information.");
+                return true;
+            }
+
+            for (uint32_t i = 0; i < required_extension_count; i++)
+            {
+                vulInfo.extension_names[vulInfo.enabled_extension_count++] = required_extensions[i];
+                assert( vulInfo.enabled_extension_count < 64 );
             }
         }
-        free(supportsPresent);
 
-        // Generate error if could not find both a graphics and a present queue
-        if (graphicsQueueNodeIndex == UINT32_MAX || presentQueueNodeIndex == UINT32_MAX) 
+        // validation without the extension still reports through the layer's own output
+        vulInfo.validate = vulInfo.validate && t_debugReport;
+        if ( vulInfo.validate )
         {
-            LOG.error("Swapchain Initialization Failure: Could not find a graphics and a present queue");
-            return true;
+            vulInfo.extension_names[vulInfo.enabled_extension_count++] = VK_EXT_DEBUG_REPORT_EXTENSION_NAME;
+            assert( vulInfo.enabled_extension_count < 64 );
         }
 
-        // TODO: Add support for separate queues, including presentation,
-        //       synchronization, and appropriate tracking for QueueSubmit.
-        // NOTE: While it is possible for an application to use a separate graphics
-        //       and a present queues, this demo program assumes it is only using
-        //       one:
-        if (graphicsQueueNodeIndex != presentQueueNodeIndex) {
-            LOG.error("Swapchain Initialization Failure: Could not find a common graphics and a present queue");
-            return true;
+        // only needed to ask the gpu about descriptor indexing
+        vulInfo.properties2 = vulInfo.properties2 && vulInfo.profile.bindless;
+        if ( vulInfo.properties2 )
+        {
+            vulInfo.extension_names[vulInfo.enabled_extension_count++] = VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME;
+            assert( vulInfo.enabled_extension_count < 64 );
         }
 
-        vulInfo.graphics_queue_node_index = graphicsQueueNodeIndex;
-
-        vkGetDeviceQueue( vulInfo.device, vulInfo.graphics_queue_node_index, 0,
-                     &vulInfo.queue);
-                     
-        // Get the list of VkFormat's that are supported:
-        uint32_t formatCount;
-        err = vulInfo.fpGetPhysicalDeviceSurfaceFormatsKHR(vulInfo.gpu, vulInfo.surfaces[p_window._GLFW_WindowHandle()], &formatCount, nullptr);
-        assert(!err);
+        for ( size_t i = 0; i < vulInfo.profile.instance_extensions.size(); i++ )
+        {
+            vulInfo.extension_names[vulInfo.enabled_extension_count++] = vulInfo.profile.instance_extensions[i].c_str();
+            assert( vulInfo.enabled_extension_count < 64 );
+        }
 
-        VkSurfaceFormatKHR *surfFormats = (VkSurfaceFormatKHR *)malloc(formatCount * sizeof(VkSurfaceFormatKHR));
-        err = vulInfo.fpGetPhysicalDeviceSurfaceFormatsKHR(vulInfo.gpu, vulInfo.surfaces[p_window._GLFW_WindowHandle()], &formatCount, surfFormats);
-        assert(!err);
+		VkApplicationInfo app;
+		app.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+		app.pNext = nullptr;
+		app.pApplicationName = "haha";
+		app.applicationVersion = 0;
+		app.pEngineName = "ws";
+		app.engineVersion = 0;
+		app.apiVersion = VK_API_VERSION_1_0;
 
-        // If the format list includes just one entry of VK_FORMAT_UNDEFINED,
-        // the surface has no preferred format.  Otherwise, at least one
-        // supported format will be returned.
-        if (formatCount == 1 && surfFormats[0].format == VK_FORMAT_UNDEFINED) {
-            vulInfo.format = VK_FORMAT_B8G8R8A8_UNORM;
-        } else {
-            assert(formatCount >= 1);
-            vulInfo.format = surfFormats[0].format;
-        }
+		VkInstanceCreateInfo inst_info;
+		inst_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+		inst_info.pNext = nullptr;
+        inst_info.flags = 0;
+		inst_info.pApplicationInfo = &app;
+		inst_info.enabledLayerCount = vulInfo.enabled_layer_count;
+		inst_info.ppEnabledLayerNames = (const char *const *)vulInfo.enabled_layers;
+		inst_info.enabledExtensionCount = vulInfo.enabled_extension_count;
+		inst_info.ppEnabledExtensionNames = (const char *const *)vulInfo.extension_names;
 
-        vulInfo.color_space = surfFormats[0].colorSpace;
+        uint32_t gpu_count;
 
+        {
+            startupScope t_phase( vulInfo, "instance creation" );
 
-        // Get Memory information and properties
-        vkGetPhysicalDeviceMemoryProperties(vulInfo.gpu, &vulInfo.memory_properties);
+            err = vkCreateInstance( &inst_info, nullptr, &vulInfo.inst );
+            if (err == VK_ERROR_INCOMPATIBLE_DRIVER) 
+            {
+                LOG.error( "vkCreateInstance Failure: Cannot find a compatible Vulkan installable client driver "
+                        "(ICD).\n\nPlease look at the Getting Started guide for "
+                        "additional information." );
+                return true;
+            } else if (err == VK_ERROR_EXTENSION_NOT_PRESENT) 
+            {
+                LOG.error( "vkCreateInstance Failure: Cannot find a specified extension library"
+                        ".\nMake sure your layers path is set appropriately" );
+                return true;
+            } else if (err) 
+            {
+                LOG.error( "vkCreateInstance Failure: vkCreateInstance failed.\n\nDo you have a compatible Vulkan "
+                        "installable client driver (ICD) installed?\nPlease look at "
+                        "the Getting Started guide for additional information." );
+                return true;
+            }
 
+            t_phase.done();
+        }
 
-        // create command poll
-		VkCommandPoolCreateInfo cmd_pool_info = {};
-		cmd_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-		cmd_pool_info.queueFamilyIndex = 0;
-		cmd_pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        {
+            startupScope t_phase( vulInfo, "physical device enumeration" );
 
-        err = vkCreateCommandPool(vulInfo.device, &cmd_pool_info, nullptr, &vulInfo.cmd_pool);
-        assert(!err);
+            /* Make initial call to query gpu_count, then second call for gpu info*/
+            err = vkEnumeratePhysicalDevices( vulInfo.inst, &gpu_count, nullptr );
+            assert( !err && gpu_count > 0 );
 
-		VkCommandBufferAllocateInfo cmd = {};
-        cmd.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        cmd.pNext = nullptr;
-        cmd.commandPool = vulInfo.cmd_pool;
-        cmd.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        cmd.commandBufferCount = 1;
+            if ( gpu_count > 0 ) 
+            {
+                VkPhysicalDevice *physical_devices = (VkPhysicalDevice *)malloc(sizeof(VkPhysicalDevice) * gpu_count );
+                err = vkEnumeratePhysicalDevices( vulInfo.inst, &gpu_count, physical_devices );
+                assert(!err);
 
-        err = vkAllocateCommandBuffers(vulInfo.device, &cmd, &vulInfo.draw_cmd);
-        assert(!err);
+                const bool t_failed = select_physical_device( vulInfo, physical_devices, gpu_count );
+                free(physical_devices);
+                if( t_failed )
+                {
+                    return true;
+                }
+            }else
+            {
+                LOG.error( "vkEnumeratePhysicalDevices reported zero accessible devices."
+                     "\n\nDo you have a compatible Vulkan installable client"
+                     " driver (ICD) installed?\nPlease look at the Getting Started"
+                     " guide for additional information." );
+                return true;
+            }
 
-        // prepare buffers
+            t_phase.done();
+        }
 
-        VkSwapchainKHR oldSwapchain = vulInfo.swapchain;
+        // Having these GIPA queries of device extension entry points both
+        // BEFORE and AFTER vkCreateDevice is a good test for the loader
+        if( !vulInfo.headless )
+        {
+            GET_INSTANCE_PROC_ADDR( vulInfo.inst, GetPhysicalDeviceSurfaceCapabilitiesKHR );
+            GET_INSTANCE_PROC_ADDR( vulInfo.inst, GetPhysicalDeviceSurfaceFormatsKHR );
+            GET_INSTANCE_PROC_ADDR( vulInfo.inst, GetPhysicalDeviceSurfacePresentModesKHR );
+            GET_INSTANCE_PROC_ADDR( vulInfo.inst, GetPhysicalDeviceSurfaceSupportKHR );
+        }
 
-        // Check the surface capabilities and formats
-        VkSurfaceCapabilitiesKHR surfCapabilities;
-        err = vulInfo.fpGetPhysicalDeviceSurfaceCapabilitiesKHR( vulInfo.gpu, vulInfo.surfaces[p_window._GLFW_WindowHandle()], &surfCapabilities );
-        assert(!err);
+        // the instance extension list is done with, the query reuses it for
+        // the device. early returns below still join it, a std::async
+        // future waits in its destructor
+        std::future< bool > t_query = std::async( std::launch::async, query_physical_device, std::ref( vulInfo ) );
 
-        uint32_t presentModeCount;
-        err = vulInfo.fpGetPhysicalDeviceSurfacePresentModesKHR( vulInfo.gpu, vulInfo.surfaces[p_window._GLFW_WindowHandle()], &presentModeCount, nullptr );
-        assert(!err);
+        if( vulInfo.validate )
+        {
+            startupScope t_phase( vulInfo, "debug report" );
 
-        VkPresentModeKHR *presentModes = (VkPresentModeKHR *)malloc(presentModeCount * sizeof(VkPresentModeKHR));
-        assert(presentModes);
+            vulInfo.CreateDebugReportCallback =
+            (PFN_vkCreateDebugReportCallbackEXT)vkGetInstanceProcAddr(
+                vulInfo.inst, "vkCreateDebugReportCallbackEXT");
+            if (!vulInfo.CreateDebugReportCallback) 
+            {
+                LOG.error( "vkGetProcAddr Failure: GetProcAddr: Unable to find vkCreateDebugReportCallbackEXT" );
+                return true;
+            }
 
-        err = vulInfo.fpGetPhysicalDeviceSurfacePresentModesKHR( vulInfo.gpu, vulInfo.surfaces[p_window._GLFW_WindowHandle()], &presentModeCount, presentModes );
-        assert(!err);
+            vulInfo.DestroyDebugReportCallback =
+            (PFN_vkDestroyDebugReportCallbackEXT)vkGetInstanceProcAddr(
+                vulInfo.inst, "vkDestroyDebugReportCallbackEXT");
 
-        VkExtent2D swapchainExtent;
-        // width and height are either both 0xFFFFFFFF, or both not 0xFFFFFFFF.
-        if (surfCapabilities.currentExtent.width == 0xFFFFFFFF)
-        {
-            // If the surface size is undefined, the size is set to the size
-            // of the images requested, which must fit within the minimum and
-            // maximum values.
-            swapchainExtent.width = (uint32_t)p_window.getWindowSize().x;
-            swapchainExtent.height = (uint32_t)p_window.getWindowSize().y;
+            if (!vulInfo.DestroyDebugReportCallback) 
+            {
+                LOG.error( "vkGetProcAddr Failure: GetProcAddr: Unable to find vkDestroyDebugReportCallbackEXT" );
+                return true;
+            }
 
-            if (swapchainExtent.width < surfCapabilities.minImageExtent.width) {
-                swapchainExtent.width = surfCapabilities.minImageExtent.width;
-            } else if (swapchainExtent.width > surfCapabilities.maxImageExtent.width) {
-                swapchainExtent.width = surfCapabilities.maxImageExtent.width;
+            vulInfo.DebugReportMessage =
+            (PFN_vkDebugReportMessageEXT)vkGetInstanceProcAddr(
+                vulInfo.inst, "vkDebugReportMessageEXT");
+            if( !vulInfo.DebugReportMessage )
+            {
+                LOG.error("vkGetProcAddr Failure: GetProcAddr: Unable to find vkDebugReportMessageEXT" );
+                return true;
             }
-            
-            if (swapchainExtent.height < surfCapabilities.minImageExtent.height) {
-                swapchainExtent.height = surfCapabilities.minImageExtent.height;
-            } else if (swapchainExtent.height > surfCapabilities.maxImageExtent.height) {
-                swapchainExtent.height = surfCapabilities.maxImageExtent.height;
+
+            VkDebugReportCallbackCreateInfoEXT dbgCreateInfo;
+            dbgCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_REPORT_CREATE_INFO_EXT;
+            dbgCreateInfo.flags =
+                VK_DEBUG_REPORT_ERROR_BIT_EXT | VK_DEBUG_REPORT_WARNING_BIT_EXT;
+            dbgCreateInfo.pfnCallback = vulInfo.use_break ? BreakCallback : dbgFunc;
+            dbgCreateInfo.pUserData = &vulInfo;
+            dbgCreateInfo.pNext = nullptr;
+
+            err = vulInfo.CreateDebugReportCallback(vulInfo.inst, &dbgCreateInfo, nullptr,
+                                              &vulInfo.msg_callback);
+            switch (err) {
+            case VK_SUCCESS:
+                break;
+            case VK_ERROR_OUT_OF_HOST_MEMORY:
+                    LOG.error( "CreateDebugReportCallback Failure: CreateDebugReportCallback: out of host memory" );
+                        return true;
+                break;
+            default:
+                    LOG.error( "CreateDebugReportCallback Failure CreateDebugReportCallback: unknown failure" );
+                        return true;
+                break;
             }
-        }else{
-            // If the surface size is defined, the swap chain size must match
-            swapchainExtent = surfCapabilities.currentExtent;
-            p_window.setWindowSize( glm::ivec2( surfCapabilities.currentExtent.width, surfCapabilities.currentExtent.height ) );
-        }
-
-        VkPresentModeKHR swapchainPresentMode = VK_PRESENT_MODE_FIFO_KHR;
-
-        // Determine the number of VkImage's to use in the swap chain.
-        // Application desires to only acquire 1 image at a time (which is
-        // "surfCapabilities.minImageCount").
-        uint32_t desiredNumOfSwapchainImages = surfCapabilities.minImageCount;
-        // If maxImageCount is 0, we can ask for as many images as we want;
-        // otherwise we're limited to maxImageCount
-        if ((surfCapabilities.maxImageCount > 0) &&
-            (desiredNumOfSwapchainImages > surfCapabilities.maxImageCount)) {
-            // Application must settle for fewer images than desired:
-            desiredNumOfSwapchainImages = surfCapabilities.maxImageCount;
-        }
-
-		VkSurfaceTransformFlagsKHR preTransform;
-        if (surfCapabilities.supportedTransforms & VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR) 
-        {
-            preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
-        } else {
-            preTransform = surfCapabilities.currentTransform;
-        }
-
-		VkSwapchainCreateInfoKHR swapchain = { };
-
-        swapchain.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-        swapchain.pNext = nullptr;
-        swapchain.surface = vulInfo.surfaces[p_window._GLFW_WindowHandle()];
-        swapchain.minImageCount = desiredNumOfSwapchainImages;
-        swapchain.imageFormat = vulInfo.format;
-        swapchain.imageColorSpace = vulInfo.color_space;
-        swapchain.imageExtent.width = swapchainExtent.width;
-        swapchain.imageExtent.height = swapchainExtent.height;
-        swapchain.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-        swapchain.preTransform = (VkSurfaceTransformFlagBitsKHR)preTransform;
-        swapchain.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-        swapchain.imageArrayLayers = 1;
-        swapchain.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        swapchain.queueFamilyIndexCount = 0;
-        swapchain.pQueueFamilyIndices = nullptr;
-        swapchain.presentMode = swapchainPresentMode;
-        swapchain.oldSwapchain = oldSwapchain;
-        swapchain.clipped = true;
-        swapchain.flags = VK_SAMPLE_COUNT_1_BIT;
-
-        err = vulInfo.fpCreateSwapchainKHR(vulInfo.device, &swapchain, nullptr, &vulInfo.swapchain);
-        assert(!err);
 
-        // If we just re-created an existing swapchain, we should destroy the old
-        // swapchain at this point.
-        // Note: destroying the swapchain also cleans up all its associated
-        // presentable images once the platform is done with them.
-        if (oldSwapchain != VK_NULL_HANDLE) {
-            vulInfo.fpDestroySwapchainKHR(vulInfo.device, oldSwapchain, nullptr);
+            t_phase.done();
         }
 
-        err = vulInfo.fpGetSwapchainImagesKHR(vulInfo.device, vulInfo.swapchain,
-                                        &vulInfo.swapchainImageCount, nullptr);
-        assert(!err);
+        if( t_query.get() )
+        {
+            return true;
+        }
 
-        VkImage *swapchainImages =
-            (VkImage *)malloc(vulInfo.swapchainImageCount * sizeof(VkImage));
-        assert(swapchainImages);
-        err = vulInfo.fpGetSwapchainImagesKHR(vulInfo.device, vulInfo.swapchain,
-                  &vulInfo.swapchainImageCount, swapchainImages);
-        assert(!err);
+        if( p_asyncDevice )
+        {
+            vulInfo.device_ready = std::async( std::launch::async, create_device, std::ref( vulInfo ), true );
+            vulInfo.device_pending.store( true, std::memory_order_release );
+            return false;
+        }
 
-        vulInfo.buffers = (SwapchainBuffers *)malloc(sizeof(SwapchainBuffers) * vulInfo.swapchainImageCount);
-        assert(vulInfo.buffers);
+        const bool t_failed = create_device( vulInfo, false );
+        vulInfo.device_failed.store( t_failed, std::memory_order_relaxed );
+        return t_failed;
+    }
 
-        for (uint32_t i = 0; i < vulInfo.swapchainImageCount; i++) 
-        {
-			VkImageViewCreateInfo color_attachment_view = { };
-            color_attachment_view.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-            color_attachment_view.pNext = nullptr;
-            color_attachment_view.format = vulInfo.format;
+    bool VGraphical::waitDevice(void)
+    {
+        return wait_device( vulkanInfo::instance );
+    }
 
-            color_attachment_view.components.r = VK_COMPONENT_SWIZZLE_R;
-            color_attachment_view.components.g = VK_COMPONENT_SWIZZLE_G;
-            color_attachment_view.components.b = VK_COMPONENT_SWIZZLE_B;
-            color_attachment_view.components.a = VK_COMPONENT_SWIZZLE_A;
-            color_attachment_view.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            color_attachment_view.subresourceRange.baseMipLevel = 0;
-            color_attachment_view.subresourceRange.levelCount = 1;
-            color_attachment_view.subresourceRange.baseArrayLayer = 0;
-            color_attachment_view.subresourceRange.layerCount = 1;
+    const DeviceDispatch & VGraphical::getDispatch(void)
+    {
+        wait_device( vulkanInfo::instance );
+        return vkd;
+    }
 
+    void VGraphical::destroyGraphical(void)
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
 
-            vulInfo.buffers[i].image = swapchainImages[i];
-            color_attachment_view.image = vulInfo.buffers[i].image;
+        stopRenderThread();
+        wait_device( vulInfo );
 
-            err = vkCreateImageView(vulInfo.device, &color_attachment_view, nullptr,
-                                &vulInfo.buffers[i].view);
-            assert(!err);
+        if( vulInfo.device == VK_NULL_HANDLE )
+        {
+            return;
         }
 
-        vulInfo.current_buffer = 0;
-
-        if (presentModes != nullptr) {
-            free(presentModes);
-        }
-
-        //prepare depth
-        const VkFormat depth_format = VK_FORMAT_D16_UNORM;
-        // VkImageLayout t_initialLayout;
-		VkImageCreateInfo image = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
-        //image.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-        image.pNext = nullptr;
-        image.imageType = VK_IMAGE_TYPE_2D;
-        image.format = depth_format;
-        image.extent.width = (uint32_t)p_window.getWindowSize().x;
-        image.extent.height = (uint32_t)p_window.getWindowSize().y;
-        image.extent.depth = 1;
-        image.mipLevels = 1;
-        image.arrayLayers = 1;
-        image.samples = VK_SAMPLE_COUNT_1_BIT;
-        image.tiling = VK_IMAGE_TILING_OPTIMAL;
-        image.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-
-		VkMemoryAllocateInfo mem_alloc = { };
-        mem_alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        mem_alloc.pNext = nullptr;
-        mem_alloc.allocationSize = 0;
-        mem_alloc.memoryTypeIndex = 0;
-
-		VkImageViewCreateInfo view = {};
-        view.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        view.pNext = NULL;
-        view.image = VK_NULL_HANDLE;
-        view.format = depth_format;
-        view.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-        view.subresourceRange.baseMipLevel = 0;
-        view.subresourceRange.levelCount = 1;
-        view.subresourceRange.baseArrayLayer = 0;
-        view.subresourceRange.layerCount = 1;
-        view.flags = 0;
-        view.viewType = VK_IMAGE_VIEW_TYPE_2D;
-
-        VkMemoryRequirements mem_reqs;
-        bool U_ASSERT_ONLY pass;
-
-        vulInfo.depth.format = depth_format;
-
-        /* create image */
-        err = vkCreateImage(vulInfo.device, &image, NULL, &vulInfo.depth.image);
-        assert(!err);
+        vkd.DeviceWaitIdle( vulInfo.device );
+
+        // no more reloads, then compiles still running feed the cache and
+        // hand their modules back before those go
+        vulInfo.shaders.watch( false, DEFAULT_SHADER_POLL_MS );
+        vulInfo.shaders.wait();
+        vulInfo.pipeline_states.destroy();
+        vulInfo.shaders.destroy();
+        save_pipeline_cache( vulInfo );
+        destroy_pipeline_cache( vulInfo );
+
+        // windows normally release their own contexts, these are leftovers
+        for( ;; )
+        {
+            renderContext * t_context = nullptr;
+            {
+                std::lock_guard< std::mutex > t_lock( vulInfo.contexts_mutex );
+                if( vulInfo.contexts.empty() )
+                {
+                    break;
+                }
+                t_context = vulInfo.contexts.begin()->second;
+            }
+            destroy_window_context( vulInfo, t_context );
+        }
+        destroy_offscreen( vulInfo );
+        vulInfo.retired.flush();
 
-        /* get memory requirements for this object */
-        vkGetImageMemoryRequirements(vulInfo.device, vulInfo.depth.image, &mem_reqs);
+        vulInfo.bindless.destroy();
+        vulInfo.descriptor_layouts.destroy();
 
-        /* select memory size and type */
-        mem_alloc.allocationSize = mem_reqs.size;
-        pass = memory_type_from_properties(vulInfo, mem_reqs.memoryTypeBits,
-                                        0, /* No requirements */
-                                        &mem_alloc.memoryTypeIndex);
-        assert(pass);
+        vkd.FreeCommandBuffers( vulInfo.device, vulInfo.cmd_pool, 1, &vulInfo.setup_cmd );
+        vkd.DestroyCommandPool( vulInfo.device, vulInfo.cmd_pool, nullptr );
+        vulInfo.allocator.destroy();
 
-        /* allocate memory */
-        err = vkAllocateMemory(vulInfo.device, &mem_alloc, NULL, &vulInfo.depth.mem);
-        assert(!err);
+        vkd.DestroyDevice( vulInfo.device, nullptr );
+        vulInfo.device = VK_NULL_HANDLE;
+        vkd = DeviceDispatch();
 
-        /* bind memory */
-        err =
-            vkBindImageMemory(vulInfo.device, vulInfo.depth.image, vulInfo.depth.mem, 0);
-        assert(!err);
+        if( vulInfo.msg_callback != VK_NULL_HANDLE )
+        {
+            vulInfo.DestroyDebugReportCallback( vulInfo.inst, vulInfo.msg_callback, nullptr );
+            vulInfo.msg_callback = VK_NULL_HANDLE;
+        }
+        vkDestroyInstance( vulInfo.inst, nullptr );
+        vulInfo.inst = VK_NULL_HANDLE;
 
-        //set image view
-        
-        // demo_set_image_layout(demo, vulInfo.depth.image, VK_IMAGE_ASPECT_DEPTH_BIT,
-        //                     VK_IMAGE_LAYOUT_UNDEFINED,
-        //                     VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-        //                     0);
+        free( vulInfo.queue_props );
+        vulInfo.queue_props = nullptr;
 
-        return false;
+        if( !vulInfo.headless )
+        {
+            glfwTerminate();
+        }
     }
 }
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "vulkanInfo.h"
+#include "VGraphical.h"
+#include "log.hpp"
+#include <cassert>
+
+namespace ROOT_SPACE
+{
+    static VkFormat pick_offscreen_format( vulkanInfo & p_vulInfo )
+    {
+        const VkFormat candidates[] = { VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_B8G8R8A8_UNORM };
+
+        for( uint32_t i = 0; i < sizeof( candidates ) / sizeof( candidates[0] ); ++i )
+        {
+            VkFormatProperties props;
+            vkGetPhysicalDeviceFormatProperties( p_vulInfo.gpu, candidates[i], &props );
+            if( props.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT )
+            {
+                return candidates[i];
+            }
+        }
+
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    void destroy_offscreen( vulkanInfo & p_vulInfo )
+    {
+        renderContext * t_context = p_vulInfo.offscreen;
+        if( !t_context )
+        {
+            return;
+        }
+
+        destroy_frames( p_vulInfo, *t_context );
+
+        if( t_context->buffers )
+        {
+            for( uint32_t i = 0; i < t_context->swapchainImageCount; i++ )
+            {
+                if( t_context->buffers[i].view != VK_NULL_HANDLE )
+                {
+                    vkd.DestroyImageView( p_vulInfo.device, t_context->buffers[i].view, nullptr );
+                }
+                if( t_context->buffers[i].image != VK_NULL_HANDLE )
+                {
+                    vkd.DestroyImage( p_vulInfo.device, t_context->buffers[i].image, nullptr );
+                }
+                p_vulInfo.allocator.free( t_context->offscreen_mem[i] );
+            }
+            free( t_context->buffers );
+            free( t_context->offscreen_mem );
+        }
+
+        p_vulInfo.offscreen = nullptr;
+        delete t_context;
+    }
+
+    bool VGraphical::initOffscreen( const glm::ivec2 & p_size, const uint32_t p_imageCount )
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+        VkResult U_ASSERT_ONLY err;
+
+        if( p_size.x <= 0 || p_size.y <= 0 || p_imageCount == 0 )
+        {
+            LOG.error( "Offscreen Initialization Failure: invalid size {0}x{1} or image count {2}", p_size.x, p_size.y, p_imageCount );
+            return true;
+        }
+
+        if( wait_device( vulInfo ) )
+        {
+            LOG.error( "Offscreen Initialization Failure: device creation failed" );
+            return true;
+        }
+
+        if( vulInfo.offscreen )
+        {
+            LOG.error( "Offscreen Initialization Failure: offscreen targets already exist" );
+            return true;
+        }
+
+        renderContext * t_context = new renderContext();
+
+        t_context->format = pick_offscreen_format( vulInfo );
+        if( t_context->format == VK_FORMAT_UNDEFINED )
+        {
+            LOG.error( "Offscreen Initialization Failure: no color attachment format supported" );
+            delete t_context;
+            return true;
+        }
+
+        vulInfo.offscreen = t_context;
+
+        t_context->extent.width = (uint32_t)p_size.x;
+        t_context->extent.height = (uint32_t)p_size.y;
+        t_context->swapchainImageCount = p_imageCount;
+
+        t_context->buffers = (SwapchainBuffers *)malloc(sizeof(SwapchainBuffers) * t_context->swapchainImageCount);
+        assert(t_context->buffers);
+        t_context->offscreen_mem = (MemoryAllocation *)malloc(sizeof(MemoryAllocation) * t_context->swapchainImageCount);
+        assert(t_context->offscreen_mem);
+        // zeroed so a half built target can still be torn down
+        memset( t_context->buffers, 0, sizeof(SwapchainBuffers) * t_context->swapchainImageCount );
+        memset( t_context->offscreen_mem, 0, sizeof(MemoryAllocation) * t_context->swapchainImageCount );
+
+        for( uint32_t i = 0; i < t_context->swapchainImageCount; i++ )
+        {
+            VkImageCreateInfo image = {};
+            image.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            image.pNext = nullptr;
+            image.imageType = VK_IMAGE_TYPE_2D;
+            image.format = t_context->format;
+            image.extent.width = t_context->extent.width;
+            image.extent.height = t_context->extent.height;
+            image.extent.depth = 1;
+            image.mipLevels = 1;
+            image.arrayLayers = 1;
+            image.samples = VK_SAMPLE_COUNT_1_BIT;
+            image.tiling = VK_IMAGE_TILING_OPTIMAL;
+            // transfer src so results can be read back or blitted elsewhere
+            image.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+            image.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            image.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            err = vkd.CreateImage( vulInfo.device, &image, nullptr, &t_context->buffers[i].image );
+            assert(!err);
+
+            if( vulInfo.allocator.allocImage( t_context->buffers[i].image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, t_context->offscreen_mem[i] ) )
+            {
+                LOG.error( "Offscreen Initialization Failure: no device local memory for render target" );
+                return true;
+            }
+
+            VkImageViewCreateInfo color_attachment_view = {};
+            color_attachment_view.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            color_attachment_view.pNext = nullptr;
+            color_attachment_view.image = t_context->buffers[i].image;
+            color_attachment_view.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            color_attachment_view.format = t_context->format;
+            color_attachment_view.components.r = VK_COMPONENT_SWIZZLE_R;
+            color_attachment_view.components.g = VK_COMPONENT_SWIZZLE_G;
+            color_attachment_view.components.b = VK_COMPONENT_SWIZZLE_B;
+            color_attachment_view.components.a = VK_COMPONENT_SWIZZLE_A;
+            color_attachment_view.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            color_attachment_view.subresourceRange.baseMipLevel = 0;
+            color_attachment_view.subresourceRange.levelCount = 1;
+            color_attachment_view.subresourceRange.baseArrayLayer = 0;
+            color_attachment_view.subresourceRange.layerCount = 1;
+
+            err = vkd.CreateImageView( vulInfo.device, &color_attachment_view, nullptr, &t_context->buffers[i].view );
+            assert(!err);
+
+            t_context->buffers[i].cmd = VK_NULL_HANDLE;
+        }
+
+        t_context->current_buffer = 0;
+
+        t_context->frame_count = vulInfo.frame_count;
+        if( prepare_frames( vulInfo, *t_context ) )
+        {
+            return true;
+        }
+
+        return false;
+    }
+}
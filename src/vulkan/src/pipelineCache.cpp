@@ -0,0 +1,256 @@
+#include "vulkanInfo.h"
+#include "VGraphical.h"
+#include "log.hpp"
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ROOT_SPACE
+{
+    // the blob is only valid for the exact device and driver that wrote it,
+    // so all of them go into the file name and a driver update starts fresh
+    static std::string pipeline_cache_file( vulkanInfo & p_vulInfo )
+    {
+        char t_name[128];
+        snprintf( t_name, sizeof( t_name ), "pipeline_%08x_%08x_%08x_",
+                  p_vulInfo.gpu_props.vendorID, p_vulInfo.gpu_props.deviceID, p_vulInfo.gpu_props.driverVersion );
+
+        std::string t_path = p_vulInfo.pipeline_cache_dir;
+        if( !t_path.empty() && t_path[t_path.size() - 1] != '/' && t_path[t_path.size() - 1] != '\\' )
+        {
+            t_path += '/';
+        }
+        t_path += t_name;
+
+        for( uint32_t i = 0; i < VK_UUID_SIZE; ++i )
+        {
+            char t_hex[3];
+            snprintf( t_hex, sizeof( t_hex ), "%02x", p_vulInfo.gpu_props.pipelineCacheUUID[i] );
+            t_path += t_hex;
+        }
+        t_path += ".cache";
+
+        return t_path;
+    }
+
+    // some drivers crash on foreign data instead of rejecting it
+    static bool pipeline_cache_header_matches( vulkanInfo & p_vulInfo, const uint8_t * p_data, const size_t p_size )
+    {
+        const size_t t_headerSize = 16 + VK_UUID_SIZE;
+        if( p_size < t_headerSize )
+        {
+            return false;
+        }
+
+        uint32_t t_fields[4];
+        memcpy( t_fields, p_data, sizeof( t_fields ) );
+
+        return t_fields[0] >= t_headerSize
+            && t_fields[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+            && t_fields[2] == p_vulInfo.gpu_props.vendorID
+            && t_fields[3] == p_vulInfo.gpu_props.deviceID
+            && memcmp( p_data + 16, p_vulInfo.gpu_props.pipelineCacheUUID, VK_UUID_SIZE ) == 0;
+    }
+
+    static bool create_pipeline_cache( vulkanInfo & p_vulInfo, const void * p_data, const size_t p_size )
+    {
+        VkPipelineCacheCreateInfo t_info = {};
+        t_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        t_info.pNext = nullptr;
+        t_info.flags = 0;
+        t_info.initialDataSize = p_size;
+        t_info.pInitialData = p_data;
+
+        return vkd.CreatePipelineCache( p_vulInfo.device, &t_info, nullptr, &p_vulInfo.pipeline_cache ) != VK_SUCCESS;
+    }
+
+    bool prepare_pipeline_cache( vulkanInfo & p_vulInfo )
+    {
+        const std::string t_path = pipeline_cache_file( p_vulInfo );
+
+        // the driver copies the initial data, so the mapping only lives
+        // for the duration of vkCreatePipelineCache
+        const void * t_data = nullptr;
+        size_t t_size = 0;
+
+#ifdef _WIN32
+        HANDLE t_file = CreateFileA( t_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+        HANDLE t_mapping = nullptr;
+        if( t_file != INVALID_HANDLE_VALUE )
+        {
+            LARGE_INTEGER t_length;
+            if( GetFileSizeEx( t_file, &t_length ) && t_length.QuadPart > 0 )
+            {
+                t_mapping = CreateFileMappingA( t_file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+                if( t_mapping )
+                {
+                    t_data = MapViewOfFile( t_mapping, FILE_MAP_READ, 0, 0, 0 );
+                    t_size = t_data ? (size_t)t_length.QuadPart : 0;
+                }
+            }
+        }
+#else
+        int t_file = open( t_path.c_str(), O_RDONLY );
+        if( t_file >= 0 )
+        {
+            struct stat t_stat;
+            if( fstat( t_file, &t_stat ) == 0 && t_stat.st_size > 0 )
+            {
+                void * t_map = mmap( nullptr, (size_t)t_stat.st_size, PROT_READ, MAP_PRIVATE, t_file, 0 );
+                if( t_map != MAP_FAILED )
+                {
+                    t_data = t_map;
+                    t_size = (size_t)t_stat.st_size;
+                }
+            }
+        }
+#endif
+
+        bool t_seeded = t_data && pipeline_cache_header_matches( p_vulInfo, (const uint8_t *)t_data, t_size );
+        if( t_data && !t_seeded )
+        {
+            LOG.warning( "pipeline cache {0} was written by another device or driver, ignoring it", t_path );
+        }
+
+        bool t_failed = create_pipeline_cache( p_vulInfo, t_seeded ? t_data : nullptr, t_seeded ? t_size : 0 );
+
+        // a corrupt blob is not fatal, start with an empty cache instead
+        if( t_failed && t_seeded )
+        {
+            LOG.warning( "pipeline cache {0} was rejected by the driver, starting empty", t_path );
+            t_seeded = false;
+            t_failed = create_pipeline_cache( p_vulInfo, nullptr, 0 );
+        }
+
+#ifdef _WIN32
+        if( t_data ) UnmapViewOfFile( t_data );
+        if( t_mapping ) CloseHandle( t_mapping );
+        if( t_file != INVALID_HANDLE_VALUE ) CloseHandle( t_file );
+#else
+        if( t_data ) munmap( (void *)t_data, t_size );
+        if( t_file >= 0 ) close( t_file );
+#endif
+
+        if( t_failed )
+        {
+            LOG.error( "vkCreatePipelineCache Failure" );
+            p_vulInfo.pipeline_cache = VK_NULL_HANDLE;
+            return true;
+        }
+
+        if( t_seeded )
+        {
+            LOG.info( "pipeline cache seeded from {0} ({1} bytes)", t_path, (uint32_t)t_size );
+        }
+
+        return false;
+    }
+
+    bool save_pipeline_cache( vulkanInfo & p_vulInfo )
+    {
+        VkResult U_ASSERT_ONLY err;
+
+        if( p_vulInfo.pipeline_cache == VK_NULL_HANDLE )
+        {
+            return false;
+        }
+
+        size_t t_size = 0;
+        err = vkd.GetPipelineCacheData( p_vulInfo.device, p_vulInfo.pipeline_cache, &t_size, nullptr );
+        assert(!err);
+
+        std::vector< uint8_t > t_blob( t_size );
+        if( t_size > 0 )
+        {
+            err = vkd.GetPipelineCacheData( p_vulInfo.device, p_vulInfo.pipeline_cache, &t_size, t_blob.data() );
+            if( err != VK_SUCCESS && err != VK_INCOMPLETE )
+            {
+                LOG.error( "vkGetPipelineCacheData Failure: returned {0}", (int)err );
+                return true;
+            }
+        }
+
+        // written next to the target and renamed over it, so a crash while
+        // saving never leaves a truncated cache behind; the temp name is
+        // per process so two instances saving at once never share it
+#ifdef _WIN32
+        const unsigned long t_pid = (unsigned long)GetCurrentProcessId();
+#else
+        const unsigned long t_pid = (unsigned long)getpid();
+#endif
+        const std::string t_path = pipeline_cache_file( p_vulInfo );
+        const std::string t_temp = t_path + "." + std::to_string( t_pid ) + ".tmp";
+
+        FILE * t_file = fopen( t_temp.c_str(), "wb" );
+        if( !t_file )
+        {
+            LOG.error( "pipeline cache save Failure: cannot open {0}", t_temp );
+            return true;
+        }
+
+        bool t_failed = t_size > 0 && fwrite( t_blob.data(), 1, t_size, t_file ) != t_size;
+        t_failed = fflush( t_file ) != 0 || t_failed;
+#ifndef _WIN32
+        t_failed = fsync( fileno( t_file ) ) != 0 || t_failed;
+#endif
+        t_failed = fclose( t_file ) != 0 || t_failed;
+
+        if( !t_failed )
+        {
+#ifdef _WIN32
+            t_failed = !MoveFileExA( t_temp.c_str(), t_path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH );
+#else
+            t_failed = rename( t_temp.c_str(), t_path.c_str() ) != 0;
+#endif
+        }
+
+        if( t_failed )
+        {
+            LOG.error( "pipeline cache save Failure: cannot write {0}", t_path );
+            remove( t_temp.c_str() );
+            return true;
+        }
+
+        return false;
+    }
+
+    void destroy_pipeline_cache( vulkanInfo & p_vulInfo )
+    {
+        if( p_vulInfo.pipeline_cache != VK_NULL_HANDLE )
+        {
+            vkd.DestroyPipelineCache( p_vulInfo.device, p_vulInfo.pipeline_cache, nullptr );
+            p_vulInfo.pipeline_cache = VK_NULL_HANDLE;
+        }
+    }
+
+    void VGraphical::setPipelineCacheDirectory( const std::string & p_directory )
+    {
+        vulkanInfo::instance.pipeline_cache_dir = p_directory;
+    }
+
+    VkPipelineCache VGraphical::getPipelineCache(void)
+    {
+        wait_device( vulkanInfo::instance );
+        return vulkanInfo::instance.pipeline_cache;
+    }
+
+    bool VGraphical::savePipelineCache(void)
+    {
+        if( wait_device( vulkanInfo::instance ) )
+        {
+            return true;
+        }
+        return save_pipeline_cache( vulkanInfo::instance );
+    }
+}
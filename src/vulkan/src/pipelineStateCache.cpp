@@ -0,0 +1,580 @@
+#include "pipelineStateCache.h"
+#include "vulkanInfo.h"
+#include "VGraphical.h"
+#include "log.hpp"
+#include "cpuProfiler.h"
+#include <cassert>
+#include <algorithm>
+#include <cstring>
+
+using ROOT_SPACE::PipelineStateHandle;
+using ROOT_SPACE::PipelineState;
+using ROOT_SPACE::PipelineStatus;
+using ROOT_SPACE::ShaderHandle;
+using ROOT_SPACE::ShaderStatus;
+using ROOT_SPACE::jobSystem;
+
+template< typename T >
+static inline void append_key( std::string & p_bytes, const T & p_value )
+{
+    p_bytes.append( (const char *)&p_value, sizeof( T ) );
+}
+
+static inline bool is_compute( const PipelineState & p_state )
+{
+    return p_state.compute != VK_NULL_HANDLE || p_state.compute_shader != SHADER_NONE;
+}
+
+pipelineStateCache::pipelineStateCache(void)
+    : mCount( 0 )
+{
+    mDevice = VK_NULL_HANDLE;
+    mPipelineCache = VK_NULL_HANDLE;
+    mShaders = nullptr;
+    mRetired = nullptr;
+    mActive = 0;
+    mMaxActive = 1;
+    for( uint32_t i = 0; i < PIPELINE_MAX_CHUNKS; ++i )
+    {
+        mChunks[i].store( nullptr, std::memory_order_relaxed );
+    }
+}
+
+bool pipelineStateCache::init( VkDevice p_device, VkPipelineCache p_pipelineCache, shaderCache * p_shaders, deletionQueue * p_retired )
+{
+    mDevice = p_device;
+    mPipelineCache = p_pipelineCache;
+    mShaders = p_shaders;
+    mRetired = p_retired;
+    mActive = 0;
+    mMaxActive = std::max< uint32_t >( 1, jobSystem::workerCount() / 2 );
+    return false;
+}
+
+void pipelineStateCache::destroy(void)
+{
+    wait();
+
+    const uint32_t t_count = mCount.load( std::memory_order_acquire );
+    for( uint32_t i = 0; i < t_count; ++i )
+    {
+        Entry * t_entry = entry( i );
+        VkPipeline t_pipeline = t_entry ? t_entry->pipeline.load( std::memory_order_relaxed ) : VK_NULL_HANDLE;
+        if( t_pipeline != VK_NULL_HANDLE )
+        {
+            vkd.DestroyPipeline( mDevice, t_pipeline, nullptr );
+        }
+    }
+
+    for( uint32_t i = 0; i < PIPELINE_MAX_CHUNKS; ++i )
+    {
+        delete[] mChunks[i].exchange( nullptr );
+    }
+    for( uint32_t i = 0; i < PIPELINE_SHARDS; ++i )
+    {
+        std::lock_guard< std::mutex > t_lock( mShards[i].mutex );
+        mShards[i].handles.clear();
+    }
+
+    {
+        std::lock_guard< std::mutex > t_lock( mDependMutex );
+        mDependents.clear();
+    }
+
+    mCount.store( 0 );
+    mJobs.clear();
+}
+
+// the fields that decide the pipeline, array tails past the counts are left out
+pipelineStateCache::Key pipelineStateCache::makeKey( const PipelineState & p_state )
+{
+    Key t_key;
+    std::string & t_bytes = t_key.bytes;
+
+    append_key( t_bytes, p_state.compute );
+    append_key( t_bytes, p_state.compute_shader );
+    append_key( t_bytes, p_state.layout );
+
+    if( !is_compute( p_state ) )
+    {
+        append_key( t_bytes, p_state.vertex );
+        append_key( t_bytes, p_state.fragment );
+        append_key( t_bytes, p_state.vertex_shader );
+        append_key( t_bytes, p_state.fragment_shader );
+        append_key( t_bytes, p_state.render_pass );
+        append_key( t_bytes, p_state.subpass );
+
+        const uint32_t t_bindings = std::min< uint32_t >( p_state.binding_count, PIPELINE_MAX_VERTEX_BINDINGS );
+        const uint32_t t_attributes = std::min< uint32_t >( p_state.attribute_count, PIPELINE_MAX_VERTEX_ATTRIBUTES );
+        const uint32_t t_colors = std::min< uint32_t >( p_state.color_count, PIPELINE_MAX_COLOR_ATTACHMENTS );
+
+        append_key( t_bytes, t_bindings );
+        t_bytes.append( (const char *)p_state.bindings, sizeof( VkVertexInputBindingDescription ) * t_bindings );
+        append_key( t_bytes, t_attributes );
+        t_bytes.append( (const char *)p_state.attributes, sizeof( VkVertexInputAttributeDescription ) * t_attributes );
+
+        append_key( t_bytes, p_state.topology );
+        append_key( t_bytes, p_state.polygon_mode );
+        append_key( t_bytes, p_state.cull_mode );
+        append_key( t_bytes, p_state.front_face );
+        append_key( t_bytes, p_state.samples );
+
+        const uint8_t t_depth = ( p_state.depth_test ? 1 : 0 ) | ( p_state.depth_write ? 2 : 0 );
+        append_key( t_bytes, t_depth );
+        append_key( t_bytes, p_state.depth_compare );
+
+        append_key( t_bytes, t_colors );
+        t_bytes.append( (const char *)p_state.blend, sizeof( VkPipelineColorBlendAttachmentState ) * t_colors );
+    }
+
+    // fnv-1a, it only has to spread keys over shards and buckets
+    uint64_t t_hash = 14695981039346656037ull;
+    for( size_t i = 0; i < t_bytes.size(); ++i )
+    {
+        t_hash = ( t_hash ^ (uint8_t)t_bytes[i] ) * 1099511628211ull;
+    }
+    t_key.hash = t_hash;
+
+    return t_key;
+}
+
+pipelineStateCache::Entry * pipelineStateCache::entry( PipelineStateHandle p_handle ) const
+{
+    if( p_handle == PIPELINE_NONE || p_handle >= mCount.load( std::memory_order_acquire ) )
+    {
+        return nullptr;
+    }
+
+    Entry * t_chunk = mChunks[p_handle / PIPELINE_CHUNK_SIZE].load( std::memory_order_acquire );
+    return t_chunk ? &t_chunk[p_handle % PIPELINE_CHUNK_SIZE] : nullptr;
+}
+
+PipelineStateHandle pipelineStateCache::request( const PipelineState & p_state )
+{
+    Key t_key = makeKey( p_state );
+    Shard & t_shard = mShards[t_key.hash % PIPELINE_SHARDS];
+
+    PipelineStateHandle t_handle;
+    {
+        std::lock_guard< std::mutex > t_lock( t_shard.mutex );
+
+        std::unordered_map< Key, PipelineStateHandle, KeyHash >::iterator t_found = t_shard.handles.find( t_key );
+        if( t_found != t_shard.handles.end() )
+        {
+            return t_found->second;
+        }
+
+        t_handle = mCount.load( std::memory_order_relaxed );
+        // other shards take handles concurrently, claim one for good
+        while( t_handle < PIPELINE_CHUNK_SIZE * PIPELINE_MAX_CHUNKS
+               && !mCount.compare_exchange_weak( t_handle, t_handle + 1, std::memory_order_acq_rel ) )
+        {
+        }
+        if( t_handle >= PIPELINE_CHUNK_SIZE * PIPELINE_MAX_CHUNKS )
+        {
+            LOG.error( "pipelineStateCache Failure: more than {0} pipeline states", PIPELINE_CHUNK_SIZE * PIPELINE_MAX_CHUNKS );
+            return PIPELINE_NONE;
+        }
+
+        std::atomic< Entry * > & t_slot = mChunks[t_handle / PIPELINE_CHUNK_SIZE];
+        Entry * t_chunk = t_slot.load( std::memory_order_acquire );
+        if( !t_chunk )
+        {
+            Entry * t_new = new Entry[PIPELINE_CHUNK_SIZE];
+            if( t_slot.compare_exchange_strong( t_chunk, t_new, std::memory_order_acq_rel ) )
+            {
+                t_chunk = t_new;
+            }else
+            {
+                delete[] t_new;
+            }
+        }
+
+        Entry & t_entry = t_chunk[t_handle % PIPELINE_CHUNK_SIZE];
+        t_entry.state = p_state;
+        t_entry.pipeline.store( VK_NULL_HANDLE, std::memory_order_relaxed );
+        t_entry.generation.store( 0, std::memory_order_relaxed );
+        t_entry.status.store( (int)PipelineStatus::Pending, std::memory_order_release );
+
+        t_shard.handles.insert( std::make_pair( std::move( t_key ), t_handle ) );
+    }
+
+    // known before the first compile, so a shader finishing in between
+    // still queues it again
+    const ShaderHandle t_shaders[3] = { p_state.vertex_shader, p_state.fragment_shader, p_state.compute_shader };
+    {
+        std::lock_guard< std::mutex > t_lock( mDependMutex );
+        for( uint32_t i = 0; i < 3; ++i )
+        {
+            if( t_shaders[i] != SHADER_NONE && ( i == 2 ) == is_compute( p_state ) )
+            {
+                mDependents[t_shaders[i]].push_back( t_handle );
+            }
+        }
+    }
+
+    enqueue( t_handle );
+    return t_handle;
+}
+
+VkPipeline pipelineStateCache::pipeline( PipelineStateHandle p_handle, VkPipeline p_fallback ) const
+{
+    const Entry * t_entry = entry( p_handle );
+    if( !t_entry )
+    {
+        return p_fallback;
+    }
+
+    VkPipeline t_pipeline = t_entry->pipeline.load( std::memory_order_acquire );
+    return t_pipeline != VK_NULL_HANDLE ? t_pipeline : p_fallback;
+}
+
+PipelineStatus pipelineStateCache::status( PipelineStateHandle p_handle ) const
+{
+    const Entry * t_entry = entry( p_handle );
+    if( !t_entry )
+    {
+        return PipelineStatus::Failed;
+    }
+
+    return (PipelineStatus)t_entry->status.load( std::memory_order_acquire );
+}
+
+void pipelineStateCache::enqueue( PipelineStateHandle p_handle )
+{
+    entry( p_handle )->generation.fetch_add( 1, std::memory_order_acq_rel );
+
+    std::lock_guard< std::mutex > t_lock( mQueueMutex );
+
+    mQueue.push_back( p_handle );
+    if( mActive >= mMaxActive )
+    {
+        return;
+    }
+
+    ++mActive;
+    mJobs.erase( std::remove_if( mJobs.begin(), mJobs.end(), jobSystem::isFinished ), mJobs.end() );
+    mJobs.push_back( jobSystem::run( [this](void) { drain(); } ) );
+}
+
+void pipelineStateCache::drain(void)
+{
+    for( ;; )
+    {
+        PipelineStateHandle t_handle;
+        {
+            std::lock_guard< std::mutex > t_lock( mQueueMutex );
+            if( mQueue.empty() )
+            {
+                --mActive;
+                return;
+            }
+            t_handle = mQueue.front();
+            mQueue.pop_front();
+        }
+
+        Entry & t_entry = *entry( t_handle );
+        const uint32_t t_generation = t_entry.generation.load( std::memory_order_acquire );
+
+        // shaders still loading queue it again once they are done
+        VkShaderModule t_modules[3];
+        VkShaderModule t_acquired[3];
+        bool t_failed = false;
+        VkPipeline t_pipeline = VK_NULL_HANDLE;
+        if( resolve( t_entry.state, t_modules, t_acquired, t_failed ) )
+        {
+            t_pipeline = compile( t_entry.state, t_modules );
+            for( uint32_t i = 0; i < 3; ++i )
+            {
+                mShaders->release( t_acquired[i] );
+            }
+            t_failed = t_pipeline == VK_NULL_HANDLE;
+        }
+
+        if( t_pipeline != VK_NULL_HANDLE )
+        {
+            install( t_entry, t_generation, t_pipeline );
+        }else if( t_failed && t_entry.pipeline.load( std::memory_order_acquire ) == VK_NULL_HANDLE )
+        {
+            // a failed rebuild keeps the pipeline that worked
+            t_entry.status.store( (int)PipelineStatus::Failed, std::memory_order_release );
+        }
+    }
+}
+
+bool pipelineStateCache::resolve( const PipelineState & p_state, VkShaderModule * p_modules, VkShaderModule * p_acquired, bool & p_failed )
+{
+    const VkShaderModule t_given[3] = { p_state.vertex, p_state.fragment, p_state.compute };
+    const ShaderHandle t_shaders[3] = { p_state.vertex_shader, p_state.fragment_shader, p_state.compute_shader };
+
+    p_failed = false;
+    bool t_ready = true;
+    for( uint32_t i = 0; i < 3; ++i )
+    {
+        p_acquired[i] = VK_NULL_HANDLE;
+        p_modules[i] = t_given[i];
+        if( t_shaders[i] == SHADER_NONE || ( i == 2 ) != is_compute( p_state ) )
+        {
+            continue;
+        }
+
+        p_acquired[i] = mShaders->acquire( t_shaders[i] );
+        p_modules[i] = p_acquired[i];
+        if( p_acquired[i] == VK_NULL_HANDLE )
+        {
+            t_ready = false;
+            p_failed = p_failed || mShaders->status( t_shaders[i] ) == ShaderStatus::Failed;
+        }
+    }
+
+    if( !t_ready )
+    {
+        for( uint32_t i = 0; i < 3; ++i )
+        {
+            mShaders->release( p_acquired[i] );
+        }
+    }
+    return t_ready;
+}
+
+void pipelineStateCache::install( Entry & p_entry, uint32_t p_generation, VkPipeline p_pipeline )
+{
+    VkPipeline t_old;
+    {
+        std::lock_guard< std::mutex > t_lock( mInstallMutex );
+
+        // a newer compile of the same state is on its way
+        if( p_entry.generation.load( std::memory_order_acquire ) != p_generation )
+        {
+            vkd.DestroyPipeline( mDevice, p_pipeline, nullptr );
+            return;
+        }
+
+        t_old = p_entry.pipeline.exchange( p_pipeline, std::memory_order_acq_rel );
+        p_entry.status.store( (int)PipelineStatus::Ready, std::memory_order_release );
+    }
+
+    // frames in flight on any target may still draw with it
+    if( t_old != VK_NULL_HANDLE )
+    {
+        VkDevice t_device = mDevice;
+        mRetired->retire( [t_device, t_old](void)
+        {
+            vkd.DestroyPipeline( t_device, t_old, nullptr );
+        } );
+    }
+}
+
+void pipelineStateCache::shaderChanged( ShaderHandle p_shader )
+{
+    std::vector< PipelineStateHandle > t_dependents;
+    {
+        std::lock_guard< std::mutex > t_lock( mDependMutex );
+        std::map< ShaderHandle, std::vector< PipelineStateHandle > >::iterator t_found = mDependents.find( p_shader );
+        if( t_found == mDependents.end() )
+        {
+            return;
+        }
+        t_dependents = t_found->second;
+    }
+
+    for( size_t i = 0; i < t_dependents.size(); ++i )
+    {
+        enqueue( t_dependents[i] );
+    }
+}
+
+void pipelineStateCache::wait(void)
+{
+    for( ;; )
+    {
+        std::vector< jobSystem::JobHandle > t_jobs;
+        {
+            std::lock_guard< std::mutex > t_lock( mQueueMutex );
+            mJobs.erase( std::remove_if( mJobs.begin(), mJobs.end(), jobSystem::isFinished ), mJobs.end() );
+            if( mJobs.empty() )
+            {
+                return;
+            }
+            t_jobs = mJobs;
+        }
+
+        // job system threads keep running other jobs while they wait
+        for( size_t i = 0; i < t_jobs.size(); ++i )
+        {
+            jobSystem::wait( t_jobs[i] );
+        }
+    }
+}
+
+VkPipeline pipelineStateCache::compile( const PipelineState & p_state, const VkShaderModule * p_modules )
+{
+    CPU_ZONE( "compile pipeline" );
+    VkResult err;
+    VkPipeline t_pipeline = VK_NULL_HANDLE;
+
+    if( is_compute( p_state ) )
+    {
+        VkComputePipelineCreateInfo t_info = {};
+        t_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        t_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        t_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        t_info.stage.module = p_modules[2];
+        t_info.stage.pName = "main";
+        t_info.layout = p_state.layout;
+
+        // the pipeline cache is internally synchronized
+        err = vkd.CreateComputePipelines( mDevice, mPipelineCache, 1, &t_info, nullptr, &t_pipeline );
+        if( err )
+        {
+            LOG.error( "pipelineStateCache Failure: vkCreateComputePipelines returned {0}", (int)err );
+            return VK_NULL_HANDLE;
+        }
+        return t_pipeline;
+    }
+
+    VkPipelineShaderStageCreateInfo t_stages[2] = {};
+    uint32_t t_stageCount = 0;
+    if( p_modules[0] != VK_NULL_HANDLE )
+    {
+        t_stages[t_stageCount].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        t_stages[t_stageCount].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        t_stages[t_stageCount].module = p_modules[0];
+        t_stages[t_stageCount].pName = "main";
+        ++t_stageCount;
+    }
+    if( p_modules[1] != VK_NULL_HANDLE )
+    {
+        t_stages[t_stageCount].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        t_stages[t_stageCount].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        t_stages[t_stageCount].module = p_modules[1];
+        t_stages[t_stageCount].pName = "main";
+        ++t_stageCount;
+    }
+
+    VkPipelineVertexInputStateCreateInfo t_vertexInput = {};
+    t_vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    t_vertexInput.vertexBindingDescriptionCount = std::min< uint32_t >( p_state.binding_count, PIPELINE_MAX_VERTEX_BINDINGS );
+    t_vertexInput.pVertexBindingDescriptions = p_state.bindings;
+    t_vertexInput.vertexAttributeDescriptionCount = std::min< uint32_t >( p_state.attribute_count, PIPELINE_MAX_VERTEX_ATTRIBUTES );
+    t_vertexInput.pVertexAttributeDescriptions = p_state.attributes;
+
+    VkPipelineInputAssemblyStateCreateInfo t_inputAssembly = {};
+    t_inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    t_inputAssembly.topology = p_state.topology;
+
+    VkPipelineViewportStateCreateInfo t_viewport = {};
+    t_viewport.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    t_viewport.viewportCount = 1;
+    t_viewport.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo t_raster = {};
+    t_raster.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    t_raster.polygonMode = p_state.polygon_mode;
+    t_raster.cullMode = p_state.cull_mode;
+    t_raster.frontFace = p_state.front_face;
+    t_raster.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo t_multisample = {};
+    t_multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    t_multisample.rasterizationSamples = p_state.samples;
+
+    VkPipelineDepthStencilStateCreateInfo t_depth = {};
+    t_depth.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    t_depth.depthTestEnable = p_state.depth_test ? VK_TRUE : VK_FALSE;
+    t_depth.depthWriteEnable = p_state.depth_write ? VK_TRUE : VK_FALSE;
+    t_depth.depthCompareOp = p_state.depth_compare;
+
+    VkPipelineColorBlendStateCreateInfo t_blend = {};
+    t_blend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    t_blend.attachmentCount = std::min< uint32_t >( p_state.color_count, PIPELINE_MAX_COLOR_ATTACHMENTS );
+    t_blend.pAttachments = p_state.blend;
+
+    const VkDynamicState t_dynamic[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo t_dynamicState = {};
+    t_dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    t_dynamicState.dynamicStateCount = 2;
+    t_dynamicState.pDynamicStates = t_dynamic;
+
+    VkGraphicsPipelineCreateInfo t_info = {};
+    t_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    t_info.stageCount = t_stageCount;
+    t_info.pStages = t_stages;
+    t_info.pVertexInputState = &t_vertexInput;
+    t_info.pInputAssemblyState = &t_inputAssembly;
+    t_info.pViewportState = &t_viewport;
+    t_info.pRasterizationState = &t_raster;
+    t_info.pMultisampleState = &t_multisample;
+    t_info.pDepthStencilState = &t_depth;
+    t_info.pColorBlendState = &t_blend;
+    t_info.pDynamicState = &t_dynamicState;
+    t_info.layout = p_state.layout;
+    t_info.renderPass = p_state.render_pass;
+    t_info.subpass = p_state.subpass;
+
+    err = vkd.CreateGraphicsPipelines( mDevice, mPipelineCache, 1, &t_info, nullptr, &t_pipeline );
+    if( err )
+    {
+        LOG.error( "pipelineStateCache Failure: vkCreateGraphicsPipelines returned {0}", (int)err );
+        return VK_NULL_HANDLE;
+    }
+    return t_pipeline;
+}
+
+namespace ROOT_SPACE
+{
+    PipelineState VGraphical::defaultPipelineState(void)
+    {
+        PipelineState t_state;
+        memset( &t_state, 0, sizeof( t_state ) );
+        t_state.vertex_shader = SHADER_NONE;
+        t_state.fragment_shader = SHADER_NONE;
+        t_state.compute_shader = SHADER_NONE;
+
+        t_state.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        t_state.polygon_mode = VK_POLYGON_MODE_FILL;
+        t_state.cull_mode = VK_CULL_MODE_BACK_BIT;
+        t_state.front_face = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        t_state.samples = VK_SAMPLE_COUNT_1_BIT;
+        t_state.depth_test = true;
+        t_state.depth_write = true;
+        t_state.depth_compare = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+        // one opaque color attachment
+        t_state.color_count = 1;
+        t_state.blend[0].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        return t_state;
+    }
+
+    PipelineStateHandle VGraphical::requestPipeline( const PipelineState & p_state )
+    {
+        if( wait_device( vulkanInfo::instance ) )
+        {
+            return PIPELINE_NONE;
+        }
+
+        return vulkanInfo::instance.pipeline_states.request( p_state );
+    }
+
+    VkPipeline VGraphical::getPipeline( const PipelineStateHandle p_handle, VkPipeline p_fallback )
+    {
+        return vulkanInfo::instance.pipeline_states.pipeline( p_handle, p_fallback );
+    }
+
+    PipelineStatus VGraphical::getPipelineStatus( const PipelineStateHandle p_handle )
+    {
+        return vulkanInfo::instance.pipeline_states.status( p_handle );
+    }
+
+    void VGraphical::waitPipelines(void)
+    {
+        if( wait_device( vulkanInfo::instance ) )
+        {
+            return;
+        }
+
+        // loads finishing queue their pipelines before they end
+        vulkanInfo::instance.shaders.wait();
+        vulkanInfo::instance.pipeline_states.wait();
+    }
+}
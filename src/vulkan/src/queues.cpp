@@ -0,0 +1,118 @@
+#include "vulkanInfo.h"
+#include "VGraphical.h"
+#include "log.hpp"
+
+namespace ROOT_SPACE
+{
+    // vkQueueSubmit needs the queue externally synchronized; a queue that
+    // fell back to another one's handle shares that one's lock
+    std::mutex & queue_lock( vulkanInfo & p_vulInfo, VkQueue p_queue )
+    {
+        if( p_queue == p_vulInfo.queue )
+        {
+            return p_vulInfo.queue_locks[0];
+        }
+        if( p_queue == p_vulInfo.compute_queue )
+        {
+            return p_vulInfo.queue_locks[1];
+        }
+        return p_vulInfo.queue_locks[2];
+    }
+
+    static VkQueue queue_of( vulkanInfo & p_vulInfo, const QueueType p_type )
+    {
+        switch( p_type )
+        {
+        case QueueType::Compute:
+            return p_vulInfo.compute_queue;
+        case QueueType::Transfer:
+            return p_vulInfo.transfer_queue;
+        default:
+            return p_vulInfo.queue;
+        }
+    }
+
+    uint32_t VGraphical::getQueueFamily( const QueueType p_type )
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+        wait_device( vulInfo );
+
+        switch( p_type )
+        {
+        case QueueType::Compute:
+            return vulInfo.compute_queue_node_index;
+        case QueueType::Transfer:
+            return vulInfo.transfer_queue_node_index;
+        default:
+            return vulInfo.graphics_queue_node_index;
+        }
+    }
+
+    bool VGraphical::hasDedicatedQueue( const QueueType p_type )
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+        wait_device( vulInfo );
+
+        return p_type != QueueType::Graphics && queue_of( vulInfo, p_type ) != vulInfo.queue;
+    }
+
+    bool VGraphical::submit( const QueueType p_type, const std::vector< VkCommandBuffer > & p_cmds,
+                             const std::vector< VkSemaphore > & p_waits, const std::vector< VkPipelineStageFlags > & p_waitStages,
+                             const std::vector< VkSemaphore > & p_signals, VkFence p_fence )
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+
+        if( p_waits.size() != p_waitStages.size() )
+        {
+            LOG.error( "submit Failure: {0} wait semaphores but {1} wait stages", (uint32_t)p_waits.size(), (uint32_t)p_waitStages.size() );
+            return true;
+        }
+
+        if( wait_device( vulInfo ) )
+        {
+            LOG.error( "submit Failure: device creation failed" );
+            return true;
+        }
+
+        VkSubmitInfo submit_info = {};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.pNext = nullptr;
+        submit_info.waitSemaphoreCount = (uint32_t)p_waits.size();
+        submit_info.pWaitSemaphores = p_waits.data();
+        submit_info.pWaitDstStageMask = p_waitStages.data();
+        submit_info.commandBufferCount = (uint32_t)p_cmds.size();
+        submit_info.pCommandBuffers = p_cmds.data();
+        submit_info.signalSemaphoreCount = (uint32_t)p_signals.size();
+        submit_info.pSignalSemaphores = p_signals.data();
+
+        VkQueue t_queue = queue_of( vulInfo, p_type );
+
+        VkResult err;
+        {
+            std::lock_guard< std::mutex > t_lock( queue_lock( vulInfo, t_queue ) );
+            err = vkd.QueueSubmit( t_queue, 1, &submit_info, p_fence );
+        }
+
+        if( err )
+        {
+            LOG.error( "submit Failure: vkQueueSubmit returned {0}", (int)err );
+            return true;
+        }
+
+        return false;
+    }
+
+    void VGraphical::waitBeforeFrame( VkSemaphore p_semaphore, const VkPipelineStageFlags p_stage, window * p_window )
+    {
+        renderContext * t_context = find_context( vulkanInfo::instance, p_window );
+        if( !t_context )
+        {
+            LOG.error( "waitBeforeFrame Failure: no render context for this target" );
+            return;
+        }
+
+        std::lock_guard< std::mutex > t_lock( t_context->frame_waits_mutex );
+        t_context->frame_waits.push_back( p_semaphore );
+        t_context->frame_wait_stages.push_back( p_stage );
+    }
+}
@@ -0,0 +1,503 @@
+#include "vulkanInfo.h"
+#include "VGraphical.h"
+#include "log.hpp"
+#include "cpuProfiler.h"
+#include <cassert>
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
+
+renderContext::renderContext(void)
+{
+    handle = nullptr;
+    surface = VK_NULL_HANDLE;
+    policy = ROOT_SPACE::PresentPolicy::VSync;
+    format = VK_FORMAT_UNDEFINED;
+    color_space = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    extent.width = 0;
+    extent.height = 0;
+    present_mode = VK_PRESENT_MODE_FIFO_KHR;
+    swapchainImageCount = 0;
+    swapchain = VK_NULL_HANDLE;
+    buffers = nullptr;
+    offscreen_mem = nullptr;
+    current_buffer = 0;
+    frames = nullptr;
+    frame_count = 0;
+    frame_index = 0;
+    present_pending = false;
+    present_frame = nullptr;
+    graph_backbuffer = GRAPH_RESOURCE_NONE;
+    resize_pending = false;
+    framebuffer_size = glm::ivec2( 0, 0 );
+}
+
+namespace ROOT_SPACE
+{
+    renderContext * find_context( vulkanInfo & p_vulInfo, window * p_window )
+    {
+        std::lock_guard< std::mutex > t_lock( p_vulInfo.contexts_mutex );
+        return find_context_locked( p_vulInfo, p_window );
+    }
+
+    renderContext * find_context_locked( vulkanInfo & p_vulInfo, window * p_window )
+    {
+        if( !p_window )
+        {
+            return p_vulInfo.offscreen;
+        }
+
+        std::map< GLFWwindow *, renderContext * >::iterator t_it = p_vulInfo.contexts.find( p_window->_GLFW_WindowHandle() );
+        return t_it != p_vulInfo.contexts.end() ? t_it->second : nullptr;
+    }
+
+    static VkPresentModeKHR choose_present_mode( const PresentPolicy p_policy,
+                                                 const VkPresentModeKHR * p_modes, const uint32_t p_count )
+    {
+        static const VkPresentModeKHR vsync[] = { VK_PRESENT_MODE_FIFO_KHR };
+        static const VkPresentModeKHR adaptive[] = { VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR };
+        static const VkPresentModeKHR low_latency[] = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR,
+                                                        VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR };
+        static const VkPresentModeKHR throughput[] = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+                                                       VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR };
+
+        const VkPresentModeKHR * t_order = vsync;
+        uint32_t t_orderCount = ARRAY_SIZE( vsync );
+
+        switch( p_policy )
+        {
+        case PresentPolicy::AdaptiveVSync:
+            t_order = adaptive;
+            t_orderCount = ARRAY_SIZE( adaptive );
+            break;
+        case PresentPolicy::LowLatency:
+            t_order = low_latency;
+            t_orderCount = ARRAY_SIZE( low_latency );
+            break;
+        case PresentPolicy::Throughput:
+            t_order = throughput;
+            t_orderCount = ARRAY_SIZE( throughput );
+            break;
+        default:
+            break;
+        }
+
+        for( uint32_t i = 0; i < t_orderCount; ++i )
+        {
+            for( uint32_t j = 0; j < p_count; ++j )
+            {
+                if( p_modes[j] == t_order[i] )
+                {
+                    return t_order[i];
+                }
+            }
+        }
+
+        // FIFO is the only mode every implementation must support
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+
+    static uint32_t choose_image_count( const PresentPolicy p_policy, const VkPresentModeKHR p_mode,
+                                        const VkSurfaceCapabilitiesKHR & p_caps )
+    {
+        uint32_t t_count = p_caps.minImageCount;
+
+        // mailbox needs a spare image to always have one to render into, and
+        // a throughput policy should never block in acquire waiting for one
+        if( p_mode == VK_PRESENT_MODE_MAILBOX_KHR || p_policy == PresentPolicy::Throughput )
+        {
+            t_count += 1;
+        }
+
+        // If maxImageCount is 0, we can ask for as many images as we want;
+        // otherwise we're limited to maxImageCount
+        if( p_caps.maxImageCount > 0 && t_count > p_caps.maxImageCount )
+        {
+            t_count = p_caps.maxImageCount;
+        }
+
+        return t_count;
+    }
+
+    static void destroy_swapchain_views( vulkanInfo & p_vulInfo, renderContext & p_context )
+    {
+        if( !p_context.buffers )
+        {
+            return;
+        }
+
+        for( uint32_t i = 0; i < p_context.swapchainImageCount; ++i )
+        {
+            vkd.DestroyImageView( p_vulInfo.device, p_context.buffers[i].view, nullptr );
+        }
+        free( p_context.buffers );
+        p_context.buffers = nullptr;
+    }
+
+    // handing the old chain to oldSwapchain lets the driver recycle its
+    // resources; it and its views are retired, frames still in flight
+    // keep using them and nothing waits for the gpu here
+    static bool prepare_swapchain( vulkanInfo & p_vulInfo, renderContext & p_context, const glm::ivec2 & p_size )
+    {
+        VkResult U_ASSERT_ONLY err;
+
+        std::vector< VkImageView > t_oldViews;
+        if( p_context.buffers )
+        {
+            for( uint32_t i = 0; i < p_context.swapchainImageCount; ++i )
+            {
+                t_oldViews.push_back( p_context.buffers[i].view );
+            }
+            free( p_context.buffers );
+            p_context.buffers = nullptr;
+        }
+
+        VkSwapchainKHR oldSwapchain = p_context.swapchain;
+
+        // Check the surface capabilities and formats
+        VkSurfaceCapabilitiesKHR surfCapabilities;
+        err = p_vulInfo.fpGetPhysicalDeviceSurfaceCapabilitiesKHR( p_vulInfo.gpu, p_context.surface, &surfCapabilities );
+        assert(!err);
+
+        uint32_t presentModeCount;
+        err = p_vulInfo.fpGetPhysicalDeviceSurfacePresentModesKHR( p_vulInfo.gpu, p_context.surface, &presentModeCount, nullptr );
+        assert(!err);
+
+        VkPresentModeKHR *presentModes = (VkPresentModeKHR *)malloc(presentModeCount * sizeof(VkPresentModeKHR));
+        assert(presentModes);
+
+        err = p_vulInfo.fpGetPhysicalDeviceSurfacePresentModesKHR( p_vulInfo.gpu, p_context.surface, &presentModeCount, presentModes );
+        assert(!err);
+
+        VkExtent2D swapchainExtent;
+        // width and height are either both 0xFFFFFFFF, or both not 0xFFFFFFFF.
+        if (surfCapabilities.currentExtent.width == 0xFFFFFFFF)
+        {
+            // If the surface size is undefined, the size is set to the size
+            // of the images requested, which must fit within the minimum and
+            // maximum values.
+            swapchainExtent.width = (uint32_t)p_size.x;
+            swapchainExtent.height = (uint32_t)p_size.y;
+
+            if (swapchainExtent.width < surfCapabilities.minImageExtent.width) {
+                swapchainExtent.width = surfCapabilities.minImageExtent.width;
+            } else if (swapchainExtent.width > surfCapabilities.maxImageExtent.width) {
+                swapchainExtent.width = surfCapabilities.maxImageExtent.width;
+            }
+            
+            if (swapchainExtent.height < surfCapabilities.minImageExtent.height) {
+                swapchainExtent.height = surfCapabilities.minImageExtent.height;
+            } else if (swapchainExtent.height > surfCapabilities.maxImageExtent.height) {
+                swapchainExtent.height = surfCapabilities.maxImageExtent.height;
+            }
+        }else{
+            // If the surface size is defined, the swap chain size must match
+            swapchainExtent = surfCapabilities.currentExtent;
+        }
+
+        p_context.present_mode = choose_present_mode( p_context.policy, presentModes, presentModeCount );
+
+        // Determine the number of VkImage's to use in the swap chain.
+        uint32_t desiredNumOfSwapchainImages = choose_image_count( p_context.policy, p_context.present_mode, surfCapabilities );
+
+        LOG.info( "swapchain present mode {0} with {1} images", (int)p_context.present_mode, desiredNumOfSwapchainImages );
+
+        VkSurfaceTransformFlagsKHR preTransform;
+        if (surfCapabilities.supportedTransforms & VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR) 
+        {
+            preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+        } else {
+            preTransform = surfCapabilities.currentTransform;
+        }
+
+        VkSwapchainCreateInfoKHR swapchain = { };
+
+        swapchain.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+        swapchain.pNext = nullptr;
+        swapchain.surface = p_context.surface;
+        swapchain.minImageCount = desiredNumOfSwapchainImages;
+        swapchain.imageFormat = p_context.format;
+        swapchain.imageColorSpace = p_context.color_space;
+        swapchain.imageExtent.width = swapchainExtent.width;
+        swapchain.imageExtent.height = swapchainExtent.height;
+        swapchain.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        swapchain.preTransform = (VkSurfaceTransformFlagBitsKHR)preTransform;
+        swapchain.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+        swapchain.imageArrayLayers = 1;
+        swapchain.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        swapchain.queueFamilyIndexCount = 0;
+        swapchain.pQueueFamilyIndices = nullptr;
+        swapchain.presentMode = p_context.present_mode;
+        swapchain.oldSwapchain = oldSwapchain;
+        swapchain.clipped = true;
+        swapchain.flags = VK_SAMPLE_COUNT_1_BIT;
+
+        err = vkd.CreateSwapchainKHR(p_vulInfo.device, &swapchain, nullptr, &p_context.swapchain);
+        assert(!err);
+
+        // Note: destroying the swapchain also cleans up all its associated
+        // presentable images once the platform is done with them.
+        if( oldSwapchain != VK_NULL_HANDLE || !t_oldViews.empty() )
+        {
+            VkDevice t_device = p_vulInfo.device;
+            PFN_vkDestroySwapchainKHR t_destroySwapchain = vkd.DestroySwapchainKHR;
+            p_vulInfo.retired.retire( [t_device, t_destroySwapchain, t_oldViews, oldSwapchain]() {
+                for( size_t i = 0; i < t_oldViews.size(); ++i )
+                {
+                    vkd.DestroyImageView( t_device, t_oldViews[i], nullptr );
+                }
+                if( oldSwapchain != VK_NULL_HANDLE )
+                {
+                    t_destroySwapchain( t_device, oldSwapchain, nullptr );
+                }
+            }, &p_context );
+        }
+
+        err = vkd.GetSwapchainImagesKHR(p_vulInfo.device, p_context.swapchain,
+                                        &p_context.swapchainImageCount, nullptr);
+        assert(!err);
+
+        VkImage *swapchainImages =
+            (VkImage *)malloc(p_context.swapchainImageCount * sizeof(VkImage));
+        assert(swapchainImages);
+        err = vkd.GetSwapchainImagesKHR(p_vulInfo.device, p_context.swapchain,
+                  &p_context.swapchainImageCount, swapchainImages);
+        assert(!err);
+
+        p_context.buffers = (SwapchainBuffers *)malloc(sizeof(SwapchainBuffers) * p_context.swapchainImageCount);
+        assert(p_context.buffers);
+
+        for (uint32_t i = 0; i < p_context.swapchainImageCount; i++) 
+        {
+            VkImageViewCreateInfo color_attachment_view = { };
+            color_attachment_view.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            color_attachment_view.pNext = nullptr;
+            color_attachment_view.format = p_context.format;
+            color_attachment_view.viewType = VK_IMAGE_VIEW_TYPE_2D;
+
+            color_attachment_view.components.r = VK_COMPONENT_SWIZZLE_R;
+            color_attachment_view.components.g = VK_COMPONENT_SWIZZLE_G;
+            color_attachment_view.components.b = VK_COMPONENT_SWIZZLE_B;
+            color_attachment_view.components.a = VK_COMPONENT_SWIZZLE_A;
+            color_attachment_view.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            color_attachment_view.subresourceRange.baseMipLevel = 0;
+            color_attachment_view.subresourceRange.levelCount = 1;
+            color_attachment_view.subresourceRange.baseArrayLayer = 0;
+            color_attachment_view.subresourceRange.layerCount = 1;
+
+
+            p_context.buffers[i].image = swapchainImages[i];
+            color_attachment_view.image = p_context.buffers[i].image;
+
+            err = vkd.CreateImageView(p_vulInfo.device, &color_attachment_view, nullptr,
+                                &p_context.buffers[i].view);
+            assert(!err);
+        }
+
+        free(swapchainImages);
+
+        p_context.extent = swapchainExtent;
+        p_context.current_buffer = 0;
+
+        if (presentModes != nullptr) {
+            free(presentModes);
+        }
+
+        return false;
+    }
+
+    bool recreate_swapchain( vulkanInfo & p_vulInfo, renderContext & p_context )
+    {
+        // a minimized window has no extent, keep the request pending
+        if( p_context.framebuffer_size.x <= 0 || p_context.framebuffer_size.y <= 0 )
+        {
+            return false;
+        }
+
+        // size dependent targets live in the frame graph, which rebuilds
+        // them once passes declare them with the new extent
+        if( prepare_swapchain( p_vulInfo, p_context, p_context.framebuffer_size ) )
+        {
+            return true;
+        }
+
+        p_context.resize_pending = false;
+        return false;
+    }
+
+    void VGraphical::invalidateSwapchain( window & p_window )
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+        const bool t_renderThread = isRenderThread();
+
+        // called from a frame on the render thread glfw cannot be asked,
+        // the size the event thread handed over last still stands
+        glm::ivec2 t_size( -1, -1 );
+        if( !t_renderThread )
+        {
+            glfwGetFramebufferSize( p_window._GLFW_WindowHandle(), &t_size.x, &t_size.y );
+        }
+
+        // the render thread owns the contexts, hand the change over instead
+        if( vulInfo.render_thread_id.load() != std::thread::id() && !t_renderThread )
+        {
+            RenderCommand t_command;
+            t_command.handle = p_window._GLFW_WindowHandle();
+            t_command.policy = p_window.getPresentPolicy();
+            t_command.framebuffer_size = t_size;
+            if( !vulInfo.render_commands.push( t_command ) )
+            {
+                std::lock_guard< std::mutex > t_lock( vulInfo.render_sizes_mutex );
+                vulInfo.render_sizes[t_command.handle] = t_size;
+                vulInfo.render_resync = true;
+            }
+            return;
+        }
+
+        renderContext * t_context = find_context( vulInfo, &p_window );
+        if( t_context )
+        {
+            t_context->policy = p_window.getPresentPolicy();
+            t_context->resize_pending = true;
+            if( !t_renderThread )
+            {
+                t_context->framebuffer_size = t_size;
+            }
+        }
+    }
+
+    bool VGraphical::initWindow( window & p_window )
+    {
+        CPU_ZONE( "initWindow" );
+
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+        VkResult U_ASSERT_ONLY err;
+
+        if( vulInfo.headless )
+        {
+            LOG.error( "Swapchain Initialization Failure: graphical was initialized headless, use initOffscreen" );
+            return true;
+        }
+
+        if( find_context( vulInfo, &p_window ) )
+        {
+            LOG.error( "Swapchain Initialization Failure: window already has a render context" );
+            return true;
+        }
+
+        std::unique_lock< std::mutex > t_pause = pause_render_thread( vulInfo );
+
+        renderContext * t_context = new renderContext();
+        t_context->handle = p_window._GLFW_WindowHandle();
+        t_context->policy = p_window.getPresentPolicy();
+
+        // Create a WSI surface for the window:
+        err = glfwCreateWindowSurface( vulInfo.inst, t_context->handle, nullptr, &t_context->surface );
+        if( err )
+        {
+            LOG.error( "Swapchain Initialization Failure: glfwCreateWindowSurface returned {0}", (int)err );
+            delete t_context;
+            return true;
+        }
+
+        // the surface only needed the instance, from here on the device has to exist
+        if( wait_device( vulInfo ) )
+        {
+            LOG.error( "Swapchain Initialization Failure: device creation failed" );
+            vkDestroySurfaceKHR( vulInfo.inst, t_context->surface, nullptr );
+            delete t_context;
+            return true;
+        }
+
+        // Every window shares the single graphics queue created with the
+        // device, so it has to be able to present to this surface too.
+        VkBool32 supportsPresent = VK_FALSE;
+        vulInfo.fpGetPhysicalDeviceSurfaceSupportKHR( vulInfo.gpu, vulInfo.graphics_queue_node_index, t_context->surface, &supportsPresent );
+        if( supportsPresent != VK_TRUE )
+        {
+            LOG.error("Swapchain Initialization Failure: the device queue family cannot present to this window");
+            vkDestroySurfaceKHR( vulInfo.inst, t_context->surface, nullptr );
+            delete t_context;
+            return true;
+        }
+
+        // Get the list of VkFormat's that are supported:
+        uint32_t formatCount;
+        err = vulInfo.fpGetPhysicalDeviceSurfaceFormatsKHR(vulInfo.gpu, t_context->surface, &formatCount, nullptr);
+        assert(!err);
+
+        VkSurfaceFormatKHR *surfFormats = (VkSurfaceFormatKHR *)malloc(formatCount * sizeof(VkSurfaceFormatKHR));
+        err = vulInfo.fpGetPhysicalDeviceSurfaceFormatsKHR(vulInfo.gpu, t_context->surface, &formatCount, surfFormats);
+        assert(!err);
+
+        // If the format list includes just one entry of VK_FORMAT_UNDEFINED,
+        // the surface has no preferred format.  Otherwise, at least one
+        // supported format will be returned.
+        if (formatCount == 1 && surfFormats[0].format == VK_FORMAT_UNDEFINED) {
+            t_context->format = VK_FORMAT_B8G8R8A8_UNORM;
+        } else {
+            assert(formatCount >= 1);
+            t_context->format = surfFormats[0].format;
+        }
+
+        t_context->color_space = surfFormats[0].colorSpace;
+        free(surfFormats);
+
+        // the surface is sized in pixels, which is not the window size on hidpi displays
+        glfwGetFramebufferSize( t_context->handle, &t_context->framebuffer_size.x, &t_context->framebuffer_size.y );
+
+        // published only once complete, a failed attempt leaves the window
+        // free to try again
+        t_context->frame_count = vulInfo.frame_count;
+        if( prepare_swapchain( vulInfo, *t_context, t_context->framebuffer_size )
+            || prepare_frames( vulInfo, *t_context ) )
+        {
+            destroy_window_context( vulInfo, t_context );
+            return true;
+        }
+
+        {
+            std::lock_guard< std::mutex > t_lock( vulInfo.contexts_mutex );
+            vulInfo.contexts[t_context->handle] = t_context;
+        }
+
+        return false;
+    }
+
+    void destroy_window_context( vulkanInfo & p_vulInfo, renderContext * p_context )
+    {
+        // unpublished first, so no lookup finds it half torn down
+        {
+            std::lock_guard< std::mutex > t_lock( p_vulInfo.contexts_mutex );
+            p_vulInfo.contexts.erase( p_context->handle );
+        }
+
+        // waits on the context's own fences only, other windows keep running
+        destroy_frames( p_vulInfo, *p_context );
+        // old swapchains must go before the surface they were created for
+        p_vulInfo.retired.release( p_context );
+        destroy_swapchain_views( p_vulInfo, *p_context );
+
+        if( p_context->swapchain != VK_NULL_HANDLE )
+        {
+            vkd.DestroySwapchainKHR( p_vulInfo.device, p_context->swapchain, nullptr );
+        }
+        vkDestroySurfaceKHR( p_vulInfo.inst, p_context->surface, nullptr );
+
+        delete p_context;
+    }
+
+    void VGraphical::destroyWindow( window & p_window )
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+
+        std::unique_lock< std::mutex > t_pause = pause_render_thread( vulInfo );
+
+        renderContext * t_context = find_context( vulInfo, &p_window );
+        if( !t_context )
+        {
+            return;
+        }
+
+        destroy_window_context( vulInfo, t_context );
+    }
+}
@@ -0,0 +1,157 @@
+#include "vulkanInfo.h"
+#include "VGraphical.h"
+#include "window.h"
+#include "log.hpp"
+#include "cpuProfiler.h"
+
+namespace ROOT_SPACE
+{
+    // empty when there is no render thread or we are on it; otherwise
+    // returns once the frame in progress is done and keeps the thread
+    // parked until the lock is released
+    std::unique_lock< std::mutex > pause_render_thread( vulkanInfo & p_vulInfo )
+    {
+        const std::thread::id t_renderThread = p_vulInfo.render_thread_id.load();
+        if( t_renderThread == std::thread::id() || std::this_thread::get_id() == t_renderThread )
+        {
+            return std::unique_lock< std::mutex >();
+        }
+
+        p_vulInfo.render_pauses.fetch_add( 1 );
+        std::unique_lock< std::mutex > t_lock( p_vulInfo.render_mutex );
+        p_vulInfo.render_pauses.fetch_sub( 1 );
+        // it wakes once t_lock is released
+        p_vulInfo.render_resume.notify_all();
+
+        // whoever holds render_mutex is the queue's consumer, drain it so
+        // nothing queued refers to a context about to change
+        apply_render_commands( p_vulInfo );
+        return t_lock;
+    }
+
+    // caller holds render_mutex
+    void apply_render_commands( vulkanInfo & p_vulInfo )
+    {
+        RenderCommand t_command;
+        while( p_vulInfo.render_commands.pop( t_command ) )
+        {
+            std::map< GLFWwindow *, renderContext * >::iterator t_it = p_vulInfo.contexts.find( t_command.handle );
+            if( t_it != p_vulInfo.contexts.end() )
+            {
+                t_it->second->policy = t_command.policy;
+                t_it->second->resize_pending = true;
+                if( t_command.framebuffer_size.x >= 0 )
+                {
+                    t_it->second->framebuffer_size = t_command.framebuffer_size;
+                }
+            }
+        }
+
+        // the queue overflowed at some point, resync every window from
+        // its current state
+        if( p_vulInfo.render_resync.exchange( false ) )
+        {
+            std::lock_guard< std::mutex > t_sizes( p_vulInfo.render_sizes_mutex );
+            for( std::map< GLFWwindow *, renderContext * >::iterator t_it = p_vulInfo.contexts.begin(); t_it != p_vulInfo.contexts.end(); ++t_it )
+            {
+                window * t_window = (window *)glfwGetWindowUserPointer( t_it->first );
+                if( t_window )
+                {
+                    t_it->second->policy = t_window->getPresentPolicy();
+                }
+                std::map< GLFWwindow *, glm::ivec2 >::iterator t_size = p_vulInfo.render_sizes.find( t_it->first );
+                if( t_size != p_vulInfo.render_sizes.end() && t_size->second.x >= 0 )
+                {
+                    t_it->second->framebuffer_size = t_size->second;
+                }
+                t_it->second->resize_pending = true;
+            }
+            p_vulInfo.render_sizes.clear();
+        }
+    }
+
+    static void render_thread_main( vulkanInfo * p_vulInfo, std::function< bool( void ) > p_frame )
+    {
+        while( !p_vulInfo->render_quit.load( std::memory_order_acquire ) )
+        {
+            std::unique_lock< std::mutex > t_lock( p_vulInfo->render_mutex );
+
+            // std::mutex is not fair, waiting here is what lets a pausing
+            // thread in between two frames
+            p_vulInfo->render_resume.wait( t_lock, [p_vulInfo](void)
+            {
+                return p_vulInfo->render_pauses.load() == 0 || p_vulInfo->render_quit.load();
+            } );
+            if( p_vulInfo->render_quit.load( std::memory_order_acquire ) )
+            {
+                break;
+            }
+
+            apply_render_commands( *p_vulInfo );
+
+            if( p_frame() )
+            {
+                break;
+            }
+        }
+    }
+
+    bool VGraphical::startRenderThread( const std::function< bool( void ) > & p_frame )
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+
+        if( vulInfo.render_thread.joinable() )
+        {
+            LOG.error( "startRenderThread Failure: a render thread is already running" );
+            return true;
+        }
+
+        if( wait_device( vulInfo ) )
+        {
+            LOG.error( "startRenderThread Failure: device creation failed" );
+            return true;
+        }
+
+        vulInfo.render_quit = false;
+        vulInfo.render_resync = false;
+
+        // the first frame waits for render_mutex, so the thread knows
+        // itself before it runs any
+        std::lock_guard< std::mutex > t_lock( vulInfo.render_mutex );
+        vulInfo.render_thread = std::thread( render_thread_main, &vulInfo, p_frame );
+        vulInfo.render_thread_id.store( vulInfo.render_thread.get_id() );
+
+        return false;
+    }
+
+    void VGraphical::stopRenderThread(void)
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+
+        if( !vulInfo.render_thread.joinable() )
+        {
+            return;
+        }
+
+        {
+            // under the lock, so the wakeup cannot fall between the render
+            // thread's check and its wait
+            std::lock_guard< std::mutex > t_lock( vulInfo.render_mutex );
+            vulInfo.render_quit = true;
+        }
+        vulInfo.render_resume.notify_all();
+        vulInfo.render_thread.join();
+        vulInfo.render_thread_id.store( std::thread::id() );
+
+        // anything still queued is applied on this thread from now on
+        std::lock_guard< std::mutex > t_lock( vulInfo.render_mutex );
+        apply_render_commands( vulInfo );
+    }
+
+    bool VGraphical::isRenderThread(void)
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+        const std::thread::id t_renderThread = vulInfo.render_thread_id.load();
+        return t_renderThread != std::thread::id() && std::this_thread::get_id() == t_renderThread;
+    }
+}
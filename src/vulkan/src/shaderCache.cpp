@@ -0,0 +1,467 @@
+#include "shaderCache.h"
+#include "vulkanInfo.h"
+#include "VGraphical.h"
+#include "log.hpp"
+#include "cpuProfiler.h"
+#include <cassert>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using ROOT_SPACE::ShaderHandle;
+using ROOT_SPACE::ShaderStatus;
+using ROOT_SPACE::jobSystem;
+
+#define SPIRV_MAGIC 0x07230203u
+
+// size and modification time, false if the file is gone
+static bool file_stamp( const std::string & p_path, int64_t & p_mtime, int64_t & p_size )
+{
+    struct stat t_stat;
+    if( stat( p_path.c_str(), &t_stat ) != 0 )
+    {
+        return false;
+    }
+
+#if defined(__linux__)
+    p_mtime = (int64_t)t_stat.st_mtim.tv_sec * 1000000000 + t_stat.st_mtim.tv_nsec;
+#else
+    p_mtime = (int64_t)t_stat.st_mtime;
+#endif
+    p_size = (int64_t)t_stat.st_size;
+    return true;
+}
+
+shaderCache::shaderCache(void)
+{
+    mDevice = VK_NULL_HANDLE;
+    mWatchQuit = false;
+    mInterval = 250;
+}
+
+bool shaderCache::init( VkDevice p_device, const ChangedFunc & p_changed )
+{
+    std::lock_guard< std::mutex > t_lock( mMutex );
+
+    mDevice = p_device;
+    mChanged = p_changed;
+
+    // shaders asked for before the device existed
+    for( size_t i = 0; i < mShaders.size(); ++i )
+    {
+        if( !mShaders[i].loading )
+        {
+            queue( (ShaderHandle)i );
+        }
+    }
+    return false;
+}
+
+void shaderCache::destroy(void)
+{
+    watch( false, mInterval );
+    wait();
+
+    std::lock_guard< std::mutex > t_lock( mMutex );
+
+    for( std::map< uint64_t, Module >::iterator t_it = mModules.begin(); t_it != mModules.end(); ++t_it )
+    {
+        vkd.DestroyShaderModule( mDevice, t_it->second.module, nullptr );
+    }
+    mModules.clear();
+    mHashes.clear();
+    mShaders.clear();
+    mPaths.clear();
+    mJobs.clear();
+    mDevice = VK_NULL_HANDLE;
+}
+
+ShaderHandle shaderCache::load( const std::string & p_path )
+{
+    std::lock_guard< std::mutex > t_lock( mMutex );
+
+    std::map< std::string, ShaderHandle >::iterator t_found = mPaths.find( p_path );
+    if( t_found != mPaths.end() )
+    {
+        return t_found->second;
+    }
+
+    Shader t_shader;
+    t_shader.path = p_path;
+    t_shader.module = VK_NULL_HANDLE;
+    t_shader.hash = 0;
+    t_shader.status = ShaderStatus::Pending;
+    t_shader.loading = false;
+    t_shader.mtime = 0;
+    t_shader.size = 0;
+
+    const ShaderHandle t_handle = (ShaderHandle)mShaders.size();
+    mShaders.push_back( t_shader );
+    mPaths[p_path] = t_handle;
+
+    // without a device init queues it
+    if( mDevice != VK_NULL_HANDLE )
+    {
+        queue( t_handle );
+    }
+    return t_handle;
+}
+
+ShaderStatus shaderCache::status( ShaderHandle p_shader )
+{
+    std::lock_guard< std::mutex > t_lock( mMutex );
+    return p_shader < mShaders.size() ? mShaders[p_shader].status : ShaderStatus::Failed;
+}
+
+VkShaderModule shaderCache::acquire( ShaderHandle p_shader )
+{
+    std::lock_guard< std::mutex > t_lock( mMutex );
+
+    if( p_shader >= mShaders.size() || mShaders[p_shader].module == VK_NULL_HANDLE )
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    return share( mShaders[p_shader].hash );
+}
+
+void shaderCache::release( VkShaderModule p_module )
+{
+    if( p_module == VK_NULL_HANDLE )
+    {
+        return;
+    }
+
+    std::lock_guard< std::mutex > t_lock( mMutex );
+    drop( p_module );
+}
+
+VkShaderModule shaderCache::share( uint64_t p_hash )
+{
+    std::map< uint64_t, Module >::iterator t_found = mModules.find( p_hash );
+    if( t_found == mModules.end() )
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    ++t_found->second.refs;
+    return t_found->second.module;
+}
+
+void shaderCache::drop( VkShaderModule p_module )
+{
+    std::map< VkShaderModule, uint64_t >::iterator t_hash = mHashes.find( p_module );
+    if( t_hash == mHashes.end() )
+    {
+        return;
+    }
+
+    // pipelines keep what they need, modules can go as soon as nobody compiles with them
+    Module & t_module = mModules[t_hash->second];
+    if( --t_module.refs == 0 )
+    {
+        vkd.DestroyShaderModule( mDevice, t_module.module, nullptr );
+        mModules.erase( t_hash->second );
+        mHashes.erase( t_hash );
+    }
+}
+
+void shaderCache::queue( ShaderHandle p_shader )
+{
+    mShaders[p_shader].loading = true;
+
+    mJobs.erase( std::remove_if( mJobs.begin(), mJobs.end(), jobSystem::isFinished ), mJobs.end() );
+    mJobs.push_back( jobSystem::run( [this, p_shader](void) { reload( p_shader ); } ) );
+}
+
+void shaderCache::reload( ShaderHandle p_shader )
+{
+    CPU_ZONE( "load shader" );
+
+    std::string t_path;
+    {
+        std::lock_guard< std::mutex > t_lock( mMutex );
+        t_path = mShaders[p_shader].path;
+    }
+
+    // stamped before reading, a write racing the read is caught by the next poll
+    int64_t t_mtime = 0;
+    int64_t t_size = 0;
+    file_stamp( t_path, t_mtime, t_size );
+
+    const void * t_data = nullptr;
+    size_t t_length = 0;
+
+#ifdef _WIN32
+    HANDLE t_file = CreateFileA( t_path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+    HANDLE t_mapping = nullptr;
+    if( t_file != INVALID_HANDLE_VALUE )
+    {
+        LARGE_INTEGER t_fileSize;
+        if( GetFileSizeEx( t_file, &t_fileSize ) && t_fileSize.QuadPart > 0 )
+        {
+            t_mapping = CreateFileMappingA( t_file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+            if( t_mapping )
+            {
+                t_data = MapViewOfFile( t_mapping, FILE_MAP_READ, 0, 0, 0 );
+                t_length = t_data ? (size_t)t_fileSize.QuadPart : 0;
+            }
+        }
+    }
+#else
+    int t_file = open( t_path.c_str(), O_RDONLY );
+    if( t_file >= 0 )
+    {
+        struct stat t_stat;
+        if( fstat( t_file, &t_stat ) == 0 && t_stat.st_size > 0 )
+        {
+            void * t_map = mmap( nullptr, (size_t)t_stat.st_size, PROT_READ, MAP_PRIVATE, t_file, 0 );
+            if( t_map != MAP_FAILED )
+            {
+                t_data = t_map;
+                t_length = (size_t)t_stat.st_size;
+            }
+        }
+    }
+#endif
+
+    // mappings are page aligned, so the words can be read in place
+    const bool t_valid = t_data && t_length >= 20 && t_length % 4 == 0 && *(const uint32_t *)t_data == SPIRV_MAGIC;
+
+    uint64_t t_hash = 14695981039346656037ull;
+    for( size_t i = 0; t_valid && i < t_length; ++i )
+    {
+        t_hash = ( t_hash ^ ( (const uint8_t *)t_data )[i] ) * 1099511628211ull;
+    }
+
+    VkShaderModule t_module = VK_NULL_HANDLE;
+    bool t_unchanged = false;
+    if( t_valid )
+    {
+        std::lock_guard< std::mutex > t_lock( mMutex );
+        t_unchanged = mShaders[p_shader].module != VK_NULL_HANDLE && mShaders[p_shader].hash == t_hash;
+        if( !t_unchanged )
+        {
+            t_module = share( t_hash );
+        }
+    }
+
+    VkResult err = VK_SUCCESS;
+    if( t_valid && !t_unchanged && t_module == VK_NULL_HANDLE )
+    {
+        VkShaderModuleCreateInfo t_info = {};
+        t_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        t_info.codeSize = t_length;
+        t_info.pCode = (const uint32_t *)t_data;
+
+        err = vkd.CreateShaderModule( mDevice, &t_info, nullptr, &t_module );
+        if( err )
+        {
+            t_module = VK_NULL_HANDLE;
+        }
+    }
+
+#ifdef _WIN32
+    if( t_data ) UnmapViewOfFile( t_data );
+    if( t_mapping ) CloseHandle( t_mapping );
+    if( t_file != INVALID_HANDLE_VALUE ) CloseHandle( t_file );
+#else
+    if( t_data ) munmap( (void *)t_data, t_length );
+    if( t_file >= 0 ) close( t_file );
+#endif
+
+    {
+        std::lock_guard< std::mutex > t_lock( mMutex );
+        Shader & t_shader = mShaders[p_shader];
+        t_shader.loading = false;
+        t_shader.mtime = t_mtime;
+        t_shader.size = t_size;
+
+        if( t_unchanged )
+        {
+            return;
+        }
+
+        if( t_module == VK_NULL_HANDLE )
+        {
+            // a broken edit keeps the module that worked
+            if( !t_valid )
+            {
+                LOG.error( "shaderCache Failure: {0} is missing or not SPIR-V", t_path );
+            }else
+            {
+                LOG.error( "shaderCache Failure: vkCreateShaderModule returned {0} for {1}", (int)err, t_path );
+            }
+            if( t_shader.status == ShaderStatus::Pending )
+            {
+                t_shader.status = ShaderStatus::Failed;
+            }
+            return;
+        }
+
+        // a load of the same bytecode may have won the race
+        if( mHashes.find( t_module ) == mHashes.end() )
+        {
+            VkShaderModule t_shared = share( t_hash );
+            if( t_shared != VK_NULL_HANDLE )
+            {
+                vkd.DestroyShaderModule( mDevice, t_module, nullptr );
+                t_module = t_shared;
+            }else
+            {
+                Module t_new = { t_module, 1 };
+                mModules[t_hash] = t_new;
+                mHashes[t_module] = t_hash;
+            }
+        }
+
+        if( t_shader.module != VK_NULL_HANDLE )
+        {
+            drop( t_shader.module );
+            LOG.info( "shader {0} reloaded", t_path );
+        }
+        t_shader.module = t_module;
+        t_shader.hash = t_hash;
+        t_shader.status = ShaderStatus::Ready;
+    }
+
+    if( mChanged )
+    {
+        mChanged( p_shader );
+    }
+}
+
+void shaderCache::wait(void)
+{
+    for( ;; )
+    {
+        std::vector< jobSystem::JobHandle > t_jobs;
+        {
+            std::lock_guard< std::mutex > t_lock( mMutex );
+            mJobs.erase( std::remove_if( mJobs.begin(), mJobs.end(), jobSystem::isFinished ), mJobs.end() );
+            if( mJobs.empty() )
+            {
+                return;
+            }
+            t_jobs = mJobs;
+        }
+
+        for( size_t i = 0; i < t_jobs.size(); ++i )
+        {
+            jobSystem::wait( t_jobs[i] );
+        }
+    }
+}
+
+void shaderCache::poll(void)
+{
+    struct Stamp
+    {
+        ShaderHandle shader;
+        std::string path;
+        int64_t mtime;
+        int64_t size;
+    };
+
+    // the stats run without the lock, loads and lookups carry on meanwhile
+    std::vector< Stamp > t_stamps;
+    {
+        std::lock_guard< std::mutex > t_lock( mMutex );
+        for( size_t i = 0; i < mShaders.size(); ++i )
+        {
+            if( !mShaders[i].loading )
+            {
+                Stamp t_stamp = { (ShaderHandle)i, mShaders[i].path, mShaders[i].mtime, mShaders[i].size };
+                t_stamps.push_back( t_stamp );
+            }
+        }
+    }
+
+    for( size_t i = 0; i < t_stamps.size(); ++i )
+    {
+        int64_t t_mtime;
+        int64_t t_size;
+        if( !file_stamp( t_stamps[i].path, t_mtime, t_size ) )
+        {
+            // editors often replace files, it may be back next time
+            continue;
+        }
+        if( t_mtime == t_stamps[i].mtime && t_size == t_stamps[i].size )
+        {
+            continue;
+        }
+
+        std::lock_guard< std::mutex > t_lock( mMutex );
+        if( mDevice != VK_NULL_HANDLE && !mShaders[t_stamps[i].shader].loading )
+        {
+            queue( t_stamps[i].shader );
+        }
+    }
+}
+
+void shaderCache::watcherMain(void)
+{
+    std::unique_lock< std::mutex > t_lock( mWatchMutex );
+    while( !mWatchQuit )
+    {
+        mWatchWake.wait_for( t_lock, std::chrono::milliseconds( mInterval ) );
+        if( mWatchQuit )
+        {
+            break;
+        }
+
+        t_lock.unlock();
+        poll();
+        t_lock.lock();
+    }
+}
+
+void shaderCache::watch( bool p_enable, uint32_t p_intervalMs )
+{
+    {
+        std::lock_guard< std::mutex > t_lock( mWatchMutex );
+        mInterval = std::max< uint32_t >( 1, p_intervalMs );
+        if( p_enable == mWatcher.joinable() )
+        {
+            return;
+        }
+        mWatchQuit = !p_enable;
+    }
+
+    if( p_enable )
+    {
+        mWatcher = std::thread( &shaderCache::watcherMain, this );
+        return;
+    }
+
+    mWatchWake.notify_all();
+    mWatcher.join();
+}
+
+namespace ROOT_SPACE
+{
+    ShaderHandle VGraphical::loadShader( const std::string & p_path )
+    {
+        return vulkanInfo::instance.shaders.load( p_path );
+    }
+
+    ShaderStatus VGraphical::getShaderStatus( const ShaderHandle p_shader )
+    {
+        return vulkanInfo::instance.shaders.status( p_shader );
+    }
+
+    void VGraphical::setShaderHotReload( const bool p_enable )
+    {
+        // polls without a device only look, loads wait for create_device
+        vulkanInfo::instance.shaders.watch( p_enable, DEFAULT_SHADER_POLL_MS );
+    }
+}
@@ -0,0 +1,465 @@
+#include "stagingRing.h"
+#include "vulkanInfo.h"
+#include "VGraphical.h"
+#include "log.hpp"
+#include "cpuProfiler.h"
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+static inline VkDeviceSize align_up( VkDeviceSize p_value, VkDeviceSize p_alignment )
+{
+    return p_alignment > 1 ? ( p_value + p_alignment - 1 ) / p_alignment * p_alignment : p_value;
+}
+
+static VkDeviceSize least_common_multiple( VkDeviceSize p_a, VkDeviceSize p_b )
+{
+    VkDeviceSize t_x = p_a;
+    VkDeviceSize t_y = p_b;
+    while( t_y )
+    {
+        const VkDeviceSize t_r = t_x % t_y;
+        t_x = t_y;
+        t_y = t_r;
+    }
+    return p_a / t_x * p_b;
+}
+
+// bytes of one texel, or one block for compressed formats, as a buffer to
+// image copy of p_aspect lays it out; 0 for formats the ring does not know
+static VkDeviceSize texel_block_bytes( VkFormat p_format, VkImageAspectFlags p_aspect )
+{
+    const int f = (int)p_format;
+
+    if( f >= VK_FORMAT_D16_UNORM && f <= VK_FORMAT_D32_SFLOAT_S8_UINT )
+    {
+        // depth and stencil aspects are copied apart, stencil as one byte
+        if( ( p_aspect & VK_IMAGE_ASPECT_STENCIL_BIT ) || f == VK_FORMAT_S8_UINT )
+        {
+            return 1;
+        }
+        return f == VK_FORMAT_D16_UNORM || f == VK_FORMAT_D16_UNORM_S8_UINT ? 2 : 4;
+    }
+
+    struct Range { int first; int last; VkDeviceSize bytes; };
+    static const Range ranges[] = {
+        { VK_FORMAT_R4G4_UNORM_PACK8, VK_FORMAT_R4G4_UNORM_PACK8, 1 },
+        { VK_FORMAT_R4G4B4A4_UNORM_PACK16, VK_FORMAT_A1R5G5B5_UNORM_PACK16, 2 },
+        { VK_FORMAT_R8_UNORM, VK_FORMAT_R8_SRGB, 1 },
+        { VK_FORMAT_R8G8_UNORM, VK_FORMAT_R8G8_SRGB, 2 },
+        { VK_FORMAT_R8G8B8_UNORM, VK_FORMAT_B8G8R8_SRGB, 3 },
+        { VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_A2B10G10R10_SINT_PACK32, 4 },
+        { VK_FORMAT_R16_UNORM, VK_FORMAT_R16_SFLOAT, 2 },
+        { VK_FORMAT_R16G16_UNORM, VK_FORMAT_R16G16_SFLOAT, 4 },
+        { VK_FORMAT_R16G16B16_UNORM, VK_FORMAT_R16G16B16_SFLOAT, 6 },
+        { VK_FORMAT_R16G16B16A16_UNORM, VK_FORMAT_R16G16B16A16_SFLOAT, 8 },
+        { VK_FORMAT_R32_UINT, VK_FORMAT_R32_SFLOAT, 4 },
+        { VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32_SFLOAT, 8 },
+        { VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32_SFLOAT, 12 },
+        { VK_FORMAT_R32G32B32A32_UINT, VK_FORMAT_R32G32B32A32_SFLOAT, 16 },
+        { VK_FORMAT_R64_UINT, VK_FORMAT_R64_SFLOAT, 8 },
+        { VK_FORMAT_R64G64_UINT, VK_FORMAT_R64G64_SFLOAT, 16 },
+        { VK_FORMAT_R64G64B64_UINT, VK_FORMAT_R64G64B64_SFLOAT, 24 },
+        { VK_FORMAT_R64G64B64A64_UINT, VK_FORMAT_R64G64B64A64_SFLOAT, 32 },
+        { VK_FORMAT_B10G11R11_UFLOAT_PACK32, VK_FORMAT_E5B9G9R9_UFLOAT_PACK32, 4 },
+        { VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_BC1_RGBA_SRGB_BLOCK, 8 },
+        { VK_FORMAT_BC2_UNORM_BLOCK, VK_FORMAT_BC3_SRGB_BLOCK, 16 },
+        { VK_FORMAT_BC4_UNORM_BLOCK, VK_FORMAT_BC4_SNORM_BLOCK, 8 },
+        { VK_FORMAT_BC5_UNORM_BLOCK, VK_FORMAT_BC7_SRGB_BLOCK, 16 },
+        { VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK, VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK, 8 },
+        { VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK, 16 },
+        { VK_FORMAT_EAC_R11_UNORM_BLOCK, VK_FORMAT_EAC_R11_SNORM_BLOCK, 8 },
+        { VK_FORMAT_EAC_R11G11_UNORM_BLOCK, VK_FORMAT_ASTC_12x12_SRGB_BLOCK, 16 },
+    };
+
+    for( size_t i = 0; i < sizeof( ranges ) / sizeof( ranges[0] ); ++i )
+    {
+        if( f >= ranges[i].first && f <= ranges[i].last )
+        {
+            return ranges[i].bytes;
+        }
+    }
+    return 0;
+}
+
+static bool same_subresource( const VkBufferImageCopy & p_a, const VkBufferImageCopy & p_b )
+{
+    return p_a.imageSubresource.aspectMask == p_b.imageSubresource.aspectMask
+        && p_a.imageSubresource.mipLevel == p_b.imageSubresource.mipLevel
+        && p_a.imageSubresource.baseArrayLayer == p_b.imageSubresource.baseArrayLayer
+        && p_a.imageSubresource.layerCount == p_b.imageSubresource.layerCount;
+}
+
+stagingRing::stagingRing(void)
+{
+    mDevice = VK_NULL_HANDLE;
+    mAllocator = nullptr;
+    mBuffer = VK_NULL_HANDLE;
+    mMemory = MemoryAllocation();
+    mCoherent = true;
+    mAtomSize = 1;
+    mImageAlignment = 16;
+    mFrameBytes = 0;
+    mBegin = 0;
+    mHead = 0;
+    mOpen = false;
+    mWriting = 0;
+}
+
+bool stagingRing::init( VkDevice p_device, vulkanAllocator * p_allocator, const VkPhysicalDeviceMemoryProperties & p_memoryProperties,
+                        const VkPhysicalDeviceLimits & p_limits, uint32_t p_frameCount, VkDeviceSize p_frameBytes )
+{
+    VkResult U_ASSERT_ONLY err;
+
+    mDevice = p_device;
+    mAllocator = p_allocator;
+    mAtomSize = std::max< VkDeviceSize >( 1, p_limits.nonCoherentAtomSize );
+    // copies to images also want the offset on a texel block, uploadImage
+    // raises this to a common multiple with the format's block size
+    mImageAlignment = std::max< VkDeviceSize >( 16, p_limits.optimalBufferCopyOffsetAlignment );
+
+    // regions start on atom boundaries so each can be flushed on its own
+    mFrameBytes = align_up( p_frameBytes, mAtomSize );
+
+    VkBufferCreateInfo t_info = {};
+    t_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    t_info.size = mFrameBytes * p_frameCount;
+    t_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    t_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    err = vkd.CreateBuffer( mDevice, &t_info, nullptr, &mBuffer );
+    assert( !err );
+
+    VkMemoryRequirements t_reqs;
+    vkd.GetBufferMemoryRequirements( mDevice, mBuffer, &t_reqs );
+    t_reqs.alignment = std::max( t_reqs.alignment, mAtomSize );
+    t_reqs.size = align_up( t_reqs.size, mAtomSize );
+
+    // coherent memory when there is some, flushes cover the rest
+    if( mAllocator->alloc( t_reqs, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                            vulkanAllocator::Linear, mMemory ) )
+    {
+        LOG.error( "stagingRing Failure: no host visible memory for {0} bytes", (uint64_t)t_info.size );
+        vkd.DestroyBuffer( mDevice, mBuffer, nullptr );
+        mBuffer = VK_NULL_HANDLE;
+        return true;
+    }
+
+    err = vkd.BindBufferMemory( mDevice, mBuffer, mMemory.memory, mMemory.offset );
+    assert( !err );
+
+    mCoherent = ( p_memoryProperties.memoryTypes[mMemory.memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT ) != 0;
+    mOpen = false;
+    return false;
+}
+
+void stagingRing::destroy(void)
+{
+    std::unique_lock< std::mutex > t_lock( mMutex );
+    mOpen = false;
+    mWritten.wait( t_lock, [this]() { return mWriting == 0; } );
+
+    if( mBuffer != VK_NULL_HANDLE )
+    {
+        vkd.DestroyBuffer( mDevice, mBuffer, nullptr );
+        mAllocator->free( mMemory );
+        mBuffer = VK_NULL_HANDLE;
+    }
+
+    mBufferCopies.clear();
+    mImageCopies.clear();
+    mOpen = false;
+}
+
+void stagingRing::beginFrame( uint32_t p_frameSlot )
+{
+    std::lock_guard< std::mutex > t_lock( mMutex );
+
+    mBegin = mFrameBytes * p_frameSlot;
+    mHead = mBegin;
+    mBufferCopies.clear();
+    mImageCopies.clear();
+    mOpen = mBuffer != VK_NULL_HANDLE;
+}
+
+bool stagingRing::reserve( VkDeviceSize p_size, VkDeviceSize p_alignment, VkDeviceSize & p_offset )
+{
+    if( !mOpen )
+    {
+        LOG.error( "stagingRing Failure: uploads are only accepted between beginFrame and endFrame" );
+        return true;
+    }
+
+    const VkDeviceSize t_offset = mBegin + align_up( mHead - mBegin, p_alignment );
+    if( t_offset + p_size > mBegin + mFrameBytes )
+    {
+        LOG.error( "stagingRing Failure: {0} bytes do not fit, {1} of {2} used this frame", (uint64_t)p_size,
+                   (uint64_t)( mHead - mBegin ), (uint64_t)mFrameBytes );
+        return true;
+    }
+
+    mHead = t_offset + p_size;
+    p_offset = t_offset;
+    ++mWriting;
+    return false;
+}
+
+void stagingRing::written(void)
+{
+    std::lock_guard< std::mutex > t_lock( mMutex );
+    if( --mWriting == 0 )
+    {
+        mWritten.notify_all();
+    }
+}
+
+bool stagingRing::uploadBuffer( VkBuffer p_dst, VkDeviceSize p_offset, const void * p_data, VkDeviceSize p_size )
+{
+    if( p_size == 0 )
+    {
+        return false;
+    }
+
+    VkDeviceSize t_offset;
+    {
+        std::lock_guard< std::mutex > t_lock( mMutex );
+        if( reserve( p_size, 4, t_offset ) )
+        {
+            return true;
+        }
+
+        BufferCopy t_copy;
+        t_copy.dst = p_dst;
+        t_copy.region.srcOffset = t_offset;
+        t_copy.region.dstOffset = p_offset;
+        t_copy.region.size = p_size;
+        mBufferCopies.push_back( t_copy );
+    }
+
+    // the range is ours alone, the copy runs outside the lock
+    memcpy( (char *)mMemory.mapped + t_offset, p_data, (size_t)p_size );
+    written();
+    return false;
+}
+
+bool stagingRing::uploadImage( VkImage p_dst, VkFormat p_format, const VkBufferImageCopy & p_region, const void * p_data,
+                               VkDeviceSize p_size, VkImageLayout p_oldLayout, VkImageLayout p_newLayout )
+{
+    if( p_size == 0 )
+    {
+        return false;
+    }
+
+    // 3, 6, 12 and 24 byte texels do not divide the base alignment
+    const VkDeviceSize t_blockBytes = texel_block_bytes( p_format, p_region.imageSubresource.aspectMask );
+    if( t_blockBytes == 0 )
+    {
+        LOG.error( "stagingRing Failure: unknown texel size of format {0}", (int)p_format );
+        return true;
+    }
+    const VkDeviceSize t_alignment = least_common_multiple( mImageAlignment, t_blockBytes );
+
+    VkDeviceSize t_offset;
+    {
+        std::lock_guard< std::mutex > t_lock( mMutex );
+        if( reserve( p_size, t_alignment, t_offset ) )
+        {
+            return true;
+        }
+
+        ImageCopy t_copy;
+        t_copy.dst = p_dst;
+        t_copy.region = p_region;
+        t_copy.region.bufferOffset = t_offset;
+        t_copy.old_layout = p_oldLayout;
+        t_copy.new_layout = p_newLayout;
+        mImageCopies.push_back( t_copy );
+    }
+
+    memcpy( (char *)mMemory.mapped + t_offset, p_data, (size_t)p_size );
+    written();
+    return false;
+}
+
+bool stagingRing::empty(void)
+{
+    std::lock_guard< std::mutex > t_lock( mMutex );
+    return mBufferCopies.empty() && mImageCopies.empty();
+}
+
+void stagingRing::close(void)
+{
+    std::lock_guard< std::mutex > t_lock( mMutex );
+    mOpen = false;
+}
+
+void stagingRing::flush(void)
+{
+    if( mCoherent || mHead == mBegin )
+    {
+        return;
+    }
+
+    // the region is atom aligned within the allocation, rounding the end
+    // up never leaves it
+    VkMappedMemoryRange t_range = {};
+    t_range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    t_range.memory = mMemory.memory;
+    t_range.offset = mMemory.offset + mBegin;
+    t_range.size = std::min( align_up( mHead - mBegin, mAtomSize ), mFrameBytes );
+
+    VkResult U_ASSERT_ONLY err = vkd.FlushMappedMemoryRanges( mDevice, 1, &t_range );
+    assert( !err );
+}
+
+void stagingRing::record( VkCommandBuffer p_cmd )
+{
+    CPU_ZONE( "staging record" );
+
+    // closed first so nothing new is reserved, then the copies already
+    // under way finish before the region is flushed and recorded
+    std::unique_lock< std::mutex > t_lock( mMutex );
+    mOpen = false;
+    mWritten.wait( t_lock, [this]() { return mWriting == 0; } );
+
+    if( mBufferCopies.empty() && mImageCopies.empty() )
+    {
+        return;
+    }
+
+    flush();
+
+    // grouped by destination, in submission order within each
+    std::stable_sort( mBufferCopies.begin(), mBufferCopies.end(),
+                      []( const BufferCopy & p_a, const BufferCopy & p_b ) { return p_a.dst < p_b.dst; } );
+    std::stable_sort( mImageCopies.begin(), mImageCopies.end(),
+                      []( const ImageCopy & p_a, const ImageCopy & p_b ) { return p_a.dst < p_b.dst; } );
+
+    // earlier frames may still read what gets overwritten, and images move
+    // to TRANSFER_DST; every subresource is transitioned once
+    std::vector< VkImageMemoryBarrier > t_before;
+    std::vector< VkImageMemoryBarrier > t_after;
+    for( size_t i = 0; i < mImageCopies.size(); ++i )
+    {
+        const ImageCopy & t_copy = mImageCopies[i];
+
+        bool t_seen = false;
+        for( size_t j = i; j-- > 0 && mImageCopies[j].dst == t_copy.dst && !t_seen; )
+        {
+            t_seen = same_subresource( mImageCopies[j].region, t_copy.region );
+        }
+        if( t_seen )
+        {
+            continue;
+        }
+
+        VkImageMemoryBarrier t_barrier = {};
+        t_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        t_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        t_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        t_barrier.image = t_copy.dst;
+        t_barrier.subresourceRange.aspectMask = t_copy.region.imageSubresource.aspectMask;
+        t_barrier.subresourceRange.baseMipLevel = t_copy.region.imageSubresource.mipLevel;
+        t_barrier.subresourceRange.levelCount = 1;
+        t_barrier.subresourceRange.baseArrayLayer = t_copy.region.imageSubresource.baseArrayLayer;
+        t_barrier.subresourceRange.layerCount = t_copy.region.imageSubresource.layerCount;
+
+        // writes made in the old layout have to be available before the
+        // transition, nothing is kept when the contents are discarded
+        t_barrier.srcAccessMask = t_copy.old_layout == VK_IMAGE_LAYOUT_UNDEFINED ? 0 : VK_ACCESS_MEMORY_WRITE_BIT;
+        t_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        t_barrier.oldLayout = t_copy.old_layout;
+        t_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        t_before.push_back( t_barrier );
+
+        t_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        t_barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+        t_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        t_barrier.newLayout = t_copy.new_layout;
+        t_after.push_back( t_barrier );
+    }
+
+    vkd.CmdPipelineBarrier( p_cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                            0, nullptr, 0, nullptr, (uint32_t)t_before.size(), t_before.data() );
+
+    std::vector< VkBufferCopy > t_regions;
+    for( size_t i = 0; i < mBufferCopies.size(); )
+    {
+        const VkBuffer t_dst = mBufferCopies[i].dst;
+        t_regions.clear();
+
+        for( ; i < mBufferCopies.size() && mBufferCopies[i].dst == t_dst; ++i )
+        {
+            const VkBufferCopy & t_region = mBufferCopies[i].region;
+
+            // consecutive writes of a stream land in one region
+            if( !t_regions.empty() && t_regions.back().srcOffset + t_regions.back().size == t_region.srcOffset
+                && t_regions.back().dstOffset + t_regions.back().size == t_region.dstOffset )
+            {
+                t_regions.back().size += t_region.size;
+            }else
+            {
+                t_regions.push_back( t_region );
+            }
+        }
+
+        vkd.CmdCopyBuffer( p_cmd, mBuffer, t_dst, (uint32_t)t_regions.size(), t_regions.data() );
+    }
+
+    std::vector< VkBufferImageCopy > t_imageRegions;
+    for( size_t i = 0; i < mImageCopies.size(); )
+    {
+        const VkImage t_dst = mImageCopies[i].dst;
+        t_imageRegions.clear();
+
+        for( ; i < mImageCopies.size() && mImageCopies[i].dst == t_dst; ++i )
+        {
+            t_imageRegions.push_back( mImageCopies[i].region );
+        }
+
+        vkd.CmdCopyBufferToImage( p_cmd, mBuffer, t_dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                  (uint32_t)t_imageRegions.size(), t_imageRegions.data() );
+    }
+
+    // whatever is submitted after this may read the uploads
+    VkMemoryBarrier t_visible = {};
+    t_visible.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    t_visible.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    t_visible.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+    vkd.CmdPipelineBarrier( p_cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+                            1, &t_visible, 0, nullptr, (uint32_t)t_after.size(), t_after.data() );
+
+    mBufferCopies.clear();
+    mImageCopies.clear();
+}
+
+namespace ROOT_SPACE
+{
+    bool VGraphical::uploadBuffer( VkBuffer p_dst, const VkDeviceSize p_offset, const void * p_data, const VkDeviceSize p_size,
+                                   window * p_window )
+    {
+        renderContext * t_context = find_context( vulkanInfo::instance, p_window );
+        if( !t_context || !t_context->frames )
+        {
+            LOG.error( "uploadBuffer Failure: no render context for this target" );
+            return true;
+        }
+
+        return t_context->staging.uploadBuffer( p_dst, p_offset, p_data, p_size );
+    }
+
+    bool VGraphical::uploadImage( VkImage p_dst, const VkFormat p_format, const VkBufferImageCopy & p_region, const void * p_data,
+                                  const VkDeviceSize p_size, const VkImageLayout p_oldLayout, const VkImageLayout p_newLayout,
+                                  window * p_window )
+    {
+        renderContext * t_context = find_context( vulkanInfo::instance, p_window );
+        if( !t_context || !t_context->frames )
+        {
+            LOG.error( "uploadImage Failure: no render context for this target" );
+            return true;
+        }
+
+        return t_context->staging.uploadImage( p_dst, p_format, p_region, p_data, p_size, p_oldLayout, p_newLayout );
+    }
+}
@@ -0,0 +1,74 @@
+#include "vulkanInfo.h"
+#include "VGraphical.h"
+#include "log.hpp"
+#include "cpuProfiler.h"
+
+namespace ROOT_SPACE
+{
+    static double milliseconds_between( const std::chrono::steady_clock::time_point & p_from, const std::chrono::steady_clock::time_point & p_to )
+    {
+        return std::chrono::duration< double, std::milli >( p_to - p_from ).count();
+    }
+
+    startupScope::startupScope( vulkanInfo & p_vulInfo, const char * p_name, const bool p_background )
+        : mVulInfo( p_vulInfo ), mName( p_name ), mBackground( p_background ), mFailed( true )
+    {
+        mBegin = std::chrono::steady_clock::now();
+    }
+
+    startupScope::~startupScope(void)
+    {
+        const std::chrono::steady_clock::time_point t_end = std::chrono::steady_clock::now();
+
+        StartupPhase t_phase;
+        t_phase.name = mName;
+        t_phase.begin_ms = milliseconds_between( mVulInfo.startup_begin, mBegin );
+        t_phase.duration_ms = milliseconds_between( mBegin, t_end );
+        t_phase.background = mBackground;
+        t_phase.failed = mFailed;
+
+        // the phases double as cpu zones so startup shows up in the frame trace
+        if( cpuProfiler::isEnabled() )
+        {
+            cpuProfiler::record( mName,
+                                 (uint64_t)std::chrono::duration_cast< std::chrono::nanoseconds >( mBegin.time_since_epoch() ).count(),
+                                 (uint64_t)std::chrono::duration_cast< std::chrono::nanoseconds >( t_end.time_since_epoch() ).count() );
+        }
+
+        std::lock_guard< std::mutex > t_lock( mVulInfo.startup_mutex );
+        mVulInfo.startup_phases.push_back( t_phase );
+    }
+
+    void startupScope::done(void)
+    {
+        mFailed = false;
+    }
+
+    std::vector< StartupPhase > VGraphical::getStartupReport(void)
+    {
+        vulkanInfo & vulInfo = vulkanInfo::instance;
+
+        std::lock_guard< std::mutex > t_lock( vulInfo.startup_mutex );
+        return vulInfo.startup_phases;
+    }
+
+    void VGraphical::logStartupReport(void)
+    {
+        const std::vector< StartupPhase > t_phases = getStartupReport();
+
+        double t_end = 0.0;
+        for( size_t i = 0; i < t_phases.size(); ++i )
+        {
+            const StartupPhase & t_phase = t_phases[i];
+            LOG.info( "startup {0}: {1} ms at {2} ms{3}{4}", t_phase.name, t_phase.duration_ms, t_phase.begin_ms,
+                      t_phase.background ? " (background)" : "", t_phase.failed ? " FAILED" : "" );
+
+            if( t_phase.begin_ms + t_phase.duration_ms > t_end )
+            {
+                t_end = t_phase.begin_ms + t_phase.duration_ms;
+            }
+        }
+
+        LOG.info( "startup total: {0} ms", t_end );
+    }
+}
@@ -0,0 +1,195 @@
+#include "uniformRing.h"
+#include "vulkanInfo.h"
+#include "VGraphical.h"
+#include "log.hpp"
+#include <cassert>
+#include <algorithm>
+
+using ROOT_SPACE::UniformAllocation;
+
+static inline VkDeviceSize align_up( VkDeviceSize p_value, VkDeviceSize p_alignment )
+{
+    return p_alignment > 1 ? ( p_value + p_alignment - 1 ) / p_alignment * p_alignment : p_value;
+}
+
+uniformRing::uniformRing(void)
+    : mHead( 0 ), mOpen( false ), mOverflowed( false )
+{
+    mDevice = VK_NULL_HANDLE;
+    mAllocator = nullptr;
+    mBuffer = VK_NULL_HANDLE;
+    mMemory = MemoryAllocation();
+    mCoherent = true;
+    mAtomSize = 1;
+    mAlignment = 256;
+    mMaxRange = 16384;
+    mFrameBytes = 0;
+    mBegin = 0;
+}
+
+bool uniformRing::init( VkDevice p_device, vulkanAllocator * p_allocator, const VkPhysicalDeviceMemoryProperties & p_memoryProperties,
+                        const VkPhysicalDeviceLimits & p_limits, uint32_t p_frameCount, VkDeviceSize p_frameBytes )
+{
+    VkResult U_ASSERT_ONLY err;
+
+    mDevice = p_device;
+    mAllocator = p_allocator;
+    mAtomSize = std::max< VkDeviceSize >( 1, p_limits.nonCoherentAtomSize );
+    mAlignment = std::max< VkDeviceSize >( 1, p_limits.minUniformBufferOffsetAlignment );
+    mMaxRange = p_limits.maxUniformBufferRange;
+
+    // dynamic offsets are 32 bit, the whole ring has to stay below 4GiB
+    mFrameBytes = align_up( std::max( p_frameBytes, mAlignment ), std::max( mAlignment, mAtomSize ) );
+    if( mFrameBytes * p_frameCount > UINT32_MAX )
+    {
+        LOG.error( "uniformRing Failure: {0} frames of {1} bytes exceed 32 bit offsets", p_frameCount, (uint64_t)mFrameBytes );
+        return true;
+    }
+
+    VkBufferCreateInfo t_info = {};
+    t_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    t_info.size = mFrameBytes * p_frameCount;
+    t_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    t_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    err = vkd.CreateBuffer( mDevice, &t_info, nullptr, &mBuffer );
+    assert( !err );
+
+    VkMemoryRequirements t_reqs;
+    vkd.GetBufferMemoryRequirements( mDevice, mBuffer, &t_reqs );
+    t_reqs.alignment = std::max( t_reqs.alignment, mAtomSize );
+    t_reqs.size = align_up( t_reqs.size, mAtomSize );
+
+    // device local host visible memory saves the shaders a trip over the
+    // bus where the device has it
+    if( mAllocator->alloc( t_reqs, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                           vulkanAllocator::Linear, mMemory ) )
+    {
+        LOG.error( "uniformRing Failure: no host visible memory for {0} bytes", (uint64_t)t_info.size );
+        vkd.DestroyBuffer( mDevice, mBuffer, nullptr );
+        mBuffer = VK_NULL_HANDLE;
+        return true;
+    }
+
+    err = vkd.BindBufferMemory( mDevice, mBuffer, mMemory.memory, mMemory.offset );
+    assert( !err );
+
+    mCoherent = ( p_memoryProperties.memoryTypes[mMemory.memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT ) != 0;
+    mOpen = false;
+    return false;
+}
+
+void uniformRing::destroy(void)
+{
+    mOpen = false;
+
+    if( mBuffer != VK_NULL_HANDLE )
+    {
+        vkd.DestroyBuffer( mDevice, mBuffer, nullptr );
+        mAllocator->free( mMemory );
+        mBuffer = VK_NULL_HANDLE;
+    }
+}
+
+void uniformRing::beginFrame( uint32_t p_frameSlot )
+{
+    mBegin = mFrameBytes * p_frameSlot;
+    mHead.store( mBegin, std::memory_order_relaxed );
+    mOverflowed.store( false, std::memory_order_relaxed );
+    mOpen.store( mBuffer != VK_NULL_HANDLE, std::memory_order_release );
+}
+
+void uniformRing::endFrame(void)
+{
+    mOpen.store( false, std::memory_order_release );
+
+    const VkDeviceSize t_used = std::min( mHead.load( std::memory_order_acquire ), mBegin + mFrameBytes ) - mBegin;
+    if( mCoherent || t_used == 0 )
+    {
+        return;
+    }
+
+    // regions start on atom boundaries, rounding the end up stays inside
+    VkMappedMemoryRange t_range = {};
+    t_range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    t_range.memory = mMemory.memory;
+    t_range.offset = mMemory.offset + mBegin;
+    t_range.size = std::min( align_up( t_used, mAtomSize ), mFrameBytes );
+
+    VkResult U_ASSERT_ONLY err = vkd.FlushMappedMemoryRanges( mDevice, 1, &t_range );
+    assert( !err );
+}
+
+UniformAllocation uniformRing::alloc( uint32_t p_size )
+{
+    UniformAllocation t_allocation = { VK_NULL_HANDLE, 0, nullptr };
+
+    if( !mOpen.load( std::memory_order_acquire ) )
+    {
+        LOG.error( "uniformRing Failure: allocations are only possible between beginFrame and endFrame" );
+        return t_allocation;
+    }
+
+    if( p_size > mMaxRange )
+    {
+        LOG.error( "uniformRing Failure: {0} bytes exceed maxUniformBufferRange {1}", p_size, (uint64_t)mMaxRange );
+        return t_allocation;
+    }
+
+    // sizes are rounded to the alignment, so every offset stays aligned
+    const VkDeviceSize t_size = align_up( std::max< VkDeviceSize >( p_size, 1 ), mAlignment );
+    const VkDeviceSize t_offset = mHead.fetch_add( t_size, std::memory_order_relaxed );
+
+    if( t_offset + t_size > mBegin + mFrameBytes )
+    {
+        if( !mOverflowed.exchange( true ) )
+        {
+            LOG.error( "uniformRing Failure: the frame's {0} bytes are used up", (uint64_t)mFrameBytes );
+        }
+        return t_allocation;
+    }
+
+    t_allocation.buffer = mBuffer;
+    t_allocation.offset = (uint32_t)t_offset;
+    t_allocation.data = (char *)mMemory.mapped + t_offset;
+    return t_allocation;
+}
+
+VkBuffer uniformRing::buffer(void) const
+{
+    return mBuffer;
+}
+
+namespace ROOT_SPACE
+{
+    UniformAllocation VGraphical::allocUniform( const uint32_t p_size, window * p_window )
+    {
+        renderContext * t_context = find_context( vulkanInfo::instance, p_window );
+        if( !t_context || !t_context->frames )
+        {
+            UniformAllocation t_none = { VK_NULL_HANDLE, 0, nullptr };
+            LOG.error( "allocUniform Failure: no render context for this target" );
+            return t_none;
+        }
+
+        return t_context->uniforms.alloc( p_size );
+    }
+
+    VkBuffer VGraphical::getUniformBuffer( window * p_window )
+    {
+        renderContext * t_context = find_context( vulkanInfo::instance, p_window );
+        if( !t_context || !t_context->frames )
+        {
+            return VK_NULL_HANDLE;
+        }
+
+        return t_context->uniforms.buffer();
+    }
+
+    uint32_t VGraphical::getUniformAlignment(void)
+    {
+        wait_device( vulkanInfo::instance );
+        return (uint32_t)vulkanInfo::instance.gpu_props.limits.minUniformBufferOffsetAlignment;
+    }
+}
@@ -0,0 +1,456 @@
+#include "vulkanInfo.h"
+#include "log.hpp"
+#include <cassert>
+#include <algorithm>
+
+// large heaps are carved into blocks of this size, small ones into eighths
+#define ALLOCATOR_LARGE_HEAP_BLOCK_SIZE ( 256ull * 1024 * 1024 )
+#define ALLOCATOR_DEFAULT_BLOCK_SIZE ( 64ull * 1024 * 1024 )
+
+static inline VkDeviceSize align_up( VkDeviceSize p_value, VkDeviceSize p_alignment )
+{
+    return p_alignment > 1 ? ( p_value + p_alignment - 1 ) / p_alignment * p_alignment : p_value;
+}
+
+vulkanAllocator::vulkanAllocator(void)
+{
+    mDevice = VK_NULL_HANDLE;
+    mNonCoherentAtomSize = 1;
+    mDedicatedCount = 0;
+    mDedicatedBytes = 0;
+}
+
+bool vulkanAllocator::init( VkDevice p_device, const VkPhysicalDeviceMemoryProperties & p_memoryProperties,
+                            const VkPhysicalDeviceLimits & p_limits )
+{
+    mDevice = p_device;
+    mMemoryProperties = p_memoryProperties;
+    mNonCoherentAtomSize = p_limits.nonCoherentAtomSize > 0 ? p_limits.nonCoherentAtomSize : 1;
+    return false;
+}
+
+void vulkanAllocator::destroy(void)
+{
+    std::lock_guard< std::mutex > t_lock( mMutex );
+
+    for( uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; ++i )
+    {
+        for( uint32_t k = 0; k < KindCount; ++k )
+        {
+            for( size_t b = 0; b < mPools[i][k].size(); ++b )
+            {
+                if( mPools[i][k][b] )
+                {
+                    if( mPools[i][k][b]->allocations > 0 )
+                    {
+                        LOG.warning( "vulkanAllocator: destroying block with {0} live allocations", mPools[i][k][b]->allocations );
+                    }
+                    destroy_block( mPools[i][k][b] );
+                }
+            }
+            mPools[i][k].clear();
+        }
+    }
+
+    if( mDedicatedCount > 0 )
+    {
+        LOG.warning( "vulkanAllocator: {0} dedicated allocations leaked", mDedicatedCount );
+    }
+}
+
+bool vulkanAllocator::find_memory_type( uint32_t p_typeBits, VkMemoryPropertyFlags p_required,
+                                        VkMemoryPropertyFlags p_preferred, uint32_t & p_typeIndex ) const
+{
+    // first pass wants the preferred flags too, second settles for the required ones
+    for( uint32_t pass = 0; pass < 2; ++pass )
+    {
+        const VkMemoryPropertyFlags t_wanted = pass == 0 ? ( p_required | p_preferred ) : p_required;
+
+        for( uint32_t i = 0; i < mMemoryProperties.memoryTypeCount; ++i )
+        {
+            if( ( p_typeBits & ( 1u << i ) ) &&
+                ( mMemoryProperties.memoryTypes[i].propertyFlags & t_wanted ) == t_wanted )
+            {
+                p_typeIndex = i;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+VkDeviceSize vulkanAllocator::block_size_for( uint32_t p_typeIndex ) const
+{
+    const VkDeviceSize t_heapSize = mMemoryProperties.memoryHeaps[ mMemoryProperties.memoryTypes[p_typeIndex].heapIndex ].size;
+
+    if( t_heapSize >= 4ull * 1024 * 1024 * 1024 )
+    {
+        return ALLOCATOR_LARGE_HEAP_BLOCK_SIZE;
+    }
+
+    return std::min< VkDeviceSize >( ALLOCATOR_DEFAULT_BLOCK_SIZE, align_up( t_heapSize / 8, 1024 ) );
+}
+
+vulkanAllocator::Block * vulkanAllocator::create_block( uint32_t p_typeIndex, VkDeviceSize p_size )
+{
+    VkMemoryAllocateInfo mem_alloc = {};
+    mem_alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    mem_alloc.pNext = nullptr;
+    mem_alloc.allocationSize = p_size;
+    mem_alloc.memoryTypeIndex = p_typeIndex;
+
+    VkDeviceMemory t_memory;
+    VkResult err = vkd.AllocateMemory( mDevice, &mem_alloc, nullptr, &t_memory );
+    if( err )
+    {
+        LOG.error( "vulkanAllocator: vkAllocateMemory of {0} bytes failed with {1}", (uint64_t)p_size, (int)err );
+        return nullptr;
+    }
+
+    void * t_mapped = nullptr;
+    if( mMemoryProperties.memoryTypes[p_typeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT )
+    {
+        err = vkd.MapMemory( mDevice, t_memory, 0, VK_WHOLE_SIZE, 0, &t_mapped );
+        if( err )
+        {
+            LOG.error( "vulkanAllocator: vkMapMemory failed with {0}", (int)err );
+            vkd.FreeMemory( mDevice, t_memory, nullptr );
+            return nullptr;
+        }
+    }
+
+    Block * t_block = new Block();
+    t_block->memory = t_memory;
+    t_block->size = p_size;
+    t_block->used = 0;
+    t_block->mapped = t_mapped;
+    t_block->allocations = 0;
+    Range t_all = { 0, p_size };
+    t_block->free_ranges.push_back( t_all );
+    return t_block;
+}
+
+void vulkanAllocator::destroy_block( Block * p_block )
+{
+    if( p_block->mapped )
+    {
+        vkd.UnmapMemory( mDevice, p_block->memory );
+    }
+    vkd.FreeMemory( mDevice, p_block->memory, nullptr );
+    delete p_block;
+}
+
+bool vulkanAllocator::alloc_from_block( Block & p_block, VkDeviceSize p_size, VkDeviceSize p_alignment, VkDeviceSize & p_offset )
+{
+    for( size_t i = 0; i < p_block.free_ranges.size(); ++i )
+    {
+        const Range t_range = p_block.free_ranges[i];
+        const VkDeviceSize t_offset = align_up( t_range.offset, p_alignment );
+        const VkDeviceSize t_end = t_range.offset + t_range.size;
+
+        if( t_offset + p_size > t_end )
+        {
+            continue;
+        }
+
+        // the alignment padding in front stays a free range of its own
+        p_block.free_ranges.erase( p_block.free_ranges.begin() + i );
+        if( t_offset + p_size < t_end )
+        {
+            Range t_back = { t_offset + p_size, t_end - ( t_offset + p_size ) };
+            p_block.free_ranges.insert( p_block.free_ranges.begin() + i, t_back );
+        }
+        if( t_offset > t_range.offset )
+        {
+            Range t_front = { t_range.offset, t_offset - t_range.offset };
+            p_block.free_ranges.insert( p_block.free_ranges.begin() + i, t_front );
+        }
+
+        p_block.used += p_size;
+        p_block.allocations++;
+        p_offset = t_offset;
+        return true;
+    }
+
+    return false;
+}
+
+bool vulkanAllocator::alloc( const VkMemoryRequirements & p_reqs, VkMemoryPropertyFlags p_required,
+                             VkMemoryPropertyFlags p_preferred, ResourceKind p_kind, MemoryAllocation & p_allocation )
+{
+    uint32_t t_typeIndex;
+    if( !find_memory_type( p_reqs.memoryTypeBits, p_required, p_preferred, t_typeIndex ) )
+    {
+        LOG.error( "vulkanAllocator: no memory type matches bits {0} with flags {1}", p_reqs.memoryTypeBits, p_required );
+        return true;
+    }
+
+    VkDeviceSize t_alignment = p_reqs.alignment;
+    VkDeviceSize t_size = p_reqs.size;
+    const VkMemoryPropertyFlags t_flags = mMemoryProperties.memoryTypes[t_typeIndex].propertyFlags;
+
+    // keep non coherent allocations on their own atoms so flushing one
+    // never touches a neighbour
+    if( ( t_flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT ) && !( t_flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT ) )
+    {
+        t_alignment = std::max( t_alignment, mNonCoherentAtomSize );
+        t_size = align_up( t_size, mNonCoherentAtomSize );
+    }
+
+    p_allocation.memory_type = t_typeIndex;
+    p_allocation.kind = p_kind;
+    p_allocation.size = t_size;
+
+    const VkDeviceSize t_blockSize = block_size_for( t_typeIndex );
+
+    // big resources would waste most of a block, give them their own memory
+    if( t_size > t_blockSize / 2 )
+    {
+        Block * t_dedicated = create_block( t_typeIndex, t_size );
+        if( !t_dedicated )
+        {
+            return true;
+        }
+
+        p_allocation.memory = t_dedicated->memory;
+        p_allocation.offset = 0;
+        p_allocation.mapped = t_dedicated->mapped;
+        p_allocation.block = UINT32_MAX;
+        delete t_dedicated;
+
+        std::lock_guard< std::mutex > t_lock( mMutex );
+        mDedicatedCount++;
+        mDedicatedBytes += t_size;
+        return false;
+    }
+
+    std::lock_guard< std::mutex > t_lock( mMutex );
+    std::vector< Block * > & t_pool = mPools[t_typeIndex][p_kind];
+
+    VkDeviceSize t_offset = 0;
+    for( size_t b = 0; b < t_pool.size(); ++b )
+    {
+        if( t_pool[b] && t_pool[b]->size - t_pool[b]->used >= t_size &&
+            alloc_from_block( *t_pool[b], t_size, t_alignment, t_offset ) )
+        {
+            p_allocation.memory = t_pool[b]->memory;
+            p_allocation.offset = t_offset;
+            p_allocation.mapped = t_pool[b]->mapped ? (char *)t_pool[b]->mapped + t_offset : nullptr;
+            p_allocation.block = (uint32_t)b;
+            return false;
+        }
+    }
+
+    Block * t_block = create_block( t_typeIndex, t_blockSize );
+    if( !t_block )
+    {
+        return true;
+    }
+
+    // reuse a slot of a released block so existing block indices stay valid
+    size_t t_slot = t_pool.size();
+    for( size_t b = 0; b < t_pool.size(); ++b )
+    {
+        if( !t_pool[b] )
+        {
+            t_slot = b;
+            break;
+        }
+    }
+    if( t_slot == t_pool.size() )
+    {
+        t_pool.push_back( t_block );
+    }else
+    {
+        t_pool[t_slot] = t_block;
+    }
+
+    bool U_ASSERT_ONLY pass = alloc_from_block( *t_block, t_size, t_alignment, t_offset );
+    assert( pass );
+
+    p_allocation.memory = t_block->memory;
+    p_allocation.offset = t_offset;
+    p_allocation.mapped = t_block->mapped ? (char *)t_block->mapped + t_offset : nullptr;
+    p_allocation.block = (uint32_t)t_slot;
+    return false;
+}
+
+void vulkanAllocator::free( MemoryAllocation & p_allocation )
+{
+    if( p_allocation.memory == VK_NULL_HANDLE )
+    {
+        return;
+    }
+
+    if( p_allocation.block == UINT32_MAX )
+    {
+        if( p_allocation.mapped )
+        {
+            vkd.UnmapMemory( mDevice, p_allocation.memory );
+        }
+        vkd.FreeMemory( mDevice, p_allocation.memory, nullptr );
+
+        std::lock_guard< std::mutex > t_lock( mMutex );
+        mDedicatedCount--;
+        mDedicatedBytes -= p_allocation.size;
+        p_allocation.memory = VK_NULL_HANDLE;
+        return;
+    }
+
+    std::lock_guard< std::mutex > t_lock( mMutex );
+    std::vector< Block * > & t_pool = mPools[p_allocation.memory_type][p_allocation.kind];
+    Block * t_block = t_pool[p_allocation.block];
+    assert( t_block && t_block->memory == p_allocation.memory );
+
+    Range t_range = { p_allocation.offset, p_allocation.size };
+    std::vector< Range >::iterator t_it = t_block->free_ranges.begin();
+    while( t_it != t_block->free_ranges.end() && t_it->offset < t_range.offset )
+    {
+        ++t_it;
+    }
+    t_it = t_block->free_ranges.insert( t_it, t_range );
+
+    // coalesce with the following and the preceding range
+    std::vector< Range >::iterator t_next = t_it + 1;
+    if( t_next != t_block->free_ranges.end() && t_it->offset + t_it->size == t_next->offset )
+    {
+        t_it->size += t_next->size;
+        t_block->free_ranges.erase( t_next );
+    }
+    if( t_it != t_block->free_ranges.begin() )
+    {
+        std::vector< Range >::iterator t_prev = t_it - 1;
+        if( t_prev->offset + t_prev->size == t_it->offset )
+        {
+            t_prev->size += t_it->size;
+            t_block->free_ranges.erase( t_it );
+        }
+    }
+
+    t_block->used -= p_allocation.size;
+    t_block->allocations--;
+    p_allocation.memory = VK_NULL_HANDLE;
+    p_allocation.mapped = nullptr;
+
+    // empty blocks are kept for reuse; a second empty one in the pool is
+    // released so a level unload does not pin memory forever
+    if( t_block->allocations == 0 )
+    {
+        for( size_t b = 0; b < t_pool.size(); ++b )
+        {
+            if( b != p_allocation.block && t_pool[b] && t_pool[b]->allocations == 0 )
+            {
+                destroy_block( t_block );
+                t_pool[p_allocation.block] = nullptr;
+                break;
+            }
+        }
+    }
+}
+
+bool vulkanAllocator::allocImage( VkImage p_image, VkMemoryPropertyFlags p_required, MemoryAllocation & p_allocation,
+                                  VkImageTiling p_tiling )
+{
+    VkMemoryRequirements mem_reqs;
+    vkd.GetImageMemoryRequirements( mDevice, p_image, &mem_reqs );
+
+    if( alloc( mem_reqs, p_required, 0, p_tiling == VK_IMAGE_TILING_LINEAR ? Linear : Optimal, p_allocation ) )
+    {
+        return true;
+    }
+
+    VkResult err = vkd.BindImageMemory( mDevice, p_image, p_allocation.memory, p_allocation.offset );
+    if( err )
+    {
+        LOG.error( "vulkanAllocator: vkBindImageMemory failed with {0}", (int)err );
+        free( p_allocation );
+        return true;
+    }
+
+    return false;
+}
+
+bool vulkanAllocator::allocBuffer( VkBuffer p_buffer, VkMemoryPropertyFlags p_required, MemoryAllocation & p_allocation )
+{
+    VkMemoryRequirements mem_reqs;
+    vkd.GetBufferMemoryRequirements( mDevice, p_buffer, &mem_reqs );
+
+    if( alloc( mem_reqs, p_required, 0, Linear, p_allocation ) )
+    {
+        return true;
+    }
+
+    VkResult err = vkd.BindBufferMemory( mDevice, p_buffer, p_allocation.memory, p_allocation.offset );
+    if( err )
+    {
+        LOG.error( "vulkanAllocator: vkBindBufferMemory failed with {0}", (int)err );
+        free( p_allocation );
+        return true;
+    }
+
+    return false;
+}
+
+void vulkanAllocator::trim(void)
+{
+    std::lock_guard< std::mutex > t_lock( mMutex );
+
+    for( uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; ++i )
+    {
+        for( uint32_t k = 0; k < KindCount; ++k )
+        {
+            for( size_t b = 0; b < mPools[i][k].size(); ++b )
+            {
+                if( mPools[i][k][b] && mPools[i][k][b]->allocations == 0 )
+                {
+                    destroy_block( mPools[i][k][b] );
+                    mPools[i][k][b] = nullptr;
+                }
+            }
+        }
+    }
+}
+
+MemoryStats vulkanAllocator::stats(void)
+{
+    std::lock_guard< std::mutex > t_lock( mMutex );
+
+    MemoryStats t_stats = {};
+    VkDeviceSize t_free = 0;
+
+    for( uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; ++i )
+    {
+        for( uint32_t k = 0; k < KindCount; ++k )
+        {
+            for( size_t b = 0; b < mPools[i][k].size(); ++b )
+            {
+                const Block * t_block = mPools[i][k][b];
+                if( !t_block )
+                {
+                    continue;
+                }
+
+                t_stats.block_count++;
+                t_stats.block_bytes += t_block->size;
+                t_stats.used_bytes += t_block->used;
+                t_stats.allocation_count += t_block->allocations;
+                t_stats.free_range_count += (uint32_t)t_block->free_ranges.size();
+
+                for( size_t r = 0; r < t_block->free_ranges.size(); ++r )
+                {
+                    t_free += t_block->free_ranges[r].size;
+                    t_stats.largest_free = std::max( t_stats.largest_free, t_block->free_ranges[r].size );
+                }
+            }
+        }
+    }
+
+    t_stats.dedicated_count = mDedicatedCount;
+    t_stats.allocation_count += mDedicatedCount;
+    t_stats.block_bytes += mDedicatedBytes;
+    t_stats.used_bytes += mDedicatedBytes;
+    t_stats.fragmentation = t_free > 0 ? 1.0f - (float)( (double)t_stats.largest_free / (double)t_free ) : 0.0f;
+
+    return t_stats;
+}
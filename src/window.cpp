@@ -1,11 +1,18 @@
 #include "window.h"
 #include "log.hpp"
 #include "VGraphical.h"
+#include "cpuProfiler.h"
+
+// key events kept per window between two dispatches
+#define WINDOW_EVENT_LIMIT 1024
 
 namespace ROOT_SPACE
 {
 
     std::map< GLFWwindow * , window * > window::smWindows;
+    uint32_t window::smDispatchDepth = 0;
+    bool window::smPolling = false;
+    std::vector< GLFWwindow * > window::smReleased;
 
 
     void window::setWindowSize( const glm::ivec2 & p_windowSize )
@@ -14,7 +21,7 @@ namespace ROOT_SPACE
     }
     void window::setWindowPos( const glm::ivec2 & p_windowPos )
     {
-        glfwSetWindowSize( mWindowHandle, p_windowPos.x, p_windowPos.y );
+        glfwSetWindowPos( mWindowHandle, p_windowPos.x, p_windowPos.y );
     }
 
     void window::setWindowTitle( const std::string & p_windowTitle )
@@ -23,6 +30,15 @@ namespace ROOT_SPACE
         glfwSetWindowTitle( mWindowHandle, mWindowTitle.c_str() );
     }
 
+    void window::setPresentPolicy( const PresentPolicy p_policy )
+    {
+        mPresentPolicy = p_policy;
+        if( mWindowHandle )
+        {
+            VGraphical::invalidateSwapchain( *this );
+        }
+    }
+
     GLFWwindow * window::_GLFW_WindowHandle(void) const
     {
         return mWindowHandle;
@@ -34,47 +50,208 @@ namespace ROOT_SPACE
         mWindowSize = glm::ivec2( 600, 500 );
         mWindowPos = glm::ivec2( 0, 0 );
         mWindowTitle = "Humble";
+        mPresentPolicy = PresentPolicy::VSync;
+        mPendingResize = -1;
+        mPendingMove = -1;
+        mPendingRefresh = -1;
     }
 
     window::~window( void )
     {
         if( mWindowHandle )
         {
-            smWindows.erase( mWindowHandle );
-            glfwDestroyWindow( mWindowHandle );
-            mWindowHandle = nullptr;
+            VGraphical::destroyWindow( *this );
+            releaseHandle();
         }
     }
 
+    // the user pointer is set before any callback and cleared before the
+    // window goes away, so no lookup is needed per event
     void window::__refresh_callback( GLFWwindow * p_window )
     {
-        if( smWindows.find( p_window ) != smWindows.end() )
+        CPU_ZONE( "window event" );
+        window * t_window = static_cast< window * >( glfwGetWindowUserPointer( p_window ) );
+        if( t_window )
         {
-            smWindows[p_window]->onRefresh();
+            WindowEvent t_event = {};
+            t_event.type = EventType::Refresh;
+            t_window->queueEvent( t_event, t_window->mPendingRefresh );
         }
     }
 
     void window::__key_callback( GLFWwindow * p_window, int p_key, int p_scancode, int p_action, int p_mods )
     {
-        if( smWindows.find( p_window ) != smWindows.end() )
+        CPU_ZONE( "window event" );
+        window * t_window = static_cast< window * >( glfwGetWindowUserPointer( p_window ) );
+        if( t_window )
         {
-            smWindows[p_window]->onKeyCallBack( p_key, p_scancode, p_action, p_mods );
+            WindowEvent t_event = {};
+            t_event.type = EventType::Key;
+            t_event.key = p_key;
+            t_event.scancode = p_scancode;
+            t_event.action = p_action;
+            t_event.mods = p_mods;
+            t_window->queueKey( t_event );
         }
     }
 
     void window::__resize_callback( GLFWwindow* p_window, int p_width, int p_height )
     {
-        if( smWindows.find( p_window ) != smWindows.end() )
+        CPU_ZONE( "window event" );
+        window * t_window = static_cast< window * >( glfwGetWindowUserPointer( p_window ) );
+        if( t_window )
         {
-            smWindows[p_window]->onResize( glm::ivec2( p_width, p_height ) );
+            WindowEvent t_event = {};
+            t_event.type = EventType::Resize;
+            t_event.value = glm::ivec2( p_width, p_height );
+            t_window->queueEvent( t_event, t_window->mPendingResize );
         }
     }
 
     void window::__pos_callback( GLFWwindow* p_window, int p_x, int p_y )
     {
-        if( smWindows.find( p_window ) != smWindows.end() )
+        CPU_ZONE( "window event" );
+        window * t_window = static_cast< window * >( glfwGetWindowUserPointer( p_window ) );
+        if( t_window )
+        {
+            WindowEvent t_event = {};
+            t_event.type = EventType::Move;
+            t_event.value = glm::ivec2( p_x, p_y );
+            t_window->queueEvent( t_event, t_window->mPendingMove );
+        }
+    }
+
+    void window::queueEvent( const WindowEvent & p_event, int & p_pending )
+    {
+        if( p_pending >= 0 )
+        {
+            mEvents[p_pending] = p_event;
+            return;
+        }
+
+        p_pending = (int)mEvents.size();
+        mEvents.push_back( p_event );
+        eventQueued();
+    }
+
+    void window::queueKey( const WindowEvent & p_event )
+    {
+        if( mEvents.size() >= WINDOW_EVENT_LIMIT )
+        {
+            return;
+        }
+
+        mEvents.push_back( p_event );
+        if( mEvents.size() == WINDOW_EVENT_LIMIT )
+        {
+            LOG.warning( "window: {0} events queued, further keys are dropped until the next dispatch", WINDOW_EVENT_LIMIT );
+        }
+        eventQueued();
+    }
+
+    void window::eventQueued(void)
+    {
+        if( !smPolling )
         {
-            smWindows[p_window]->onPosChanged( glm::ivec2( p_x, p_y ) );
+            dispatchEvents();
+        }
+    }
+
+    void window::releaseHandle(void)
+    {
+        glfwSetWindowUserPointer( mWindowHandle, nullptr );
+        smWindows.erase( mWindowHandle );
+        if( smDispatchDepth > 0 )
+        {
+            smReleased.push_back( mWindowHandle );
+        }else
+        {
+            glfwDestroyWindow( mWindowHandle );
+        }
+        mWindowHandle = nullptr;
+    }
+
+    void window::flushReleased(void)
+    {
+        for( size_t i = 0; i < smReleased.size(); ++i )
+        {
+            glfwDestroyWindow( smReleased[i] );
+        }
+        smReleased.clear();
+    }
+
+    void window::pollEvents(void)
+    {
+        smPolling = true;
+        glfwPollEvents();
+
+        CPU_ZONE( "dispatch events" );
+
+        // handlers may create or destroy any window, so walk a snapshot and
+        // look each one up again right before it is dispatched
+        std::vector< GLFWwindow * > t_handles;
+        for( std::map< GLFWwindow *, window * >::iterator t_it = smWindows.begin(); t_it != smWindows.end(); ++t_it )
+        {
+            t_handles.push_back( t_it->first );
+        }
+
+        ++smDispatchDepth;
+        for( size_t i = 0; i < t_handles.size(); ++i )
+        {
+            std::map< GLFWwindow *, window * >::iterator t_it = smWindows.find( t_handles[i] );
+            if( t_it != smWindows.end() )
+            {
+                t_it->second->dispatchEvents();
+            }
+        }
+        if( --smDispatchDepth == 0 )
+        {
+            flushReleased();
+        }
+    }
+
+    void window::dispatchEvents(void)
+    {
+        // handlers may cause new events, those wait for the next frame
+        std::vector< WindowEvent > t_dispatching;
+        t_dispatching.swap( mEvents );
+        mPendingResize = -1;
+        mPendingMove = -1;
+        mPendingRefresh = -1;
+
+        // a handler may destroy this window, nothing of it is touched after
+        // that; its glfw handle stays valid until the dispatch ends
+        GLFWwindow * t_handle = mWindowHandle;
+        ++smDispatchDepth;
+        for( size_t i = 0; i < t_dispatching.size(); ++i )
+        {
+            std::map< GLFWwindow *, window * >::iterator t_it = smWindows.find( t_handle );
+            if( !t_handle || t_it == smWindows.end() || t_it->second != this )
+            {
+                break;
+            }
+
+            const WindowEvent & t_event = t_dispatching[i];
+            switch( t_event.type )
+            {
+            case EventType::Key:
+                onKeyCallBack( t_event.key, t_event.scancode, t_event.action, t_event.mods );
+                break;
+            case EventType::Resize:
+                VGraphical::invalidateSwapchain( *this );
+                onResize( t_event.value );
+                break;
+            case EventType::Move:
+                onPosChanged( t_event.value );
+                break;
+            case EventType::Refresh:
+                onRefresh();
+                break;
+            }
+        }
+        if( --smDispatchDepth == 0 )
+        {
+            flushReleased();
         }
     }
 
@@ -96,11 +273,11 @@ namespace ROOT_SPACE
         
         smWindows[mWindowHandle] = this;
 
-        // glfwSetWindowUserPointer( mWindowHandle, this );
+        glfwSetWindowUserPointer( mWindowHandle, this );
         glfwSetKeyCallback( mWindowHandle, window::__key_callback );
         glfwSetWindowRefreshCallback( mWindowHandle, window::__refresh_callback );
         glfwSetFramebufferSizeCallback( mWindowHandle, window::__resize_callback );
-        // glfwSetWindowPosCallback( mWindowHandle,  )
+        glfwSetWindowPosCallback( mWindowHandle, window::__pos_callback );
 
         if( VGraphical::initWindow( *this ) )
         {
@@ -123,9 +300,8 @@ namespace ROOT_SPACE
         
         if( mWindowHandle )
         {
-            smWindows.erase( mWindowHandle );
-            glfwDestroyWindow( mWindowHandle );
-            mWindowHandle = nullptr;
+            VGraphical::destroyWindow( *this );
+            releaseHandle();
         }
         
 		return object::destory ();
@@ -138,7 +314,7 @@ namespace ROOT_SPACE
 
     void window::onKeyCallBack( const int p_key, const int p_scancode, const int p_action, const int p_mods )
     {
-        LOG.info( "p_key: {0}, p_scancode: {1}, p_action: {2}, p_mods: {3}", p_key, p_scancode, p_action, p_mods );
+        
     }
 
     void window::onResize( const glm::ivec2 & p_windowSize )